@@ -1,9 +1,16 @@
 #pragma once
+#include "align.h"
 #include "byte_swap.h"
+#include "decaf_assert.h"
 #include "platform.h"
 #include "platform_intrin.h"
 #include <vector>
 
+//! Above this size the destination is written with non-temporal stores, the
+//! swapped data would not fit in the cache anyway so there is no point
+//! evicting everything else to make room for it.
+static constexpr size_t ByteSwapNonTemporalThreshold = 4 * 1024 * 1024;
+
 template<typename DataType>
 static inline void
 byte_swap_unaligned(DataType *dst,
@@ -15,42 +22,110 @@ byte_swap_unaligned(DataType *dst,
    }
 }
 
-#ifdef PLATFORM_HAS_SSE3
 template<typename DataType>
-static inline void
-byte_swap_aligned(DataType *dst,
-                  const DataType *srcStart,
-                  const DataType *srcEnd)
+PLATFORM_TARGET_SSSE3 static inline __m128i
+byte_swap_mask_128()
 {
-   auto sseDst = reinterpret_cast<__m128i *>(dst);
-   auto sseSrc = reinterpret_cast<const __m128i *>(srcStart);
-   auto sseSrcEnd = reinterpret_cast<const __m128i *>(srcEnd);
-
    static_assert(sizeof(DataType) == 2 || sizeof(DataType) == 4,
                  "unexpected data type size for aligned byte swap");
 
-   __m128i sseMask;
    if constexpr (sizeof(DataType) == 2) {
-      sseMask = _mm_set_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
-   } else if constexpr (sizeof(DataType) == 4) {
-      sseMask = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+      return _mm_set_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+   } else {
+      return _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
    }
+}
+
+/**
+ * Byte swap 16 bytes at a time, srcStart and srcEnd must be 16 byte aligned.
+ */
+template<typename DataType>
+PLATFORM_TARGET_SSSE3 static inline void
+byte_swap_aligned_ssse3(DataType *dst,
+                        const DataType *srcStart,
+                        const DataType *srcEnd)
+{
+   auto sseDst = reinterpret_cast<__m128i *>(dst);
+   auto sseSrc = reinterpret_cast<const __m128i *>(srcStart);
+   auto sseSrcEnd = reinterpret_cast<const __m128i *>(srcEnd);
+   auto sseMask = byte_swap_mask_128<DataType>();
 
    while (sseSrc < sseSrcEnd) {
       _mm_storeu_si128(sseDst++,
                        _mm_shuffle_epi8(_mm_loadu_si128(sseSrc++), sseMask));
    }
 }
-#else
+
+/**
+ * Byte swap 32 bytes at a time, srcStart and srcEnd must be 16 byte aligned.
+ *
+ * Large swaps into a 32 byte aligned destination use non-temporal stores.
+ */
+template<typename DataType>
+PLATFORM_TARGET_AVX2 static inline void
+byte_swap_aligned_avx2(DataType *dst,
+                       const DataType *srcStart,
+                       const DataType *srcEnd)
+{
+   auto avxDst = reinterpret_cast<__m256i *>(dst);
+   auto avxSrc = reinterpret_cast<const __m256i *>(srcStart);
+   auto numBlocks = (reinterpret_cast<uintptr_t>(srcEnd) - reinterpret_cast<uintptr_t>(srcStart)) / 32;
+   auto avxSrcEnd = avxSrc + numBlocks;
+   auto sseMask = byte_swap_mask_128<DataType>();
+   auto avxMask = _mm256_broadcastsi128_si256(sseMask);
+
+   if (numBlocks * 32 >= ByteSwapNonTemporalThreshold &&
+       align_up(avxDst, 32) == avxDst) {
+      while (avxSrc < avxSrcEnd) {
+         _mm256_stream_si256(avxDst++,
+                             _mm256_shuffle_epi8(_mm256_loadu_si256(avxSrc++), avxMask));
+      }
+
+      _mm_sfence();
+   } else {
+      while (avxSrc < avxSrcEnd) {
+         _mm256_storeu_si256(avxDst++,
+                             _mm256_shuffle_epi8(_mm256_loadu_si256(avxSrc++), avxMask));
+      }
+   }
+
+   // There can be at most one 16 byte block left over
+   auto sseSrc = reinterpret_cast<const __m128i *>(avxSrc);
+   if (sseSrc < reinterpret_cast<const __m128i *>(srcEnd)) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(avxDst),
+                       _mm_shuffle_epi8(_mm_loadu_si128(sseSrc), sseMask));
+   }
+}
+
+static inline bool
+byte_swap_use_avx2()
+{
+   static const auto hasAvx2 = platform::hasAvx2();
+   return hasAvx2;
+}
+
+static inline bool
+byte_swap_use_ssse3()
+{
+   static const auto hasSsse3 = platform::hasSsse3();
+   return hasSsse3;
+}
+
 template<typename DataType>
 static inline void
-byte_swap_aligned(DataType *dst, const DataType *srcStart, const DataType *srcEnd)
+byte_swap_aligned(DataType *dst,
+                  const DataType *srcStart,
+                  const DataType *srcEnd)
 {
-   byte_swap_unaligned<DataType>(dst, srcStart, srcEnd);
+   if (byte_swap_use_avx2()) {
+      byte_swap_aligned_avx2<DataType>(dst, srcStart, srcEnd);
+   } else if (byte_swap_use_ssse3()) {
+      byte_swap_aligned_ssse3<DataType>(dst, srcStart, srcEnd);
+   } else {
+      byte_swap_unaligned<DataType>(dst, srcStart, srcEnd);
+   }
 }
-#endif
 
-#ifdef PLATFORM_HAS_SSE3
 template<typename DataType>
 static inline void *
 byte_swap_to_scratch(const void *data,
@@ -58,7 +133,7 @@ byte_swap_to_scratch(const void *data,
                      std::vector<uint8_t> &scratch)
 {
    // We pad the output buffer to guarentee we can align it to any source address.
-   scratch.resize(numBytes + 32);
+   scratch.resize(numBytes + 64);
 
    // Calculate some information about the indices
    auto swapSrc = reinterpret_cast<const DataType *>(data);
@@ -67,15 +142,23 @@ byte_swap_to_scratch(const void *data,
    // The source must be aligned at least to the swap boundary...
    decaf_check(swapSrc == align_up(swapSrc, sizeof(DataType)));
 
-   // Align our destination exactly the same as the source
-   auto unalignedOffset = reinterpret_cast<uintptr_t>(swapSrc) & 0xF;
-   auto alignMatchedScratch = align_up(scratch.data(), 16) + unalignedOffset;
+   // Align our destination exactly the same as the source, to 32 bytes so
+   // that the AVX2 path is able to use aligned non-temporal stores.
+   auto unalignedOffset = reinterpret_cast<uintptr_t>(swapSrc) & 0x1F;
+   auto alignMatchedScratch = align_up(scratch.data(), 32) + unalignedOffset;
    auto swapDest = reinterpret_cast<DataType *>(alignMatchedScratch);
 
    // Calculate our aligned memory
-   auto alignedSwapDest = align_up(swapDest, 16);
-   auto alignedSwapSrc = align_up(swapSrc, 16);
-   auto alignedSwapSrcEnd = align_down(swapSrcEnd, 16);
+   auto alignedSwapDest = align_up(swapDest, 32);
+   auto alignedSwapSrc = align_up(swapSrc, 32);
+   auto alignedSwapSrcEnd = align_down(swapSrcEnd, 32);
+
+   // Too small to contain any aligned blocks
+   if (alignedSwapSrc >= alignedSwapSrcEnd) {
+      byte_swap_unaligned<DataType>(swapDest, swapSrc, swapSrcEnd);
+      return alignMatchedScratch;
+   }
+
    auto alignedSize = alignedSwapSrcEnd - alignedSwapSrc;
 
    // Do the unaligned before portion
@@ -91,16 +174,3 @@ byte_swap_to_scratch(const void *data,
 
    return alignMatchedScratch;
 }
-#else
-template<typename DataType>
-static inline void *
-byte_swap_to_scratch(const void *data, uint32_t numBytes, std::vector<uint8_t>& scratch)
-{
-   scratch.resize(numBytes);
-   auto swapDest = reinterpret_cast<DataType *>(scratch.data());
-   auto swapSrc = reinterpret_cast<const DataType *>(data);
-   auto swapSrcEnd = swapSrc + (numBytes / sizeof(DataType));
-   byte_swap_unaligned<DataType>(swapDest, swapSrc, swapSrcEnd);
-   return swapDest;
-}
-#endif
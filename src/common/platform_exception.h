@@ -53,7 +53,15 @@ HandledException = reinterpret_cast<ExceptionResumeFunc>(static_cast<uintptr_t>(
 static ExceptionResumeFunc const
 UnhandledException = reinterpret_cast<ExceptionResumeFunc>(static_cast<uintptr_t>(0));
 
+// Called for access violations before any ExceptionHandler, directly from
+// the signal or vectored exception handler.  It must be thread safe and must
+// not allocate, return true to resume execution of the faulting instruction.
+using AccessViolationFilter = bool (*)(uint64_t address);
+
 bool
 installExceptionHandler(ExceptionHandler handler);
 
+bool
+installAccessViolationFilter(AccessViolationFilter filter);
+
 } // namespace platform
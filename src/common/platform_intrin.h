@@ -9,3 +9,59 @@
 #else
 #include <x86intrin.h>
 #endif
+
+// Allows a function to use AVX2 intrinsics without building the whole file
+// with AVX2 enabled, callers must check platform::hasAvx2() first.
+#if defined(_MSC_VER)
+#define PLATFORM_TARGET_AVX2
+#else
+#define PLATFORM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// As above for SSSE3, callers must check platform::hasSsse3() first.
+#if defined(_MSC_VER)
+#define PLATFORM_TARGET_SSSE3
+#else
+#define PLATFORM_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+
+namespace platform
+{
+
+inline bool
+hasSsse3()
+{
+#if defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 1);
+   return !!(info[2] & (1 << 9));
+#else
+   return !!__builtin_cpu_supports("ssse3");
+#endif
+}
+
+inline bool
+hasAvx2()
+{
+#if defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 0);
+   if (info[0] < 7) {
+      return false;
+   }
+
+   // Check the OS saves the AVX state, and that the CPU supports AVX
+   static constexpr int OsxsaveAvx = (1 << 27) | (1 << 28);
+   __cpuid(info, 1);
+   if ((info[2] & OsxsaveAvx) != OsxsaveAvx || (_xgetbv(0) & 6) != 6) {
+      return false;
+   }
+
+   __cpuidex(info, 7, 0);
+   return !!(info[1] & (1 << 5));
+#else
+   return !!__builtin_cpu_supports("avx2");
+#endif
+}
+
+} // namespace platform
@@ -1,3 +1,4 @@
+#include <atomic>
 #include <vector>
 #include "platform.h"
 #include "platform_exception.h"
@@ -19,6 +20,9 @@ namespace platform
 static std::vector<ExceptionHandler>
 sExceptionHandlers;
 
+static std::atomic<AccessViolationFilter>
+sAccessViolationFilter { nullptr };
+
 static struct sigaction
 sSegvHandler;
 
@@ -88,6 +92,13 @@ dispatchException(Exception *exception,
 static void
 segvHandler(int signum, siginfo_t *info, void *context)
 {
+   // The filter is checked before touching any signal state as it may be hit
+   //  by many threads at once, e.g. for write tracking.
+   auto filter = sAccessViolationFilter.load();
+   if (filter && filter(reinterpret_cast<uint64_t>(info->si_addr))) {
+      return;
+   }
+
    auto exception = AccessViolationException { reinterpret_cast<uint64_t>(info->si_addr) };
    dispatchException(&exception, context, signum, &sSegvHandler, &sSystemSegvHandler);
 }
@@ -99,17 +110,19 @@ illHandler(int signum, siginfo_t *info, void *context)
    dispatchException(&exception, context, signum, &sIllHandler, &sSystemIllHandler);
 }
 
-bool
-installExceptionHandler(ExceptionHandler handler)
+static bool
+installSignalHandlers()
 {
    static bool addedHandlers = false;
 
    if (!addedHandlers) {
       sigemptyset(&sSegvHandler.sa_mask);
 
-      // Set SA_RESETHAND so that a SEGV in the handler will terminate the
-      // program rather than going into an infinite loop.
-      sSegvHandler.sa_flags = SA_SIGINFO | SA_RESETHAND;
+      // We do not set SA_RESETHAND as that would leave a window in which a
+      // fault on another thread is sent to the default handler.  A SEGV in
+      // the handler itself still terminates the program, as the kernel
+      // kills a thread which faults whilst the signal is blocked.
+      sSegvHandler.sa_flags = SA_SIGINFO;
 
       sSegvHandler.sa_sigaction = segvHandler;
       if (sigaction(SIGSEGV, &sSegvHandler, &sSystemSegvHandler) != 0) {
@@ -127,10 +140,31 @@ installExceptionHandler(ExceptionHandler handler)
       addedHandlers = true;
    }
 
+   return true;
+}
+
+bool
+installExceptionHandler(ExceptionHandler handler)
+{
+   if (!installSignalHandlers()) {
+      return false;
+   }
+
    sExceptionHandlers.push_back(handler);
    return true;
 }
 
+bool
+installAccessViolationFilter(AccessViolationFilter filter)
+{
+   if (!installSignalHandlers()) {
+      return false;
+   }
+
+   sAccessViolationFilter.store(filter);
+   return true;
+}
+
 } // namespace platform
 
 #endif
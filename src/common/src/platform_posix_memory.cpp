@@ -160,7 +160,7 @@ mapViewOfFile(MapFileHandle handle,
       return nullptr;
    }
 
-   if (result != dst) {
+   if (dst && result != dst) {
       gLog->error("mapViewOfFile(offset: 0x{:X}, size: 0x{:X}, dst: {}) mmap returned unexpected address: {}",
                   offset, size, dst, result);
 
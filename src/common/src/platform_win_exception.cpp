@@ -14,6 +14,9 @@ namespace platform
 static std::vector<ExceptionHandler>
 gExceptionHandlers;
 
+static AccessViolationFilter
+gAccessViolationFilter = nullptr;
+
 LONG
 dispatchException(PEXCEPTION_POINTERS info, Exception *exception)
 {
@@ -69,6 +72,31 @@ installExceptionHandler(ExceptionHandler handler)
    return true;
 }
 
+static LONG CALLBACK
+accessViolationFilterHandler(PEXCEPTION_POINTERS info)
+{
+   if (info->ExceptionRecord->ExceptionCode == STATUS_ACCESS_VIOLATION) {
+      auto address = info->ExceptionRecord->ExceptionInformation[1];
+      if (gAccessViolationFilter(address)) {
+         return EXCEPTION_CONTINUE_EXECUTION;
+      }
+   }
+
+   return EXCEPTION_CONTINUE_SEARCH;
+}
+
+bool
+installAccessViolationFilter(AccessViolationFilter filter)
+{
+   if (!gAccessViolationFilter) {
+      // Registered first so it runs before any other exception handler.
+      AddVectoredExceptionHandler(1, accessViolationFilterHandler);
+   }
+
+   gAccessViolationFilter = filter;
+   return true;
+}
+
 } // namespace platform
 
 #endif
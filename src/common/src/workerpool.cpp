@@ -0,0 +1,118 @@
+#include "workerpool.h"
+
+#include <algorithm>
+
+WorkerPool::~WorkerPool()
+{
+   setNumThreads(0);
+}
+
+
+/**
+ * Set the number of worker threads, in addition to the thread calling run.
+ *
+ * Waits for any running job to finish first.
+ */
+void
+WorkerPool::setNumThreads(uint32_t numThreads)
+{
+   std::lock_guard<std::mutex> dispatchLock { mDispatchMutex };
+
+   if (numThreads == mThreads.size()) {
+      return;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock { mMutex };
+      mQuit = true;
+      mJobCondition.notify_all();
+   }
+
+   for (auto &thread : mThreads) {
+      thread.join();
+   }
+
+   mThreads.clear();
+   mQuit = false;
+
+   // New workers must only pick up jobs started after this point. They are
+   // given the current job id rather than reading it when they start, as by
+   // then the next job may already have been queued and counted them in.
+   for (auto i = 0u; i < numThreads; ++i) {
+      mThreads.emplace_back(&WorkerPool::workerEntry, this, mJobId);
+   }
+}
+
+
+/**
+ * Call func for every item in [0, numItems), split across the pool in chunks
+ * of at least minChunkSize items. Returns once every item has been processed.
+ */
+void
+WorkerPool::run(uint32_t numItems,
+                uint32_t minChunkSize,
+                RangeFunction func,
+                const void *context)
+{
+   std::unique_lock<std::mutex> dispatchLock { mDispatchMutex, std::try_to_lock };
+   if (!dispatchLock.owns_lock() || mThreads.empty()) {
+      func(context, 0, numItems);
+      return;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock { mMutex };
+      auto numParticipants = static_cast<uint32_t>(mThreads.size() + 1);
+      mJobFunction = func;
+      mJobContext = context;
+      mJobNumItems = numItems;
+      mJobChunkSize = std::max(std::max(minChunkSize, 1u), numItems / (numParticipants * 4));
+      mJobNextItem.store(0);
+      mJobActiveWorkers = static_cast<uint32_t>(mThreads.size());
+      mJobId++;
+      mJobCondition.notify_all();
+   }
+
+   runChunks();
+
+   std::unique_lock<std::mutex> lock { mMutex };
+   mDoneCondition.wait(lock, [this] { return mJobActiveWorkers == 0; });
+   mJobFunction = nullptr;
+   mJobContext = nullptr;
+}
+
+void
+WorkerPool::runChunks()
+{
+   while (true) {
+      auto first = mJobNextItem.fetch_add(mJobChunkSize);
+      if (first >= mJobNumItems) {
+         break;
+      }
+
+      auto last = std::min(first + mJobChunkSize, mJobNumItems);
+      mJobFunction(mJobContext, first, last);
+   }
+}
+
+void
+WorkerPool::workerEntry(uint64_t lastJobId)
+{
+   std::unique_lock<std::mutex> lock { mMutex };
+
+   while (true) {
+      mJobCondition.wait(lock, [&] { return mQuit || mJobId != lastJobId; });
+      if (mQuit) {
+         break;
+      }
+
+      lastJobId = mJobId;
+      lock.unlock();
+      runChunks();
+      lock.lock();
+
+      if (--mJobActiveWorkers == 0) {
+         mDoneCondition.notify_all();
+      }
+   }
+}
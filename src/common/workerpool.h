@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Worker Pool Responsibilities:
+ *
+ * 1. Split the items of a job into chunks which are run across a set of
+ *    worker threads, with the calling thread also taking part.
+ * 2. Fall back to running the job on the calling thread when the pool has no
+ *    threads, or another job is already running.
+ */
+class WorkerPool
+{
+public:
+   //! Called to process the items [first, last) of a job.
+   using RangeFunction = void (*)(const void *context, uint32_t first, uint32_t last);
+
+   ~WorkerPool();
+
+   void
+   setNumThreads(uint32_t numThreads);
+
+   void
+   run(uint32_t numItems,
+       uint32_t minChunkSize,
+       RangeFunction func,
+       const void *context);
+
+private:
+   void
+   runChunks();
+
+   void
+   workerEntry(uint64_t lastJobId);
+
+private:
+   //! Held whilst a job is running, and whilst the threads are changed.
+   std::mutex mDispatchMutex;
+
+   std::mutex mMutex;
+   std::condition_variable mJobCondition;
+   std::condition_variable mDoneCondition;
+   std::vector<std::thread> mThreads;
+   bool mQuit = false;
+
+   uint64_t mJobId = 0;
+   RangeFunction mJobFunction = nullptr;
+   const void *mJobContext = nullptr;
+   uint32_t mJobNumItems = 0;
+   uint32_t mJobChunkSize = 0;
+   std::atomic<uint32_t> mJobNextItem { 0 };
+   uint32_t mJobActiveWorkers = 0;
+};
@@ -7,6 +7,7 @@ namespace system
 {
 
 int timeout_ms = 0;
+std::string hle_profile;
 
 } // namespace system
 
@@ -14,6 +15,7 @@ bool
 loadFrontendToml(std::shared_ptr<cpptoml::table> config)
 {
    system::timeout_ms = config->get_qualified_as<int>("system.timeout_ms").value_or(system::timeout_ms);
+   system::hle_profile = config->get_qualified_as<std::string>("system.hle_profile").value_or(system::hle_profile);
    return true;
 }
 
@@ -26,6 +28,7 @@ saveFrontendToml(std::shared_ptr<cpptoml::table> config)
    }
 
    system->insert("timeout_ms", system::timeout_ms);
+   system->insert("hle_profile", system::hle_profile);
    config->insert("system", system);
    return true;
 }
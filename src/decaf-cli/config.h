@@ -9,6 +9,7 @@ namespace system
 {
 
 extern int timeout_ms;
+extern std::string hle_profile;
 
 } // namespace system
 
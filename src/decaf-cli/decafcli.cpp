@@ -1,13 +1,83 @@
 #include "decafcli.h"
 #include "config.h"
 
+#include <algorithm>
 #include <chrono>
 #include <condition_variable>
+#include <fstream>
 #include <libgpu/gpu_graphicsdriver.h>
+#include <libdecaf/decaf_debug_api.h>
 #include <libdecaf/decaf_nullinputdriver.h>
 #include <mutex>
+#include <numeric>
 #include <thread>
 
+static std::chrono::nanoseconds
+getTotalTime(const decaf::debug::CafeHleFunctionProfile &function)
+{
+   return std::accumulate(function.time.begin(), function.time.end(),
+                          std::chrono::nanoseconds { 0 });
+}
+
+
+/**
+ * Write the HLE profile as CSV, sorted by total host time, and log the
+ * most expensive functions.
+ */
+static bool
+writeHleProfile(const std::string &path)
+{
+   auto profile = std::vector<decaf::debug::CafeHleFunctionProfile> { };
+   if (!decaf::debug::sampleHleProfile(profile)) {
+      return false;
+   }
+
+   std::sort(profile.begin(), profile.end(),
+             [](const auto &lhs, const auto &rhs) {
+                return getTotalTime(lhs) > getTotalTime(rhs);
+             });
+
+   auto out = std::ofstream { path };
+   if (!out.is_open()) {
+      gCliLog->error("Could not open {} to write HLE profile", path);
+      return false;
+   }
+
+   out << "library,function,calls,total_us,mean_ns";
+   for (auto core = 0u; core < 3; ++core) {
+      out << fmt::format(",core{0}_calls,core{0}_us", core);
+   }
+   out << std::endl;
+
+   for (auto &function : profile) {
+      auto calls = std::accumulate(function.calls.begin(), function.calls.end(), uint64_t { 0 });
+      auto time = getTotalTime(function);
+      out << fmt::format("{},{},{},{},{}",
+                         function.library, function.function, calls,
+                         std::chrono::duration_cast<std::chrono::microseconds>(time).count(),
+                         time.count() / calls);
+
+      for (auto core = 0u; core < 3; ++core) {
+         out << fmt::format(",{},{}", function.calls[core],
+                            std::chrono::duration_cast<std::chrono::microseconds>(function.time[core]).count());
+      }
+
+      out << std::endl;
+   }
+
+   gCliLog->info("Wrote HLE profile of {} functions to {}", profile.size(), path);
+
+   for (auto i = 0u; i < std::min<size_t>(profile.size(), 10); ++i) {
+      auto &function = profile[i];
+      gCliLog->info("  {}::{} {} calls, {} us",
+                    function.library, function.function,
+                    std::accumulate(function.calls.begin(), function.calls.end(), uint64_t { 0 }),
+                    std::chrono::duration_cast<std::chrono::microseconds>(getTotalTime(function)).count());
+   }
+
+   return true;
+}
+
 int
 DecafCLI::run(const std::string &gamePath)
 {
@@ -22,6 +92,10 @@ DecafCLI::run(const std::string &gamePath)
       return -1;
    }
 
+   if (!config::system::hle_profile.empty()) {
+      decaf::debug::setHleProfilingEnabled(true);
+   }
+
    // Start graphics thread
    auto graphicsThread = std::thread {
       [this]() {
@@ -75,5 +149,9 @@ DecafCLI::run(const std::string &gamePath)
       graphicsThread.join();
    }
 
+   if (!config::system::hle_profile.empty()) {
+      writeHleProfile(config::system::hle_profile);
+   }
+
    return result;
 }
@@ -44,7 +44,10 @@ getCommandLineParser()
                   value<std::string> {})
       .add_option("timeout_ms",
                   description { "How long to execute the game for before quitting." },
-                  value<uint32_t> {});
+                  value<uint32_t> {})
+      .add_option("hle_profile",
+                  description { "Profile HLE function calls and write the results as CSV to the given path on exit." },
+                  value<std::string> {});
 
    auto config_options = config::getExcmdGroups(parser);
 
@@ -147,6 +150,10 @@ start(excmd::parser &parser,
       config::system::timeout_ms = options.get<uint32_t>("timeout_ms");
    }
 
+   if (options.has("hle_profile")) {
+      config::system::hle_profile = options.get<std::string>("hle_profile");
+   }
+
    // Initialise libdecaf logger
    auto logFile = getPathBasename(gamePath);
    decaf::initialiseLogging(logFile);
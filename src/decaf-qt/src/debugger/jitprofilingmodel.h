@@ -62,7 +62,7 @@ public:
       }
 
       const auto totalTime = static_cast<double>(jitStats.totalTimeInCodeBlocks);
-      const auto &stats = jitStats.compiledBlocks[index.row()];
+      const auto &stats = *jitStats.compiledBlocks[index.row()];
       if (role == Qt::DisplayRole) {
          switch (index.column()) {
          case 0:
@@ -22,7 +22,10 @@ getExcmdGroups(excmd::parser &parser)
 
    auto gpu_options = parser.add_option_group("GPU Options")
       .add_option("gpu-debug",
-                  description { "Enable extra gpu debug info." });
+                  description { "Enable extra gpu debug info." })
+      .add_option("gpu-cache-dir",
+                  description { "Directory to store translated shaders and pipelines in between runs." },
+                  value<std::string> {});
    groups.push_back(gpu_options.group);
 
    auto display_options = parser.add_option_group("Display Options")
@@ -59,6 +62,12 @@ getExcmdGroups(excmd::parser &parser)
                   description { "Enable the JIT engine." })
       .add_option("no-jit",
                   description { "Disable the JIT engine." })
+      .add_option("jit-cache-dir",
+                  description { "Directory to store translated code in between runs." },
+                  value<std::string> {})
+      .add_option("jit-compile-threads",
+                  description { "Number of threads used to translate code in the background, 0 translates on the guest core." },
+                  default_value<unsigned> { 0 })
       .add_option("jit-fast-math",
                   description { "Enable JIT floating-point optimizations which may not exactly match PowerPC behavior.  May not work for all games." },
                   default_value<std::string> { "full" },
@@ -69,6 +78,9 @@ getExcmdGroups(excmd::parser &parser)
                   description { "Set the JIT optimization level.  Higher levels give better performance but may cause longer translation delays.  Level 3 may not work for all games." },
                   default_value<int> { 1 },
                   allowed<int> { { 0, 1, 2, 3 } })
+      .add_option("jit-tier-threshold",
+                  description { "Translate blocks with only basic optimizations first, and retranslate them with the full optimization level after this many executions.  0 disables tiered compilation." },
+                  default_value<unsigned> { 0 })
       .add_option("jit-verify",
                   description { "Verify JIT implementation against interpreter." })
       .add_option("jit-verify-addr",
@@ -120,6 +132,11 @@ getExcmdGroups(excmd::parser &parser)
       .add_option("slc-path",
                   description { "Sets which path to mount to /dev/slc01." },
                   value<std::string> {})
+      .add_option("fast-forward",
+                  description { "Skip ahead to the next alarm whenever every core is idle, so emulated time runs faster than real time." })
+      .add_option("fast-forward-idle-delay",
+                  description { "How long every core must be idle, in microseconds, before skipping ahead." },
+                  default_value<unsigned> { 200 })
       .add_option("time-scale",
                   description { "Time scale factor for emulated clock." },
                   default_value<double> { 1.0 });
@@ -212,6 +229,18 @@ loadFromExcmd(excmd::option_state &options,
       cpuSettings.jit.enabled = false;
    }
 
+   if (options.has("jit-cache-dir")) {
+      cpuSettings.jit.cacheDirectory = options.get<std::string>("jit-cache-dir");
+   }
+
+   if (options.has("jit-compile-threads")) {
+      cpuSettings.jit.compileThreads = options.get<unsigned>("jit-compile-threads");
+   }
+
+   if (options.has("jit-tier-threshold")) {
+      cpuSettings.jit.tierThreshold = options.get<unsigned>("jit-tier-threshold");
+   }
+
    if (options.has("jit-verify")) {
       cpuSettings.jit.verify = true;
    }
@@ -282,6 +311,14 @@ loadFromExcmd(excmd::option_state &options,
       }
    }
 
+   if (options.has("fast-forward")) {
+      cpuSettings.time.fastForward = true;
+   }
+
+   if (options.has("fast-forward-idle-delay")) {
+      cpuSettings.time.fastForwardIdleDelayUs = options.get<unsigned>("fast-forward-idle-delay");
+   }
+
    return true;
 }
 
@@ -293,6 +330,10 @@ loadFromExcmd(excmd::option_state &options,
       gpuSettings.debug.debug_enabled = true;
    }
 
+   if (options.has("gpu-cache-dir")) {
+      gpuSettings.cache.directory = options.get<std::string>("gpu-cache-dir");
+   }
+
    if (options.has("background-colour")) {
       auto colour = std::vector<std::string> { };
       split_string(options.get<std::string>("background-colour"), ',', colour);
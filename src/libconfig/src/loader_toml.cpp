@@ -54,6 +54,38 @@ translateScreenMode(const std::string &text)
    return { };
 }
 
+static const char *
+translateRetileSimdLevel(gpu::TilingSettings::SimdLevel level)
+{
+   if (level == gpu::TilingSettings::Auto) {
+      return "auto";
+   } else if (level == gpu::TilingSettings::None) {
+      return "none";
+   } else if (level == gpu::TilingSettings::SSE2) {
+      return "sse2";
+   } else if (level == gpu::TilingSettings::AVX2) {
+      return "avx2";
+   }
+
+   return "";
+}
+
+static std::optional<gpu::TilingSettings::SimdLevel>
+translateRetileSimdLevel(const std::string &text)
+{
+   if (text == "auto") {
+      return gpu::TilingSettings::Auto;
+   } else if (text == "none") {
+      return gpu::TilingSettings::None;
+   } else if (text == "sse2") {
+      return gpu::TilingSettings::SSE2;
+   } else if (text == "avx2") {
+      return gpu::TilingSettings::AVX2;
+   }
+
+   return { };
+}
+
 static const char *
 translateViewMode(gpu::DisplaySettings::ViewMode mode)
 {
@@ -92,13 +124,20 @@ loadFromTOML(std::shared_ptr<cpptoml::table> config,
 {
    readValue(config, "mem.writetrack", cpuSettings.memory.writeTrackEnabled);
 
+   readValue(config, "time.fast_forward", cpuSettings.time.fastForward);
+   readValue(config, "time.fast_forward_idle_delay_us", cpuSettings.time.fastForwardIdleDelayUs);
+
    readValue(config, "jit.enabled", cpuSettings.jit.enabled);
    readValue(config, "jit.verify", cpuSettings.jit.verify);
    readValue(config, "jit.verify_addr", cpuSettings.jit.verifyAddress);
    readValue(config, "jit.code_cache_size_mb", cpuSettings.jit.codeCacheSizeMB);
    readValue(config, "jit.data_cache_size_mb", cpuSettings.jit.dataCacheSizeMB);
+   readValue(config, "jit.compile_threads", cpuSettings.jit.compileThreads);
+   readValue(config, "jit.cache_directory", cpuSettings.jit.cacheDirectory);
    readArray(config, "jit.opt_flags", cpuSettings.jit.optimisationFlags);
    readValue(config, "jit.rodata_read_only", cpuSettings.jit.rodataReadOnly);
+   readValue(config, "jit.tier_threshold", cpuSettings.jit.tierThreshold);
+   readArray(config, "jit.baseline_opt_flags", cpuSettings.jit.baselineOptimisationFlags);
    return true;
 }
 
@@ -120,12 +159,14 @@ loadFromTOML(std::shared_ptr<cpptoml::table> config,
    readValue(config, "log.directory", decafSettings.log.directory);
    readValue(config, "log.hle_trace", decafSettings.log.hle_trace);
    readValue(config, "log.hle_trace_res", decafSettings.log.hle_trace_res);
+   readValue(config, "log.hle_trace_binary", decafSettings.log.hle_trace_binary);
    readArray(config, "log.hle_trace_filters", decafSettings.log.hle_trace_filters);
    readValue(config, "log.level", decafSettings.log.level);
    readValue(config, "log.to_file", decafSettings.log.to_file);
    readValue(config, "log.to_stdout", decafSettings.log.to_stdout);
 
    readValue(config, "sound.dump_sounds", decafSettings.sound.dump_sounds);
+   readValue(config, "sound.decode_threads", decafSettings.sound.decode_threads);
 
    readValue(config, "system.region", decafSettings.system.region);
    readValue(config, "system.hfio_path", decafSettings.system.hfio_path);
@@ -148,6 +189,17 @@ loadFromTOML(std::shared_ptr<cpptoml::table> config,
    readValue(config, "gpu.debug", gpuSettings.debug.debug_enabled);
    readValue(config, "gpu.dump_shaders", gpuSettings.debug.dump_shaders);
    readValue(config, "gpu.dump_shader_binaries_only", gpuSettings.debug.dump_shader_binaries_only);
+   readValue(config, "gpu.cache_directory", gpuSettings.cache.directory);
+   readValue(config, "gpu.log_skipped_draws", gpuSettings.debug.log_skipped_draws);
+   readValue(config, "gpu.pipeline_compile_threads", gpuSettings.pipeline.compile_threads);
+   readValue(config, "gpu.pipeline_compile_wait_ms", gpuSettings.pipeline.compile_wait_ms);
+   readValue(config, "gpu.cpu_retile_threads", gpuSettings.tiling.cpu_retile_threads);
+
+   if (auto text = config->get_qualified_as<std::string>("gpu.cpu_retile_simd"); text) {
+      if (auto level = translateRetileSimdLevel(*text); level) {
+         gpuSettings.tiling.cpu_retile_simd = *level;
+      }
+   }
 
    auto display = config->get_table("display");
    if (display) {
@@ -205,7 +257,10 @@ saveToTOML(std::shared_ptr<cpptoml::table> config,
    jit->insert("verify_addr", cpuSettings.jit.verifyAddress);
    jit->insert("code_cache_size_mb", cpuSettings.jit.codeCacheSizeMB);
    jit->insert("data_cache_size_mb", cpuSettings.jit.dataCacheSizeMB);
+   jit->insert("compile_threads", cpuSettings.jit.compileThreads);
+   jit->insert("cache_directory", cpuSettings.jit.cacheDirectory);
    jit->insert("rodata_read_only", cpuSettings.jit.rodataReadOnly);
+   jit->insert("tier_threshold", cpuSettings.jit.tierThreshold);
 
    auto opt_flags = cpptoml::make_array();
    for (auto &flag : cpuSettings.jit.optimisationFlags) {
@@ -213,7 +268,24 @@ saveToTOML(std::shared_ptr<cpptoml::table> config,
    }
 
    jit->insert("opt_flags", opt_flags);
+
+   auto baseline_opt_flags = cpptoml::make_array();
+   for (auto &flag : cpuSettings.jit.baselineOptimisationFlags) {
+      baseline_opt_flags->push_back(flag);
+   }
+
+   jit->insert("baseline_opt_flags", baseline_opt_flags);
    config->insert("jit", jit);
+
+   // time
+   auto time = config->get_table("time");
+   if (!time) {
+      time = cpptoml::make_table();
+   }
+
+   time->insert("fast_forward", cpuSettings.time.fastForward);
+   time->insert("fast_forward_idle_delay_us", cpuSettings.time.fastForwardIdleDelayUs);
+   config->insert("time", time);
    return true;
 }
 
@@ -255,6 +327,7 @@ saveToTOML(std::shared_ptr<cpptoml::table> config,
    log->insert("directory", decafSettings.log.directory);
    log->insert("hle_trace", decafSettings.log.hle_trace);
    log->insert("hle_trace_res", decafSettings.log.hle_trace_res);
+   log->insert("hle_trace_binary", decafSettings.log.hle_trace_binary);
    log->insert("level", decafSettings.log.level);
    log->insert("to_file", decafSettings.log.to_file);
    log->insert("to_stdout", decafSettings.log.to_stdout);
@@ -274,6 +347,7 @@ saveToTOML(std::shared_ptr<cpptoml::table> config,
    }
 
    sound->insert("dump_sounds", decafSettings.sound.dump_sounds);
+   sound->insert("decode_threads", decafSettings.sound.decode_threads);
    config->insert("sound", sound);
 
    // system
@@ -322,6 +396,12 @@ saveToTOML(std::shared_ptr<cpptoml::table> config,
    gpu->insert("debug", gpuSettings.debug.debug_enabled);
    gpu->insert("dump_shaders", gpuSettings.debug.dump_shaders);
    gpu->insert("dump_shader_binaries_only", gpuSettings.debug.dump_shader_binaries_only);
+   gpu->insert("cache_directory", gpuSettings.cache.directory);
+   gpu->insert("log_skipped_draws", gpuSettings.debug.log_skipped_draws);
+   gpu->insert("pipeline_compile_threads", gpuSettings.pipeline.compile_threads);
+   gpu->insert("pipeline_compile_wait_ms", gpuSettings.pipeline.compile_wait_ms);
+   gpu->insert("cpu_retile_threads", gpuSettings.tiling.cpu_retile_threads);
+   gpu->insert("cpu_retile_simd", translateRetileSimdLevel(gpuSettings.tiling.cpu_retile_simd));
 
    config->insert("gpu", gpu);
 
@@ -24,6 +24,12 @@ struct JitSettings
    //! JIT data cache size in megabytes
    unsigned int dataCacheSizeMB = 512;
 
+   //! Number of background compilation threads, 0 to compile on the guest core
+   unsigned int compileThreads = 0;
+
+   //! Directory to store translated code in between runs, empty to disable
+   std::string cacheDirectory;
+
    //! List of JIT optimizations to enable
    std::vector<std::string> optimisationFlags =
    {
@@ -39,6 +45,17 @@ struct JitSettings
       "X86_STORE_IMMEDIATE",
    };
 
+   //! Number of times a block must be entered before it is retranslated
+   //! with optimisationFlags, 0 disables tiered compilation
+   unsigned int tierThreshold = 0;
+
+   //! List of JIT optimizations used for the first translation of a block
+   //! when tiered compilation is enabled
+   std::vector<std::string> baselineOptimisationFlags =
+   {
+      "BASIC",
+   };
+
    //! Treat .rodata sections as read-only regardless of RPL/RPX flags
    bool rodataReadOnly = true;
 };
@@ -49,10 +66,23 @@ struct MemorySettings
    bool writeTrackEnabled = false;
 };
 
+struct TimeSettings
+{
+   //! Skip ahead to the next alarm whenever every core is idle, so the
+   //! timebase only advances whilst guest code is running
+   bool fastForward = false;
+
+   //! How long every core must have been idle, in microseconds, before
+   //! skipping ahead. This gives host threads (GPU, IOS) a chance to raise
+   //! the interrupt the cores are waiting for first.
+   unsigned int fastForwardIdleDelayUs = 200;
+};
+
 struct Settings
 {
    JitSettings jit;
    MemorySettings memory;
+   TimeSettings time;
 };
 
 std::shared_ptr<const Settings> config();
@@ -31,6 +31,10 @@ void
 addJitReadOnlyRange(uint32_t address,
                     uint32_t size);
 
+void
+addJitCodeRange(uint32_t address,
+                uint32_t size);
+
 void
 interrupt(int core_idx,
           uint32_t flags);
@@ -2,7 +2,9 @@
 #include "espresso_spr.h"
 #include <common/bitutils.h>
 #include <common/decaf_assert.h>
+#include <common/platform_compiler.h>
 #include <algorithm>
+#include <array>
 
 namespace espresso
 {
@@ -70,6 +72,49 @@ sAliasData;
 static TableEntry
 sInstructionTable;
 
+/*
+ * The flat decode tables are generated from sInstructionTable by
+ * initialiseDecodeTables.
+ *
+ * The primary table is indexed by opcd, if the instruction is not fully
+ * identified by opcd then it points to a secondary table which is indexed by
+ * bits 21-31, which covers all of the extended opcode fields and the reserved
+ * bit 31.
+ *
+ * Any remaining opcode fields, such as reserved register fields which must be
+ * zero, are checked with checkMask and checkValue.
+ */
+struct DecodeEntry
+{
+   InstructionInfo *instr = nullptr;
+   uint32_t checkMask = 0;
+   uint32_t checkValue = 0;
+
+   //! Decoding depends on more than the indexed bits, walk sInstructionTable.
+   bool useTable = false;
+};
+
+struct PrimaryDecodeEntry
+{
+   //! Index into sDecodeEntries.
+   uint16_t entry = 0;
+
+   //! One-based index into sSecondaryDecodeTables, 0 if there is none.
+   uint16_t secondaryTable = 0;
+};
+
+static constexpr auto PrimaryDecodeShift = 26u;
+static constexpr auto SecondaryDecodeMask = 0x7FFu;
+
+static std::vector<DecodeEntry>
+sDecodeEntries;
+
+static std::array<PrimaryDecodeEntry, 64>
+sPrimaryDecodeTable;
+
+static std::vector<std::array<uint16_t, SecondaryDecodeMask + 1>>
+sSecondaryDecodeTables;
+
 #define FLD(x, y, z, ...) {y, z},
 #define MRKR(x, ...) {-1, -1},
 static std::pair<int, int>
@@ -171,9 +216,9 @@ encodeSPR(Instruction &instr, SPR spr)
    instr.spr = ((sprInt << 5) & 0x3E0) | ((sprInt >> 5) & 0x1F);
 }
 
-// Decode Instruction to InstructionInfo
+// Decode Instruction to InstructionInfo by walking sInstructionTable
 InstructionInfo *
-decodeInstruction(Instruction instr)
+decodeInstructionTree(Instruction instr)
 {
    auto table = &sInstructionTable;
 
@@ -195,6 +240,29 @@ decodeInstruction(Instruction instr)
    return nullptr;
 }
 
+// Decode Instruction to InstructionInfo
+InstructionInfo *
+decodeInstruction(Instruction instr)
+{
+   auto &primary = sPrimaryDecodeTable[instr.value >> PrimaryDecodeShift];
+   auto index = primary.entry;
+
+   if (primary.secondaryTable) {
+      index = sSecondaryDecodeTables[primary.secondaryTable - 1][instr.value & SecondaryDecodeMask];
+   }
+
+   auto &entry = sDecodeEntries[index];
+   if (UNLIKELY(entry.useTable)) {
+      return decodeInstructionTree(instr);
+   }
+
+   if ((instr.value & entry.checkMask) != entry.checkValue) {
+      return nullptr;
+   }
+
+   return entry.instr;
+}
+
 // Encode specified instruction
 Instruction
 encodeInstruction(InstructionID id)
@@ -288,6 +356,138 @@ initialiseInstructionTable()
    }
 }
 
+// Find or add a DecodeEntry, returning its index in sDecodeEntries
+static uint16_t
+addDecodeEntry(const DecodeEntry &entry)
+{
+   for (auto i = 0u; i < sDecodeEntries.size(); ++i) {
+      auto &other = sDecodeEntries[i];
+
+      if (other.instr == entry.instr &&
+          other.checkMask == entry.checkMask &&
+          other.checkValue == entry.checkValue &&
+          other.useTable == entry.useTable) {
+         return static_cast<uint16_t>(i);
+      }
+   }
+
+   decaf_check(sDecodeEntries.size() <= 0xFFFF);
+   sDecodeEntries.push_back(entry);
+   return static_cast<uint16_t>(sDecodeEntries.size() - 1);
+}
+
+// Convert a subtree of sInstructionTable which contains a single instruction
+// into a DecodeEntry which checks every field on the path to it
+static DecodeEntry
+resolveDecodeChain(const TableEntry *table)
+{
+   auto entry = DecodeEntry { };
+
+   while (table->fieldMaps.size()) {
+      if (table->instr || table->fieldMaps.size() != 1) {
+         entry.useTable = true;
+         return entry;
+      }
+
+      auto &fieldMap = table->fieldMaps.front();
+      auto next = static_cast<const TableEntry *>(nullptr);
+      auto value = 0u;
+
+      for (auto i = 0u; i < fieldMap.children.size(); ++i) {
+         auto &child = fieldMap.children[i];
+
+         if (child.instr || child.fieldMaps.size()) {
+            if (next) {
+               entry.useTable = true;
+               return entry;
+            }
+
+            next = &child;
+            value = i;
+         }
+      }
+
+      if (!next || fieldMap.field == InstructionField::spr) {
+         entry.useTable = true;
+         return entry;
+      }
+
+      entry.checkMask |= getInstructionFieldBitmask(fieldMap.field);
+      entry.checkValue |= value << getInstructionFieldStart(fieldMap.field);
+      table = next;
+   }
+
+   entry.instr = table->instr;
+   return entry;
+}
+
+// Walk sInstructionTable in the same way as decodeInstructionTree, for as
+// long as it only looks at fields within knownMask
+static DecodeEntry
+resolveDecodeEntry(Instruction instr,
+                   uint32_t knownMask)
+{
+   auto table = static_cast<const TableEntry *>(&sInstructionTable);
+
+   while (table->fieldMaps.size()) {
+      auto fieldsKnown =
+         std::all_of(table->fieldMaps.begin(), table->fieldMaps.end(),
+                     [knownMask](const auto &fieldMap) {
+                        return (getInstructionFieldBitmask(fieldMap.field) & ~knownMask) == 0;
+                     });
+
+      if (!fieldsKnown) {
+         return resolveDecodeChain(table);
+      }
+
+      for (auto &fieldMap : table->fieldMaps) {
+         auto value = getInstructionFieldValue(fieldMap.field, instr);
+         table = &fieldMap.children[value];
+
+         if (table->instr || table->fieldMaps.size()) {
+            break;
+         }
+      }
+   }
+
+   auto entry = DecodeEntry { };
+   entry.instr = table->instr;
+   return entry;
+}
+
+// Generate the flat decode tables from sInstructionTable
+static void
+initialiseDecodeTables()
+{
+   auto primaryMask = getInstructionFieldBitmask(InstructionField::opcd);
+
+   // Entry 0 is always the invalid instruction
+   sDecodeEntries.clear();
+   sDecodeEntries.emplace_back();
+   sSecondaryDecodeTables.clear();
+
+   for (auto opcd = 0u; opcd < sPrimaryDecodeTable.size(); ++opcd) {
+      auto instr = Instruction { opcd << PrimaryDecodeShift };
+      auto &primary = sPrimaryDecodeTable[opcd];
+      auto entry = resolveDecodeEntry(instr, primaryMask);
+
+      if (!entry.useTable) {
+         primary.entry = addDecodeEntry(entry);
+         primary.secondaryTable = 0;
+         continue;
+      }
+
+      auto &secondary = sSecondaryDecodeTables.emplace_back();
+      primary.entry = 0;
+      primary.secondaryTable = static_cast<uint16_t>(sSecondaryDecodeTables.size());
+
+      for (auto xo = 0u; xo <= SecondaryDecodeMask; ++xo) {
+         entry = resolveDecodeEntry(instr.value | xo, primaryMask | SecondaryDecodeMask);
+         secondary[xo] = addDecodeEntry(entry);
+      }
+   }
+}
+
 static std::string
 cleanInsName(const std::string& name)
 {
@@ -386,6 +586,9 @@ initialiseInstructionSet()
 
    // Create instruction table
    initialiseInstructionTable();
+
+   // Flatten the instruction table for decodeInstruction
+   initialiseDecodeTables();
 };
 
 #undef INS
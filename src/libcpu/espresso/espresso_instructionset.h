@@ -66,6 +66,9 @@ initialiseInstructionSet();
 InstructionInfo *
 decodeInstruction(Instruction instr);
 
+InstructionInfo *
+decodeInstructionTree(Instruction instr);
+
 Instruction
 encodeInstruction(InstructionID id);
 
@@ -4,6 +4,7 @@
 #include <common/platform.h>
 #include <cstdint>
 #include <gsl.h>
+#include <vector>
 
 #ifdef PLATFORM_WINDOWS
 #define WIN32_LEAN_AND_MEAN
@@ -50,6 +51,15 @@ struct CodeBlock
    //! Profiling data.
    CodeBlockProfileData profileData;
 
+   //! Backend specific translation tier.
+   uint32_t tier;
+
+   //! Number of times the block was entered, only counted for some tiers.
+   std::atomic<uint32_t> executionCount;
+
+   //! Set once the block has been replaced by a retranslation.
+   std::atomic<bool> superseded;
+
    //! Code block unwind info, only used on Windows.
    CodeBlockUnwindInfo unwindInfo;
 };
@@ -65,7 +75,7 @@ struct JitStats
    uint64_t totalTimeInCodeBlocks = 0;
    uint64_t usedCodeCacheSize = 0;
    uint64_t usedDataCacheSize = 0;
-   gsl::span<CodeBlock> compiledBlocks;
+   std::vector<CodeBlock *> compiledBlocks;
 };
 
 bool
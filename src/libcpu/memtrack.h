@@ -45,4 +45,12 @@ MemtrackState
 getMemoryState(PhysicalAddress physicalAddress,
                uint32_t size);
 
+void
+beginHostWrite(PhysicalAddress physicalAddress,
+               uint32_t size);
+
+void
+endHostWrite(PhysicalAddress physicalAddress,
+             uint32_t size);
+
 } // namespace cpu
@@ -58,6 +58,10 @@ initialise()
       };
       backend->setOptFlags(settings->jit.optimisationFlags);
       backend->setVerifyEnabled(settings->jit.verify, settings->jit.verifyAddress);
+      backend->setTieredCompilation(settings->jit.baselineOptimisationFlags,
+                                    settings->jit.tierThreshold);
+      backend->setCompileThreads(settings->jit.compileThreads);
+      backend->setPersistentCacheDirectory(settings->jit.cacheDirectory);
       jit::setBackend(backend);
    }
 
@@ -68,6 +72,7 @@ void
 clearInstructionCache()
 {
    cpu::jit::clearCache(0, 0xFFFFFFFF);
+   interpreter::clearBlockCache();
 }
 
 void
@@ -75,6 +80,9 @@ invalidateInstructionCache(uint32_t address,
                            uint32_t size)
 {
    cpu::jit::clearCache(address, size);
+
+   // The interpreter's block cache is cheap to rebuild, so clear all of it.
+   interpreter::clearBlockCache();
 }
 
 void
@@ -84,6 +92,13 @@ addJitReadOnlyRange(uint32_t address,
    jit::addReadOnlyRange(address, size);
 }
 
+void
+addJitCodeRange(uint32_t address,
+                uint32_t size)
+{
+   jit::addCodeRange(address, size);
+}
+
 void
 coreEntryPoint(Core *core)
 {
@@ -173,7 +188,7 @@ tbToTimePoint(uint64_t ticks)
 uint64_t
 Core::tb()
 {
-   auto now = std::chrono::steady_clock::now();
+   auto now = internal::now();
    auto ticks = std::chrono::duration_cast<TimerDuration>(now - sStartupTime);
    return ticks.count();
 }
@@ -1,8 +1,10 @@
 #include "cpu.h"
 #include "cpu_alarm.h"
 #include "cpu_breakpoints.h"
+#include "cpu_config.h"
 #include "cpu_internal.h"
 
+#include <algorithm>
 #include <common/decaf_assert.h>
 #include <common/platform_thread.h>
 #include <atomic>
@@ -16,17 +18,65 @@ struct
    std::mutex mutex;
    std::condition_variable cv;
    std::thread thread;
+
+   //! Whether to skip ahead to the next alarm when every core is idle
+   bool fastForward = false;
+
+   //! How long every core must be idle before skipping ahead
+   std::chrono::microseconds fastForwardIdleDelay { 0 };
+
+   //! Total amount of time skipped, guest time is host time plus this
+   std::atomic<int64_t> skippedNanos { 0 };
+
+   //! Number of cores currently waiting for an interrupt
+   std::atomic<int> idleCores { 0 };
+
+   //! Incremented every time a core stops waiting for an interrupt
+   std::atomic<uint64_t> wakeCount { 0 };
 } sAlarmData;
 
 namespace cpu::internal
 {
 
+static std::chrono::nanoseconds
+skippedTime()
+{
+   return std::chrono::nanoseconds { sAlarmData.skippedNanos.load(std::memory_order_relaxed) };
+}
+
+
+/**
+ * Returns true if every core is waiting for an interrupt and none of them
+ * have an interrupt pending which is about to wake them up.
+ */
+static bool
+allCoresIdle()
+{
+   if (sAlarmData.idleCores.load() != 3) {
+      return false;
+   }
+
+   for (auto i = 0; i < 3; ++i) {
+      auto core = getCore(i);
+      auto mask = core->interrupt_mask | NONMASKABLE_INTERRUPTS;
+
+      if (core->interrupt.load() & mask) {
+         return false;
+      }
+   }
+
+   return true;
+}
+
 static void
 alarmEntryPoint()
 {
+   auto idleSince = std::chrono::steady_clock::time_point { };
+   auto idleWakeCount = uint64_t { 0 };
+
    while (sAlarmData.running) {
       std::unique_lock<std::mutex> lock{ sAlarmData.mutex };
-      auto now = std::chrono::steady_clock::now();
+      auto now = internal::now();
       auto next = std::chrono::steady_clock::time_point::max();
       bool timedWait = false;
 
@@ -42,18 +92,67 @@ alarmEntryPoint()
          }
       }
 
+      if (!sAlarmData.fastForward) {
+         if (timedWait) {
+            sAlarmData.cv.wait_until(lock, next);
+         } else {
+            sAlarmData.cv.wait(lock);
+         }
+
+         continue;
+      }
+
+      // Cores do not notify us when they go idle, so poll for it instead.
+      auto hostNow = std::chrono::steady_clock::now();
+
+      if (!timedWait || !allCoresIdle()) {
+         idleSince = { };
+      } else if (idleSince == std::chrono::steady_clock::time_point { } ||
+                 idleWakeCount != sAlarmData.wakeCount.load()) {
+         idleSince = hostNow;
+         idleWakeCount = sAlarmData.wakeCount.load();
+      } else if (hostNow - idleSince >= sAlarmData.fastForwardIdleDelay) {
+         // Nothing can happen until the next alarm, so skip straight to it.
+         auto skip = std::chrono::duration_cast<std::chrono::nanoseconds>(next - now);
+         sAlarmData.skippedNanos.fetch_add(skip.count());
+         idleSince = { };
+         continue;
+      }
+
+      auto until = hostNow + sAlarmData.fastForwardIdleDelay;
       if (timedWait) {
-         sAlarmData.cv.wait_until(lock, next);
-      } else {
-         sAlarmData.cv.wait(lock);
+         until = std::min(until, next - skippedTime());
       }
+
+      sAlarmData.cv.wait_until(lock, until);
    }
 }
 
+std::chrono::steady_clock::time_point
+now()
+{
+   return std::chrono::steady_clock::now() + skippedTime();
+}
+
+void
+enterIdle()
+{
+   sAlarmData.idleCores.fetch_add(1);
+}
+
+void
+leaveIdle()
+{
+   sAlarmData.wakeCount.fetch_add(1);
+   sAlarmData.idleCores.fetch_sub(1);
+}
+
 void
 startAlarmThread()
 {
    decaf_check(!sAlarmData.running.load());
+   sAlarmData.fastForward = config()->time.fastForward;
+   sAlarmData.fastForwardIdleDelay = std::chrono::microseconds { config()->time.fastForwardIdleDelayUs };
    sAlarmData.running = true;
    sAlarmData.thread = std::thread { alarmEntryPoint };
    platform::setThreadName(&sAlarmData.thread, "CPU Alarm Thread");
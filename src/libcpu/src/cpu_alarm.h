@@ -1,8 +1,16 @@
 #pragma once
+#include <chrono>
 
 namespace cpu::internal
 {
 
+//! The current guest time, which runs ahead of the host clock when
+//! fast forwarding has skipped idle time.
+std::chrono::steady_clock::time_point now();
+
+void enterIdle();
+void leaveIdle();
+
 void startAlarmThread();
 void joinAlarmThread();
 void stopAlarmThread();
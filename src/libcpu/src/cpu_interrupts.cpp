@@ -1,4 +1,5 @@
 #include "cpu.h"
+#include "cpu_alarm.h"
 #include "cpu_breakpoints.h"
 #include "cpu_internal.h"
 
@@ -87,7 +88,9 @@ waitForInterrupt()
          sUserInterruptHandler(core, flags);
          lock.lock();
       } else {
+         internal::enterIdle();
          sInterruptCondition.wait(lock);
+         internal::leaveIdle();
       }
    }
 }
@@ -107,7 +110,9 @@ waitNextInterrupt(std::chrono::steady_clock::time_point until)
 
    if (!(flags & mask)) {
       if (until == std::chrono::steady_clock::time_point { }) {
+         internal::enterIdle();
          sInterruptCondition.wait(lock);
+         internal::leaveIdle();
       } else {
          sInterruptCondition.wait_until(lock, until);
       }
@@ -1,19 +1,155 @@
 #include "memtrack.h"
 #include "mmu.h"
 
-#include <common/datahash.h>
 #include <common/platform.h>
 #ifdef PLATFORM_POSIX
 
+#include "cpu_config.h"
+#include "cpu_internal.h"
+
+#include <algorithm>
+#include <atomic>
+#include <common/datahash.h>
+#include <common/log.h>
+#include <common/platform_compiler.h>
+#include <common/platform_exception.h>
+#include <common/rangecombiner.h>
+#include <cstring>
+#include <errno.h>
+#include <fmt/core.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
 namespace cpu
 {
 
+static constexpr uint64_t PhysTrackSetBit = 0x8000000000000000;
+static constexpr uint64_t PhysIsMappedBit = 0x4000000000000000;
+static constexpr uint32_t VirtTrackSetBit = 0x80000000;
+static constexpr uint32_t VirtIsMappedBit = 0x40000000;
+
+struct MappedArea
+{
+   cpu::VirtualAddress virtAddr;
+   cpu::PhysicalAddress physAddr;
+   uint32_t size;
+};
+
+struct HostWrite
+{
+   cpu::PhysicalAddress physAddr;
+   uint32_t size;
+};
+
+static uintptr_t sPhysBaseAddress = 0;
+static uintptr_t sVirtBaseAddress = 0;
+static uint64_t sPageSizeBits = 0;
+static std::atomic<uint32_t> *sVirtLookup = nullptr;
+static std::atomic<uint64_t> *sTrackCount = nullptr;
+static std::vector<MappedArea> sVirtMap;
+static std::vector<HostWrite> sHostWrites;
+
+//! Protects sVirtMap and sHostWrites, and is held whilst changing protection
+//! outside of the fault handler.
+static std::mutex sVirtMapMutex;
+
 namespace internal
 {
 
+/**
+ * Called directly from the SIGSEGV handler, so must only use atomics and
+ * async signal safe functions.
+ *
+ * As on Windows both the virtual and physical views of memory are write
+ * protected, a fault anywhere else is left for the other exception handlers.
+ */
+static bool
+writeFaultFilter(uint64_t address)
+{
+   auto trackIdx = uint64_t { 0 };
+   auto isVirtual = false;
+
+   // We do not verify that the SET bit is set since another thread may be
+   // racing us to handle a fault on the same page, we only check that the page
+   // was mapped so we do not swallow genuine guest segfaults.
+   if (address >= sVirtBaseAddress && address < sVirtBaseAddress + 0x100000000) {
+      auto lookupValue = sVirtLookup[(address - sVirtBaseAddress) >> sPageSizeBits].load();
+      if (!(lookupValue & VirtIsMappedBit)) {
+         return false;
+      }
+
+      trackIdx = lookupValue & ~(VirtTrackSetBit | VirtIsMappedBit);
+      isVirtual = true;
+   } else if (address >= sPhysBaseAddress && address < sPhysBaseAddress + 0x100000000) {
+      trackIdx = (address - sPhysBaseAddress) >> sPageSizeBits;
+      if (!(sTrackCount[trackIdx].load() & PhysIsMappedBit)) {
+         return false;
+      }
+   } else {
+      return false;
+   }
+
+   // Unprotect the page before clearing the SET bit. Done the other way round
+   // a getMemoryState between the two would see SET clear and protect the
+   // page, only for us to then unprotect it whilst SET is still set, after
+   // which writes to the page would never be tracked again.
+   auto pageSize = uint64_t { 1 } << sPageSizeBits;
+   auto pagePtr = reinterpret_cast<void *>(address & ~(pageSize - 1));
+   auto savedErrno = errno;
+   auto result = mprotect(pagePtr, pageSize, PROT_READ | PROT_WRITE);
+   errno = savedErrno;
+
+   if (result != 0) {
+      return false;
+   }
+
+   if (isVirtual) {
+      sVirtLookup[(address - sVirtBaseAddress) >> sPageSizeBits].fetch_and(~VirtTrackSetBit);
+   } else {
+      sTrackCount[trackIdx].fetch_and(~PhysTrackSetBit);
+   }
+
+   // Increment the counter of the physical page to mark it as having changed,
+   // this must happen before the write itself is retried.
+   sTrackCount[trackIdx].fetch_add(1);
+   return true;
+}
+
 void
 initialiseMemtrack()
 {
+   if (!config()->memory.writeTrackEnabled) {
+      return;
+   }
+
+   auto pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+   auto pageSizeBits = 0;
+   auto i = pageSize;
+   while (i >>= 1) pageSizeBits++;
+
+   sPhysBaseAddress = cpu::getBasePhysicalAddress();
+   sVirtBaseAddress = cpu::getBaseVirtualAddress();
+   sPageSizeBits = pageSizeBits;
+
+   auto numtrackTableEntries = 0x100000000 >> pageSizeBits;
+
+   // Initialise the lookup table to all unmapped
+   sVirtLookup = new std::atomic<uint32_t>[numtrackTableEntries];
+   memset(sVirtLookup, 0x00, numtrackTableEntries * sizeof(uint32_t));
+
+   // Initialise the tracking table to all 0's
+   sTrackCount = new std::atomic<uint64_t>[numtrackTableEntries];
+   memset(sTrackCount, 0x00, numtrackTableEntries * sizeof(uint64_t));
+
+   if (!platform::installAccessViolationFilter(writeFaultFilter)) {
+      gLog->error("Could not install write tracking fault handler, falling back to hashing");
+      delete[] sVirtLookup;
+      delete[] sTrackCount;
+      sVirtLookup = nullptr;
+      sTrackCount = nullptr;
+   }
 }
 
 void
@@ -21,30 +157,356 @@ registerTrackedRange(VirtualAddress virtualAddress,
                      PhysicalAddress physicalAddress,
                      uint32_t size)
 {
+   if (!sTrackCount) {
+      return;
+   }
+
+   if (size == 0) {
+      return;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock { sVirtMapMutex };
+
+      // As on Windows we drop any conflicting virtual mappings rather than
+      // trying to split them.
+      for (auto iter = sVirtMap.begin(); iter != sVirtMap.end(); ) {
+         if (virtualAddress >= iter->virtAddr && virtualAddress < iter->virtAddr + iter->size) {
+            iter = sVirtMap.erase(iter);
+         } else {
+            ++iter;
+         }
+      }
+
+      sVirtMap.push_back({ virtualAddress, physicalAddress, size });
+   }
+
+   // Apply the neccessary changes to the tracking tables
+   auto firstPhysPage = physicalAddress.getAddress() >> sPageSizeBits;
+   auto firstPage = virtualAddress.getAddress() >> sPageSizeBits;
+   auto lastPage = (virtualAddress.getAddress() + (size - 1)) >> sPageSizeBits;
+
+   for (auto pageIdx = firstPage, physPageIdx = firstPhysPage;
+        pageIdx <= lastPage;
+        ++pageIdx, ++physPageIdx)
+   {
+      auto oldPhysPage = sVirtLookup[pageIdx].exchange(static_cast<uint32_t>(VirtIsMappedBit | physPageIdx));
+      if (oldPhysPage & VirtIsMappedBit) {
+         decaf_abort("write tracker attempted to register an already registered page");
+      }
+
+      // The new mapping is not protected yet, so mark the physical page as
+      // changed and let the next getMemoryState apply the protection.
+      sTrackCount[physPageIdx].fetch_add(1);
+   }
 }
 
 void
 unregisterTrackedRange(VirtualAddress virtualAddress,
                        uint32_t size)
 {
+   if (!sTrackCount) {
+      return;
+   }
+
+   if (size == 0) {
+      return;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock { sVirtMapMutex };
+
+      for (auto iter = sVirtMap.begin(); iter != sVirtMap.end(); ++iter) {
+         if (iter->virtAddr == virtualAddress && iter->size == size) {
+            sVirtMap.erase(iter);
+            break;
+         }
+      }
+   }
+
+   // The view itself has already been unmapped by the memory map, so there is
+   // no protection to undo, only the lookup table to clear.
+   auto firstPage = virtualAddress.getAddress() >> sPageSizeBits;
+   auto lastPage = firstPage + ((size - 1) >> sPageSizeBits);
+
+   for (auto pageIdx = firstPage; pageIdx <= lastPage; ++pageIdx) {
+      auto oldPhysPage = sVirtLookup[pageIdx].exchange(0x00000000);
+      if (!(oldPhysPage & VirtIsMappedBit)) {
+         decaf_abort("write tracker attempted to unregister an already unregister page");
+      }
+   }
 }
 
 void
 clearTrackedRanges()
 {
+   if (!sTrackCount) {
+      return;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock { sVirtMapMutex };
+      sVirtMap.clear();
+   }
+
+   auto numtrackTableEntries = 0x100000000 >> sPageSizeBits;
+   memset(sVirtLookup, 0x00, numtrackTableEntries * sizeof(uint32_t));
 }
 
 } // namespace internal
 
+static void
+protectRange(uint8_t *ptr,
+             uint64_t size,
+             int protection)
+{
+   if (mprotect(ptr, size, protection) != 0) {
+      decaf_abort(fmt::format("Attempted to write-track a weird page, mprotect failed with error: {}",
+                              strerror(errno)));
+   }
+}
+
+static bool
+isHostWriteInProgress(PhysicalAddress physicalAddress,
+                      uint32_t size)
+{
+   for (auto &write : sHostWrites) {
+      if (physicalAddress < write.physAddr + write.size &&
+          write.physAddr < physicalAddress + size) {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+
+/**
+ * Calls func(pagePtr, lookupIdx) for each page of every virtual view of the
+ * physical range. Must be called with sVirtMapMutex held.
+ */
+template<typename Func>
+static void
+forEachVirtualPage(PhysicalAddress physicalAddress,
+                   uint32_t size,
+                   Func &&func)
+{
+   auto pageSize = uint64_t { 1 } << sPageSizeBits;
+
+   for (auto &area : sVirtMap) {
+      if (physicalAddress < area.physAddr || physicalAddress >= area.physAddr + area.size) {
+         continue;
+      }
+
+      auto virtualAddress = area.virtAddr + (physicalAddress - area.physAddr);
+      auto areaRemaining = static_cast<uint32_t>(area.size - (physicalAddress - area.physAddr));
+
+      uintptr_t startAddr = virtualAddress.getAddress();
+      uintptr_t endAddr = startAddr + (std::min(size, areaRemaining) - 1);
+
+      auto startPage = startAddr >> sPageSizeBits;
+      auto lastPage = endAddr >> sPageSizeBits;
+      auto pagePtr = reinterpret_cast<uint8_t *>(sVirtBaseAddress + (startPage << sPageSizeBits));
+
+      for (auto i = startPage; i <= lastPage; ++i, pagePtr += pageSize) {
+         func(pagePtr, i);
+      }
+   }
+}
+
+
+/**
+ * Calls func(pagePtr, trackIdx) for each page of the physical view of the
+ * physical range.
+ */
+template<typename Func>
+static void
+forEachPhysicalPage(PhysicalAddress physicalAddress,
+                    uint32_t size,
+                    Func &&func)
+{
+   auto pageSize = uint64_t { 1 } << sPageSizeBits;
+   auto startPage = physicalAddress.getAddress() >> sPageSizeBits;
+   auto lastPage = (physicalAddress.getAddress() + (size - 1)) >> sPageSizeBits;
+   auto pagePtr = reinterpret_cast<uint8_t *>(sPhysBaseAddress + (startPage << sPageSizeBits));
+
+   for (auto i = startPage; i <= lastPage; ++i, pagePtr += pageSize) {
+      func(pagePtr, i);
+   }
+}
+
+static void
+incrementTrackCounts(PhysicalAddress physicalAddress,
+                     uint32_t size)
+{
+   forEachPhysicalPage(physicalAddress, size,
+      [](uint8_t *, uint64_t trackIdx)
+      {
+         sTrackCount[trackIdx].fetch_add(1);
+      });
+}
+
+
+/**
+ * Returns a value which changes whenever memory in the range is written to.
+ *
+ * With write tracking enabled this is the sum of the per-page write
+ * generation counters, and both the virtual views and the physical view of
+ * the range are write protected so the next write to any page increments its
+ * counter.
+ *
+ * Without write tracking we fall back to hashing the memory.
+ */
 MemtrackState
 getMemoryState(PhysicalAddress physicalAddress,
                uint32_t size)
 {
-   // POSIX always hashes for the moment.  This is due to my inability to actually
-   // test any sort of implementation on a linux system.
-   auto physPtr = reinterpret_cast<void *>(cpu::getBasePhysicalAddress() + physicalAddress.getAddress());
-   auto hashVal = DataHash {}.write(physPtr, size);
-   return MemtrackState { hashVal.value() };
+   if (!sTrackCount) {
+      auto physPtr = reinterpret_cast<void *>(cpu::getBasePhysicalAddress() + physicalAddress.getAddress());
+      auto hashVal = DataHash {}.write(physPtr, size);
+      return MemtrackState { hashVal.value() };
+   }
+
+   if (size == 0) {
+      return MemtrackState { 0 };
+   }
+
+   // Protect before reading the counters, otherwise a write landing between
+   // the two would go unnoticed. Memory the host is writing to is left
+   // unprotected, endHostWrite increments its counters once it is done.
+   {
+      std::lock_guard<std::mutex> lock { sVirtMapMutex };
+
+      if (!isHostWriteInProgress(physicalAddress, size)) {
+         auto pageSize = uint64_t { 1 } << sPageSizeBits;
+         auto protectCombiner = makeRangeCombiner<void *, uint8_t *, uint64_t>(
+            [](void *, uint8_t *ptr, uint64_t size)
+            {
+               protectRange(ptr, size, PROT_READ);
+            });
+
+         forEachVirtualPage(physicalAddress, size,
+            [&](uint8_t *pagePtr, uint64_t lookupIdx)
+            {
+               auto oldTrackValue = sVirtLookup[lookupIdx].fetch_or(VirtTrackSetBit | VirtIsMappedBit);
+               if (!(oldTrackValue & VirtIsMappedBit)) {
+                  decaf_abort("Attempted to write-track unmapped memory");
+               }
+
+               if (!(oldTrackValue & VirtTrackSetBit)) {
+                  // If we weren't previous tracking this memory, we need to add it.
+                  protectCombiner.push(nullptr, pagePtr, pageSize);
+               }
+            });
+         protectCombiner.flush();
+
+         forEachPhysicalPage(physicalAddress, size,
+            [&](uint8_t *pagePtr, uint64_t trackIdx)
+            {
+               auto oldTrackValue = sTrackCount[trackIdx].fetch_or(PhysTrackSetBit | PhysIsMappedBit);
+               if (!(oldTrackValue & PhysTrackSetBit)) {
+                  protectCombiner.push(nullptr, pagePtr, pageSize);
+               }
+            });
+         protectCombiner.flush();
+      }
+   }
+
+   auto pageIndexTotal = uint64_t { 0 };
+   forEachPhysicalPage(physicalAddress, size,
+      [&](uint8_t *, uint64_t trackIdx)
+      {
+         pageIndexTotal += sTrackCount[trackIdx].load() & ~(PhysTrackSetBit | PhysIsMappedBit);
+      });
+
+   return MemtrackState { pageIndexTotal };
+}
+
+
+/**
+ * Must be called before the host writes to guest memory other than through
+ * normal memory accesses, e.g. a read system call into a guest buffer.
+ *
+ * The kernel does not raise a fault for a write protected page, the system
+ * call just fails with EFAULT. So the range is unprotected and marked as
+ * changed, and is not protected again until endHostWrite.
+ */
+void
+beginHostWrite(PhysicalAddress physicalAddress,
+               uint32_t size)
+{
+   if (!sTrackCount || size == 0) {
+      return;
+   }
+
+   std::lock_guard<std::mutex> lock { sVirtMapMutex };
+   sHostWrites.push_back({ physicalAddress, size });
+
+   // As in the fault handler, unprotect before clearing the SET bits.
+   auto pageSize = uint64_t { 1 } << sPageSizeBits;
+   auto unprotectCombiner = makeRangeCombiner<void *, uint8_t *, uint64_t>(
+      [](void *, uint8_t *ptr, uint64_t size)
+      {
+         protectRange(ptr, size, PROT_READ | PROT_WRITE);
+      });
+
+   forEachVirtualPage(physicalAddress, size,
+      [&](uint8_t *pagePtr, uint64_t lookupIdx)
+      {
+         if (sVirtLookup[lookupIdx].load() & VirtTrackSetBit) {
+            unprotectCombiner.push(nullptr, pagePtr, pageSize);
+         }
+      });
+   unprotectCombiner.flush();
+
+   forEachVirtualPage(physicalAddress, size,
+      [&](uint8_t *, uint64_t lookupIdx)
+      {
+         sVirtLookup[lookupIdx].fetch_and(~VirtTrackSetBit);
+      });
+
+   forEachPhysicalPage(physicalAddress, size,
+      [&](uint8_t *pagePtr, uint64_t trackIdx)
+      {
+         if (sTrackCount[trackIdx].load() & PhysTrackSetBit) {
+            unprotectCombiner.push(nullptr, pagePtr, pageSize);
+         }
+      });
+   unprotectCombiner.flush();
+
+   forEachPhysicalPage(physicalAddress, size,
+      [&](uint8_t *, uint64_t trackIdx)
+      {
+         sTrackCount[trackIdx].fetch_and(~PhysTrackSetBit);
+      });
+
+   incrementTrackCounts(physicalAddress, size);
+}
+
+
+/**
+ * Called once a write started by beginHostWrite has finished.
+ */
+void
+endHostWrite(PhysicalAddress physicalAddress,
+             uint32_t size)
+{
+   if (!sTrackCount || size == 0) {
+      return;
+   }
+
+   std::lock_guard<std::mutex> lock { sVirtMapMutex };
+
+   for (auto itr = sHostWrites.begin(); itr != sHostWrites.end(); ++itr) {
+      if (itr->physAddr == physicalAddress && itr->size == size) {
+         sHostWrites.erase(itr);
+         break;
+      }
+   }
+
+   // Anyone who read the state whilst the write was in progress must see a
+   // change once it has finished.
+   incrementTrackCounts(physicalAddress, size);
 }
 
 } // namespace cpu
@@ -9,6 +9,7 @@
 #include <common/datahash.h>
 #include <common/platform.h>
 #include <common/rangecombiner.h>
+#include <mutex>
 #include <unordered_map>
 
 #define WIN32_LEAN_AND_MEAN
@@ -29,12 +30,21 @@ struct MappedArea
    uint32_t size;
 };
 
+struct HostWrite
+{
+   cpu::PhysicalAddress physAddr;
+   uint32_t size;
+};
+
 static uintptr_t sPhysBaseAddress = 0;
 static uintptr_t sVirtBaseAddress = 0;
 static uint64_t sPageSizeBits = 0;
 static std::atomic<uint32_t> *sVirtLookup = nullptr;
 static std::atomic<uint64_t> *sTrackCount = nullptr;
 static std::vector<MappedArea> sVirtMap;
+static std::vector<HostWrite> sHostWrites;
+static std::mutex sHostWriteMutex;
+
 namespace internal
 {
 
@@ -259,7 +269,16 @@ getMemoryState(PhysicalAddress physicalAddress,
       }
    }
 
-   // Write-protect all these regions for the future
+   // Write-protect all these regions for the future, except for memory the
+   // host is currently writing to which endHostWrite will mark as changed.
+   std::lock_guard<std::mutex> lock { sHostWriteMutex };
+   for (auto &write : sHostWrites) {
+      if (physicalAddress < write.physAddr + write.size &&
+          write.physAddr < physicalAddress + size) {
+         return MemtrackState { pageIndexTotal };
+      }
+   }
+
    for (auto &area : sVirtMap) {
       if (physicalAddress < area.physAddr || physicalAddress >= area.physAddr + area.size) {
          continue;
@@ -306,6 +325,99 @@ getMemoryState(PhysicalAddress physicalAddress,
    return MemtrackState { pageIndexTotal };
 }
 
+static void
+incrementTrackCounts(PhysicalAddress physicalAddress,
+                     uint32_t size)
+{
+   uintptr_t startAddr = physicalAddress.getAddress();
+   uintptr_t endAddr = startAddr + (size - 1);
+
+   auto startPage = startAddr >> sPageSizeBits;
+   auto lastPage = endAddr >> sPageSizeBits;
+
+   for (auto i = startPage; i <= lastPage; ++i) {
+      sTrackCount[i].fetch_add(1);
+   }
+}
+
+
+/**
+ * Must be called before the host writes to guest memory other than through
+ * normal memory accesses, e.g. a ReadFile into a guest buffer.
+ *
+ * The kernel does not raise an exception for a write protected page, the
+ * call just fails. So the range is unprotected and marked as changed, and is
+ * not protected again until endHostWrite.
+ */
+void
+beginHostWrite(PhysicalAddress physicalAddress,
+               uint32_t size)
+{
+   if (!sTrackCount || size == 0) {
+      return;
+   }
+
+   std::lock_guard<std::mutex> lock { sHostWriteMutex };
+   sHostWrites.push_back({ physicalAddress, size });
+
+   for (auto &area : sVirtMap) {
+      if (physicalAddress < area.physAddr || physicalAddress >= area.physAddr + area.size) {
+         continue;
+      }
+
+      auto virtualAddress = area.virtAddr + (physicalAddress - area.physAddr);
+
+      uintptr_t startAddr = virtualAddress.getAddress();
+      uintptr_t endAddr = startAddr + (size - 1);
+
+      auto startPage = startAddr >> sPageSizeBits;
+      auto lastPage = endAddr >> sPageSizeBits;
+
+      auto pagePtr = reinterpret_cast<uint8_t*>(sVirtBaseAddress + (startPage << sPageSizeBits));
+      auto pageSize = 1 << sPageSizeBits;
+
+      for (auto i = startPage; i <= lastPage; ++i) {
+         if (sVirtLookup[i].load() & VirtTrackSetBit) {
+            DWORD oldProtection;
+            VirtualProtect(pagePtr, pageSize, PAGE_READWRITE, &oldProtection);
+            sVirtLookup[i].fetch_and(~VirtTrackSetBit);
+         }
+
+         pagePtr += pageSize;
+      }
+   }
+
+   incrementTrackCounts(physicalAddress, size);
+}
+
+
+/**
+ * Called once a write started by beginHostWrite has finished.
+ */
+void
+endHostWrite(PhysicalAddress physicalAddress,
+             uint32_t size)
+{
+   if (!sTrackCount || size == 0) {
+      return;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock { sHostWriteMutex };
+
+      for (auto itr = sHostWrites.begin(); itr != sHostWrites.end(); ++itr) {
+         if (itr->physAddr == physicalAddress && itr->size == size) {
+            sHostWrites.erase(itr);
+            break;
+         }
+      }
+   }
+
+   // Anyone who read the state whilst the write was in progress must see a
+   // change once it has finished.
+   incrementTrackCounts(physicalAddress, size);
+}
+
 } // namespace cpu
 
 #endif // PLATFORM_WINDOWS
@@ -6,9 +6,14 @@
 #include "mem.h"
 #include "trace.h"
 
+#include <array>
+#include <atomic>
 #include <cfenv>
 #include <common/decaf_assert.h>
 #include <common/log.h>
+#include <common/platform_compiler.h>
+#include <cstring>
+#include <memory>
 
 namespace cpu
 {
@@ -16,9 +21,42 @@ namespace cpu
 namespace interpreter
 {
 
+//! Maximum number of instructions in a pre-decoded block.
+static constexpr auto MaxBlockInstructions = 32u;
+
+//! Number of entries in each core's direct mapped block cache.
+static constexpr auto BlockCacheSize = 2048u;
+
+struct DecodedBlock
+{
+   //! Guest address of the first instruction.
+   uint32_t address = 0;
+
+   //! Value of sBlockCacheGeneration when the block was decoded.
+   uint64_t generation = 0;
+
+   //! Number of instructions in the block, 0 if the entry is unused.
+   uint32_t numInstructions = 0;
+
+   //! Instructions as they were in memory, used to detect modified code.
+   std::array<uint32_t, MaxBlockInstructions> code;
+
+   //! Decoded instructions.
+   std::array<Instruction, MaxBlockInstructions> instr;
+   std::array<instrfptr_t, MaxBlockInstructions> fptr;
+};
+
+using BlockCache = std::array<DecodedBlock, BlockCacheSize>;
+
 static std::vector<instrfptr_t>
 sInstructionMap;
 
+static std::array<std::unique_ptr<BlockCache>, 3>
+sBlockCaches;
+
+static std::atomic<uint64_t>
+sBlockCacheGeneration { 1 };
+
 void
 initialise()
 {
@@ -32,6 +70,10 @@ initialise()
    registerLoadStoreInstructions();
    registerPairedInstructions();
    registerSystemInstructions();
+
+   for (auto &cache : sBlockCaches) {
+      cache = std::make_unique<BlockCache>();
+   }
 }
 
 instrfptr_t
@@ -100,6 +142,135 @@ step_one(Core *core)
    return core;
 }
 
+/**
+ * Returns true if the instruction ends a pre-decoded block.
+ *
+ * Blocks end at anything which may change nia to something other than the
+ * next instruction, or which may switch the core we are running on.
+ */
+static bool
+endsDecodedBlock(InstructionID id)
+{
+   return espresso::isBranchInstruction(id)
+      || id == InstructionID::kc
+      || id == InstructionID::sc
+      || id == InstructionID::rfi
+      || id == InstructionID::tw
+      || id == InstructionID::twi
+      || id == InstructionID::isync;
+}
+
+
+/**
+ * Decode a block of instructions starting at address.
+ *
+ * Returns false if the first instruction could not be decoded.
+ */
+static bool
+decodeBlock(DecodedBlock &block,
+            uint32_t address)
+{
+   block.address = address;
+   block.generation = sBlockCacheGeneration.load(std::memory_order_relaxed);
+   block.numInstructions = 0;
+
+   for (auto i = 0u; i < MaxBlockInstructions; ++i) {
+      auto cia = address + i * 4;
+      auto instr = mem::read<espresso::Instruction>(cia);
+      auto data = espresso::decodeInstruction(instr);
+      if (!data) {
+         break;
+      }
+
+      auto fptr = sInstructionMap[static_cast<size_t>(data->id)];
+      if (!fptr) {
+         break;
+      }
+
+      block.code[i] = mem::readNoSwap<uint32_t>(cia);
+      block.instr[i] = instr;
+      block.fptr[i] = fptr;
+      block.numInstructions++;
+
+      if (endsDecodedBlock(data->id)) {
+         break;
+      }
+   }
+
+   return block.numInstructions > 0;
+}
+
+
+/**
+ * Find or decode the pre-decoded block for the core's current nia.
+ */
+static DecodedBlock *
+getDecodedBlock(Core *core)
+{
+   auto address = core->nia;
+   auto &block = (*sBlockCaches[core->id])[(address >> 2) % BlockCacheSize];
+
+   if (LIKELY(block.address == address &&
+              block.numInstructions &&
+              block.generation == sBlockCacheGeneration.load(std::memory_order_relaxed) &&
+              std::memcmp(block.code.data(), mem::translate(address),
+                          block.numInstructions * sizeof(uint32_t)) == 0)) {
+      return &block;
+   }
+
+   if (!decodeBlock(block, address)) {
+      return nullptr;
+   }
+
+   return &block;
+}
+
+
+/**
+ * Execute a pre-decoded block of instructions.
+ *
+ * Falls back to step_one when breakpoints or tracing are active, as those
+ * must be checked on every instruction.
+ */
+Core *
+step_block(Core *core)
+{
+   if (UNLIKELY(core->tracer || hasBreakpoints())) {
+      return step_one(core);
+   }
+
+   auto block = getDecodedBlock(core);
+   if (UNLIKELY(!block)) {
+      // Let step_one report the undecodable instruction.
+      return step_one(core);
+   }
+
+   for (auto i = 0u; i < block->numInstructions; ++i) {
+      auto cia = core->nia;
+      core->cia = cia;
+      core->nia = cia + 4;
+
+      block->fptr[i](core, block->instr[i]);
+
+      if (core->nia != cia + 4 || core->interrupt.load(std::memory_order_relaxed)) {
+         break;
+      }
+   }
+
+   // If the block ended in a KC we might be running on a different core now.
+   return this_core::state();
+}
+
+
+/**
+ * Discard all pre-decoded blocks.
+ */
+void
+clearBlockCache()
+{
+   sBlockCacheGeneration++;
+}
+
 void
 resume()
 {
@@ -110,7 +281,7 @@ resume()
    auto core = cpu::this_core::state();
    while (core->nia != cpu::CALLBACK_ADDR) {
       this_core::checkInterrupts();
-      core = step_one(this_core::state());
+      core = step_block(this_core::state());
    }
 }
 
@@ -13,6 +13,12 @@ initialise();
 Core *
 step_one(Core *core);
 
+Core *
+step_block(Core *core);
+
+void
+clearBlockCache();
+
 void
 resume();
 
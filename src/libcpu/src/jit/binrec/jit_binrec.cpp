@@ -7,12 +7,16 @@
 #include "mem.h"
 #include "mmu.h"
 
+#include <algorithm>
 #include <cfenv>
 #include <common/bitutils.h>
+#include <common/datahash.h>
 #include <common/decaf_assert.h>
 #include <common/log.h>
+#include <common/platform_thread.h>
 #include <cstdlib>
 #include <fmt/core.h>
+#include <memory>
 
 #define offsetof2(s, m) ((size_t)&reinterpret_cast<char const volatile&>((((s*)0)->m)))
 
@@ -30,15 +34,21 @@ static BinrecCore *brTrapHandler(BinrecCore *core);
 static void
 brLog(void *, binrec::LogLevel level, const char *message);
 
+//! Maximum number of instructions to interpret whilst waiting for a
+//! background translation before looking up the code cache again.
+static constexpr auto MaxInterpretedInstructions = 256u;
+
 BinrecBackend::BinrecBackend(size_t codeCacheSize,
                              size_t dataCacheSize)
 {
    mCodeCache.initialise(codeCacheSize, dataCacheSize);
    mHandles.fill(nullptr);
+   mBaselineHandles.fill(nullptr);
 }
 
 BinrecBackend::~BinrecBackend()
 {
+   stopCompileThreads();
    mCodeCache.free();
 }
 
@@ -88,11 +98,29 @@ void
 BinrecBackend::addReadOnlyRange(uint32_t address, uint32_t size)
 {
    mReadOnlyRanges.emplace_back(address, size);
+
+   // Loads from read only ranges are folded into constants, so cached code is
+   // only valid for the same set of ranges it was translated with.
+   auto rangesHash = DataHash {}.write(mReadOnlyRanges.data(),
+                                       mReadOnlyRanges.size() * sizeof(mReadOnlyRanges[0]));
+   mPersistentCache.setReadOnlyHash(rangesHash.value());
+}
+
+void
+BinrecBackend::addCodeRange(uint32_t address, uint32_t size)
+{
+   mPersistentCache.addCodeRange(address, size);
 }
 
 void
 BinrecBackend::clearCache(uint32_t address, uint32_t size)
 {
+   // Prevent background translations from being registered whilst we
+   // clear, anything already in flight will be discarded.
+   std::lock_guard<std::mutex> lock { mCacheMutex };
+   mCacheGeneration++;
+   cancelQueuedCodeBlocks();
+
    if (address == 0 && size == 0xFFFFFFFF) {
       mCodeCache.clear();
       mTotalProfileTime = 0;
@@ -102,7 +130,7 @@ BinrecBackend::clearCache(uint32_t address, uint32_t size)
 }
 
 BinrecHandle *
-BinrecBackend::createBinrecHandle()
+BinrecBackend::createBinrecHandle(BinrecTier tier)
 {
    binrec::Setup setup;
    std::memset(&setup, 0, sizeof(setup));
@@ -144,9 +172,10 @@ BinrecBackend::createBinrecHandle()
       return nullptr;
    }
 
-   handle->set_optimization_flags(mOptFlags.common, mOptFlags.guest, mOptFlags.host);
+   auto &optFlags = (tier == BinrecTier::Baseline) ? mBaselineOptFlags : mOptFlags;
+   handle->set_optimization_flags(optFlags.common, optFlags.guest, optFlags.host);
    handle->enable_branch_exit_test(true);
-   handle->enable_chaining(mOptFlags.useChaining);
+   handle->enable_chaining(optFlags.useChaining);
 
    if (mVerifyEnabled && mVerifyAddress == 0) {
       handle->set_pre_insn_callback(brVerifyPreHandler);
@@ -160,6 +189,19 @@ BinrecBackend::createBinrecHandle()
    return handle;
 }
 
+BinrecHandle *
+BinrecBackend::getCoreBinrecHandle(BinrecCore *core, BinrecTier tier)
+{
+   auto &handles = (tier == BinrecTier::Baseline) ? mBaselineHandles : mHandles;
+   auto handle = handles[core->id];
+   if (!handle) {
+      handle = createBinrecHandle(tier);
+      handles[core->id] = handle;
+   }
+
+   return handle;
+}
+
 CodeBlock *
 BinrecBackend::checkForCodeBlockTrampoline(uint32_t address)
 {
@@ -206,12 +248,13 @@ BinrecBackend::getCodeBlock(BinrecCore *core, uint32_t address)
 {
    auto indexPtr = mCodeCache.getIndexPointer(address);
    auto blockIndex = indexPtr->load();
+   auto compileInBackground = !mCompileThreads.empty();
 
    // If block is uncompiled, let's try mark it as compiling!
    if (UNLIKELY(blockIndex == CodeBlockIndexUncompiled)) {
       if (!indexPtr->compare_exchange_strong(blockIndex, CodeBlockIndexCompiling)) {
          // Another thread has started compiling, wait for it to finish.
-         while (blockIndex == CodeBlockIndexCompiling) {
+         while (!compileInBackground && blockIndex == CodeBlockIndexCompiling) {
             using namespace std::chrono_literals;
             std::this_thread::sleep_for(10us);
             blockIndex = indexPtr->load();
@@ -230,8 +273,15 @@ BinrecBackend::getCodeBlock(BinrecCore *core, uint32_t address)
       return nullptr;
    }
 
+   // The block is queued for background compilation, run the interpreter
+   // until it is ready.
+   if (compileInBackground && blockIndex == CodeBlockIndexCompiling) {
+      return nullptr;
+   }
+
    // Do not compile if there is a breakpoint at address.
    if (UNLIKELY(hasBreakpoint(address))) {
+      indexPtr->store(CodeBlockIndexUncompiled);
       return nullptr;
    }
 
@@ -240,12 +290,19 @@ BinrecBackend::getCodeBlock(BinrecCore *core, uint32_t address)
       return block;
    }
 
-   auto handle = mHandles[core->id];
-   if (!handle) {
-      handle = createBinrecHandle();
-      mHandles[core->id] = handle;
+   // Check if we translated this block in a previous run
+   if (auto block = loadPersistentCodeBlock(address)) {
+      return block;
+   }
+
+   auto tier = getInitialTier();
+   if (compileInBackground) {
+      queueCodeBlock(core, address, tier);
+      return nullptr;
    }
 
+   auto handle = getCoreBinrecHandle(core, tier);
+
    if (mVerifyEnabled && mVerifyAddress != 0) {
       if (address == mVerifyAddress) {
          handle->set_pre_insn_callback(brVerifyPreHandler);
@@ -256,24 +313,69 @@ BinrecBackend::getCodeBlock(BinrecCore *core, uint32_t address)
       }
    }
 
+   auto guestSize = uint32_t { 0 };
+   auto size = long { 0 };
+   void *buffer = nullptr;
+
+   if (!translateCode(handle, core, address, &guestSize, &buffer, &size)) {
+      indexPtr->store(CodeBlockIndexError);
+      return nullptr;
+   }
+
+   auto block = registerTranslation(address, guestSize, buffer, size, tier);
+
+   // Clear any floating-point exceptions raised by the translation so
+   // the translated code doesn't pick them up.
+   std::feclearexcept(FE_ALL_EXCEPT);
+   return block;
+}
+
+
+/**
+ * Translate the code block starting at address.
+ *
+ * guestSize is set to the maximum number of guest bytes the translation may
+ * cover. The returned buffer must be passed to registerTranslation.
+ */
+bool
+BinrecBackend::translateCode(BinrecHandle *handle,
+                             BinrecCore *core,
+                             uint32_t address,
+                             uint32_t *guestSize,
+                             void **buffer,
+                             long *size)
+{
    // In extreme cases (such as dense floating-point code with no
    // optimizations enabled), translation could fail due to internal
    // libbinrec limits, so try repeatedly with smaller code ranges if
    // the first translation attempt fails.
    auto limit = 4096u;
-   auto size = long { 0 };
-   void *buffer = nullptr;
 
-   while (!handle->translate(core, address, address + limit - 1, &buffer, &size)) {
+   while (!handle->translate(core, address, address + limit - 1, buffer, size)) {
       limit /= 2;
 
       if (limit < 256) {
          gLog->warn("Failed to translate code at 0x{:X}", address);
-         indexPtr->store(CodeBlockIndexError);
-         return nullptr;
+         return false;
       }
    }
 
+   *guestSize = limit;
+   return true;
+}
+
+
+/**
+ * Copy a translated block into the code cache and free the buffer returned
+ * from libbinrec.
+ */
+CodeBlock *
+BinrecBackend::registerTranslation(uint32_t address,
+                                   uint32_t guestSize,
+                                   void *buffer,
+                                   long size,
+                                   BinrecTier tier)
+{
 #ifdef PLATFORM_WINDOWS
    // First 8 bytes of buffer is offset to start of code
    auto codeOffset = *reinterpret_cast<uint64_t *>(buffer);
@@ -288,16 +390,357 @@ BinrecBackend::getCodeBlock(BinrecCore *core, uint32_t address)
    auto unwindSize = size_t { 0 };
 #endif
 
-   auto block = mCodeCache.registerCodeBlock(address, code, codeSize, unwindInfo, unwindSize);
+   // A retranslation replaces the baseline block, which should no longer
+   // show up in the stats.
+   if (auto previous = mCodeCache.getBlockByAddress(address)) {
+      previous->superseded = true;
+   }
+
+   auto block = mCodeCache.registerCodeBlock(address, code, codeSize, unwindInfo, unwindSize,
+                                             static_cast<uint32_t>(tier));
    decaf_check(block);
-   free(buffer);
 
-   // Clear any floating-point exceptions raised by the translation so
-   // the translated code doesn't pick them up.
-   std::feclearexcept(FE_ALL_EXCEPT);
+   // Only fully optimised code is worth keeping between runs.
+   if (mPersistentCache.enabled() && tier == BinrecTier::Optimised) {
+      mPersistentCache.store(address, guestSize,
+                             code, static_cast<uint32_t>(codeSize),
+                             unwindInfo, static_cast<uint32_t>(unwindSize));
+   }
+
+   free(buffer);
    return block;
 }
 
+
+/**
+ * Register a block translated in a previous run, if there is one.
+ */
+CodeBlock *
+BinrecBackend::loadPersistentCodeBlock(uint32_t address)
+{
+   auto cached = PersistentCodeBlock { };
+   if (!mPersistentCache.enabled() ||
+       !mPersistentCache.lookup(address, cached)) {
+      return nullptr;
+   }
+
+   return mCodeCache.registerCodeBlock(address,
+                                       cached.code, cached.codeSize,
+                                       cached.unwindInfo, cached.unwindSize);
+}
+
+
+/**
+ * Set the directory used to store translated code between runs.
+ *
+ * Cache files are keyed by everything which affects the generated code, so
+ * this must be called after the optimisation flags have been set.
+ */
+void
+BinrecBackend::setPersistentCacheDirectory(const std::string &directory)
+{
+   if (directory.empty() || mVerifyEnabled) {
+      mPersistentCache.free();
+      return;
+   }
+
+   if (mOptFlags.guest & binrec::Optimize::GuestPPC::CONSTANT_GQRS) {
+      // The generated code depends on the GQR values at translation time.
+      gLog->warn("JIT cache disabled as it is incompatible with PPC_CONSTANT_GQRS");
+      mPersistentCache.free();
+      return;
+   }
+
+   auto configHash = DataHash {}
+      .write(std::array<uint64_t, 8> {
+         mOptFlags.useChaining ? 1u : 0u,
+         config()->jit.rodataReadOnly ? 1u : 0u,
+         mOptFlags.common,
+         mOptFlags.guest,
+         mOptFlags.host,
+         static_cast<uint64_t>(binrec::native_features()),
+         static_cast<uint64_t>(getBaseVirtualAddress()),
+         sizeof(BinrecCore),
+      });
+
+   mPersistentCache.initialise(directory, configHash.value());
+}
+
+
+/**
+ * Set the number of threads used to translate code in the background.
+ *
+ * With 0 threads code is translated on the guest core which first executes
+ * it. Background compilation is not used in verify mode because the verify
+ * callbacks rely on translating on the executing core.
+ */
+void
+BinrecBackend::setCompileThreads(unsigned count)
+{
+   stopCompileThreads();
+
+   if (mVerifyEnabled || count == 0) {
+      return;
+   }
+
+   mCompileThreadsRunning = true;
+
+   for (auto i = 0u; i < count; ++i) {
+      mCompileThreads.emplace_back(&BinrecBackend::compileThreadEntry, this);
+      platform::setThreadName(&mCompileThreads.back(),
+                              fmt::format("JIT Compile #{}", i));
+   }
+}
+
+
+/**
+ * Stop and join all background compilation threads.
+ */
+void
+BinrecBackend::stopCompileThreads()
+{
+   {
+      std::lock_guard<std::mutex> lock { mCompileQueueMutex };
+      mCompileThreadsRunning = false;
+   }
+
+   mCompileQueueCondition.notify_all();
+
+   for (auto &thread : mCompileThreads) {
+      thread.join();
+   }
+
+   mCompileThreads.clear();
+   cancelQueuedCodeBlocks();
+}
+
+
+/**
+ * Queue a code block for translation on a background thread.
+ *
+ * The block's index must already be set to CodeBlockIndexCompiling, unless
+ * this is a retranslation of an existing baseline block.
+ */
+void
+BinrecBackend::queueCodeBlock(BinrecCore *core,
+                              uint32_t address,
+                              BinrecTier tier)
+{
+   auto request = BinrecCompileRequest { };
+   request.address = address;
+   request.tier = tier;
+   std::copy(std::begin(core->gqr), std::end(core->gqr), request.gqr.begin());
+
+   {
+      // The generation must be read under the same lock clearCache takes,
+      // so a clear cannot happen between reading it and queueing.
+      std::lock_guard<std::mutex> cacheLock { mCacheMutex };
+      request.generation = mCacheGeneration.load();
+
+      std::lock_guard<std::mutex> lock { mCompileQueueMutex };
+      mCompileQueue.push_back(request);
+      mPendingCompiles[address] = request.generation;
+   }
+
+   mCompileQueueCondition.notify_one();
+}
+
+
+/**
+ * Remove all queued translations and mark their blocks as uncompiled again.
+ */
+void
+BinrecBackend::cancelQueuedCodeBlocks()
+{
+   std::lock_guard<std::mutex> lock { mCompileQueueMutex };
+
+   for (auto &request : mCompileQueue) {
+      auto expected = CodeBlockIndexCompiling;
+      mCodeCache.getIndexPointer(request.address)->compare_exchange_strong(expected, CodeBlockIndexUncompiled);
+      mPendingCompiles.erase(request.address);
+   }
+
+   mCompileQueue.clear();
+}
+
+
+/**
+ * Forget the pending translation for request's address.
+ *
+ * Returns false if a newer request for the same address has been queued
+ * since, in which case it is left pending.
+ */
+bool
+BinrecBackend::finishPendingCompile(const BinrecCompileRequest &request)
+{
+   std::lock_guard<std::mutex> lock { mCompileQueueMutex };
+   auto itr = mPendingCompiles.find(request.address);
+   if (itr != mPendingCompiles.end() && itr->second != request.generation) {
+      return false;
+   }
+
+   if (itr != mPendingCompiles.end()) {
+      mPendingCompiles.erase(itr);
+   }
+
+   return true;
+}
+
+
+/**
+ * Entry point for background compilation threads.
+ */
+void
+BinrecBackend::compileThreadEntry()
+{
+   // Translation only reads the GQRs from the state block, so we use a
+   // private one rather than referencing a core which may be running.
+   auto state = std::make_unique<BinrecCore>();
+   auto handle = createBinrecHandle(BinrecTier::Optimised);
+   auto baselineHandle = mTierThreshold ? createBinrecHandle(BinrecTier::Baseline) : nullptr;
+   auto lock = std::unique_lock<std::mutex> { mCompileQueueMutex };
+
+   while (true) {
+      mCompileQueueCondition.wait(lock, [this]() {
+         return !mCompileThreadsRunning || !mCompileQueue.empty();
+      });
+
+      if (!mCompileThreadsRunning) {
+         break;
+      }
+
+      auto request = mCompileQueue.front();
+      mCompileQueue.pop_front();
+      lock.unlock();
+
+      std::copy(request.gqr.begin(), request.gqr.end(), std::begin(state->gqr));
+
+      auto guestSize = uint32_t { 0 };
+      auto size = long { 0 };
+      void *buffer = nullptr;
+      auto requestHandle = (request.tier == BinrecTier::Baseline) ? baselineHandle : handle;
+      auto translated = requestHandle && translateCode(requestHandle, state.get(), request.address,
+                                                       &guestSize, &buffer, &size);
+
+      {
+         std::lock_guard<std::mutex> cacheLock { mCacheMutex };
+         auto indexPtr = mCodeCache.getIndexPointer(request.address);
+         auto newerPending = !finishPendingCompile(request);
+
+         if (request.generation != mCacheGeneration.load()) {
+            // The cache was cleared whilst we were translating, the code
+            // may be stale so throw it away. If the address has since been
+            // queued again the Compiling marker belongs to that request.
+            if (!newerPending) {
+               auto expected = CodeBlockIndexCompiling;
+               indexPtr->compare_exchange_strong(expected, CodeBlockIndexUncompiled);
+            }
+
+            if (translated) {
+               free(buffer);
+            }
+
+            restartBaselineCount(request.address);
+         } else if (translated) {
+            registerTranslation(request.address, guestSize, buffer, size, request.tier);
+         } else if (indexPtr->load() == CodeBlockIndexCompiling) {
+            indexPtr->store(CodeBlockIndexError);
+         } else {
+            // A failed retranslation keeps using the baseline block.
+            restartBaselineCount(request.address);
+         }
+      }
+
+      lock.lock();
+   }
+
+   delete baselineHandle;
+   delete handle;
+}
+
+
+/**
+ * Interpret code which has no translated block.
+ *
+ * When compiling in the background we keep interpreting straight-line code
+ * until we branch, change core or reach an address with translated code,
+ * rather than queueing a new translation for every instruction.
+ */
+BinrecCore *
+BinrecBackend::interpretBlock(BinrecCore *core)
+{
+   auto remaining = mCompileThreads.empty() ? 1u : MaxInterpretedInstructions;
+
+   while (true) {
+      auto cia = core->nia;
+      interpreter::step_one(core);
+
+      // If we just returned from a system call, we might have been
+      //  rescheduled onto a different core.
+      auto newCore = reinterpret_cast<BinrecCore *>(this_core::state());
+
+      if (--remaining == 0 ||
+          newCore != core ||
+          core->nia != cia + 4 ||
+          core->interrupt.load()) {
+         return newCore;
+      }
+
+      auto indexPtr = mCodeCache.getConstIndexPointer(core->nia);
+      if (indexPtr && indexPtr->load() >= 0) {
+         return core;
+      }
+   }
+}
+
+/**
+ * Count an execution of a baseline block and retranslate it with the full
+ * optimisation flags once it becomes hot.
+ */
+void
+BinrecBackend::countBaselineExecution(BinrecCore *core, CodeBlock *block)
+{
+   auto count = block->executionCount.fetch_add(1, std::memory_order_relaxed) + 1;
+   if (LIKELY(count != mTierThreshold)) {
+      return;
+   }
+
+   if (!mCompileThreads.empty()) {
+      queueCodeBlock(core, block->address, BinrecTier::Optimised);
+      return;
+   }
+
+   auto handle = getCoreBinrecHandle(core, BinrecTier::Optimised);
+   auto guestSize = uint32_t { 0 };
+   auto size = long { 0 };
+   void *buffer = nullptr;
+
+   if (handle && translateCode(handle, core, block->address, &guestSize, &buffer, &size)) {
+      // Replaces the baseline block in the fast index.
+      registerTranslation(block->address, guestSize, buffer, size, BinrecTier::Optimised);
+      std::feclearexcept(FE_ALL_EXCEPT);
+   } else {
+      restartBaselineCount(block->address);
+   }
+}
+
+
+/**
+ * Restart the execution count of the baseline block at address after its
+ * retranslation failed or was discarded, so that it is retranslated again
+ * once it has run another mTierThreshold times.
+ */
+void
+BinrecBackend::restartBaselineCount(uint32_t address)
+{
+   auto block = mCodeCache.getBlockByAddress(address);
+   if (block &&
+       block->tier == static_cast<uint32_t>(BinrecTier::Baseline) &&
+       !block->superseded.load()) {
+      block->executionCount.store(0, std::memory_order_relaxed);
+   }
+}
+
 inline CodeBlock *
 BinrecBackend::getCodeBlockFast(BinrecCore *core, uint32_t address)
 {
@@ -368,27 +811,31 @@ BinrecBackend::resumeExecution()
 #endif
 
          if (LIKELY(block)) {
+            if (UNLIKELY(block->tier == static_cast<uint32_t>(BinrecTier::Baseline))) {
+               countBaselineExecution(core, block);
+            }
+
             auto entry = reinterpret_cast<BinrecEntry>(block->code);
             core = entry(core, memBase);
          } else {
             // Step over the current instruction, in case it's confusing
-            // the translator.  TODO: Consider blacklisting the address to
+            // the translator or is still being translated in the
+            // background.  TODO: Consider blacklisting the address to
             // avoid trying to translate it every time we encounter it.
-            interpreter::step_one(core);
-
-            // If we just returned from a system call, we might have been
-            //  rescheduled onto a different core.
-            core = reinterpret_cast<BinrecCore *>(this_core::state());
+            core = interpretBlock(core);
          }
       } else { // mProfilingMask != 0
          const uint64_t start = rdtsc();
 
          if (block) {
+            if (block->tier == static_cast<uint32_t>(BinrecTier::Baseline)) {
+               countBaselineExecution(core, block);
+            }
+
             auto entry = reinterpret_cast<BinrecEntry>(block->code);
             core = entry(core, memBase);
          } else {
-            interpreter::step_one(core);
-            core = reinterpret_cast<BinrecCore *>(this_core::state());
+            core = interpretBlock(core);
          }
 
          // Don't count profiling data for HLE calls since those have
@@ -415,7 +862,14 @@ bool
 BinrecBackend::sampleStats(JitStats &stats)
 {
    stats.totalTimeInCodeBlocks = mTotalProfileTime;
-   stats.compiledBlocks = mCodeCache.getCompiledCodeBlocks();
+   stats.compiledBlocks.clear();
+
+   for (auto &block : mCodeCache.getCompiledCodeBlocks()) {
+      if (!block.superseded) {
+         stats.compiledBlocks.push_back(&block);
+      }
+   }
+
    stats.usedCodeCacheSize = mCodeCache.getCodeCacheSize();
    stats.usedDataCacheSize = mCodeCache.getDataCacheSize();
    return true;
@@ -471,6 +925,14 @@ brChainLookup(BinrecCore *core, ppcaddr_t address)
       return nullptr;
    }
 
+   // Chain sites are patched permanently, so never chain into a baseline
+   // block which is going to be replaced. Branches to it go through the
+   // dispatcher instead, which also counts its executions, and are chained
+   // to the optimised block once that is registered.
+   if (block->tier == static_cast<uint32_t>(BinrecTier::Baseline)) {
+      return nullptr;
+   }
+
    return block->code;
 }
 
@@ -4,8 +4,14 @@
 #include "espresso/espresso_instruction.h"
 #include "jit/jit_codecache.h"
 #include "jit/jit_backend.h"
+#include "jit/jit_persistentcache.h"
 
 #include <binrec++.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <string>
 
@@ -23,6 +29,17 @@ struct BinrecOptimisationFlags
    unsigned int host = 0;
 };
 
+//! Value of CodeBlock::tier for blocks translated by BinrecBackend.
+enum class BinrecTier : uint32_t
+{
+   //! Translated with the full optimisation flags.
+   Optimised = 0,
+
+   //! Translated with the baseline optimisation flags, will be retranslated
+   //! once it has executed enough times.
+   Baseline = 1,
+};
+
 class BinrecBackend;
 struct VerifyBuffer;
 
@@ -54,6 +71,21 @@ struct BinrecCore : public Core
 using BinrecHandle = binrec::Handle<BinrecCore *>;
 using BinrecEntry = BinrecCore * (*)(BinrecCore *core, uintptr_t membase);
 
+struct BinrecCompileRequest
+{
+   //! Guest address of the block to translate.
+   uint32_t address;
+
+   //! Value of BinrecBackend::mCacheGeneration when the request was queued.
+   uint64_t generation;
+
+   //! GQR values of the requesting core, used for PPC_CONSTANT_GQRS.
+   std::array<espresso::GraphicsQuantisationRegister, 8> gqr;
+
+   //! Tier to translate the block for.
+   BinrecTier tier;
+};
+
 class BinrecBackend : public JitBackend
 {
 public:
@@ -76,6 +108,10 @@ public:
    addReadOnlyRange(uint32_t address,
                     uint32_t size) override;
 
+   void
+   addCodeRange(uint32_t address,
+                uint32_t size) override;
+
    bool
    sampleStats(JitStats &stats) override;
 
@@ -92,14 +128,77 @@ public:
    void
    setOptFlags(const std::vector<std::string> &optList);
 
+   void
+   setTieredCompilation(const std::vector<std::string> &baselineOptList,
+                        unsigned threshold);
+
    void
    setVerifyEnabled(bool enabled, uint32_t address = 0);
 
+   void
+   setCompileThreads(unsigned count);
+
+   void
+   setPersistentCacheDirectory(const std::string &directory);
+
    CodeBlock *
    getCodeBlock(BinrecCore *core, uint32_t address);
 
 protected:
-   BinrecHandle *createBinrecHandle();
+   BinrecHandle *createBinrecHandle(BinrecTier tier);
+
+   BinrecHandle *
+   getCoreBinrecHandle(BinrecCore *core, BinrecTier tier);
+
+   BinrecTier
+   getInitialTier() const
+   {
+      return mTierThreshold ? BinrecTier::Baseline : BinrecTier::Optimised;
+   }
+
+   void
+   countBaselineExecution(BinrecCore *core, CodeBlock *block);
+
+   void
+   restartBaselineCount(uint32_t address);
+
+   bool
+   translateCode(BinrecHandle *handle,
+                 BinrecCore *core,
+                 uint32_t address,
+                 uint32_t *guestSize,
+                 void **buffer,
+                 long *size);
+
+   CodeBlock *
+   registerTranslation(uint32_t address,
+                       uint32_t guestSize,
+                       void *buffer,
+                       long size,
+                       BinrecTier tier);
+
+   CodeBlock *
+   loadPersistentCodeBlock(uint32_t address);
+
+   void
+   queueCodeBlock(BinrecCore *core,
+                  uint32_t address,
+                  BinrecTier tier);
+
+   void
+   cancelQueuedCodeBlocks();
+
+   bool
+   finishPendingCompile(const BinrecCompileRequest &request);
+
+   void
+   stopCompileThreads();
+
+   void
+   compileThreadEntry();
+
+   BinrecCore *
+   interpretBlock(BinrecCore *core);
 
    inline CodeBlock *
    getCodeBlockFast(BinrecCore *core, uint32_t address);
@@ -132,13 +231,34 @@ protected:
 
 private:
    CodeCache mCodeCache;
+   PersistentCache mPersistentCache;
    std::array<BinrecHandle *, 3> mHandles;
+   std::array<BinrecHandle *, 3> mBaselineHandles;
    BinrecOptimisationFlags mOptFlags;
+   BinrecOptimisationFlags mBaselineOptFlags;
+   unsigned mTierThreshold = 0;
    std::vector<std::pair<ppcaddr_t, uint32_t>> mReadOnlyRanges;
    std::atomic<uint64_t> mTotalProfileTime { 0 };
    uint32_t mProfilingMask = 0;
    bool mVerifyEnabled = false;
    uint32_t mVerifyAddress = 0;
+
+   // Background compilation
+   std::vector<std::thread> mCompileThreads;
+   std::deque<BinrecCompileRequest> mCompileQueue;
+   std::mutex mCompileQueueMutex;
+   std::condition_variable mCompileQueueCondition;
+   bool mCompileThreadsRunning = false;
+
+   //! Generation of the newest queued or in flight translation of each
+   //! address, protected by mCompileQueueMutex.
+   std::unordered_map<uint32_t, uint64_t> mPendingCompiles;
+
+   //! Serialises registration of background translations with clearCache.
+   std::mutex mCacheMutex;
+
+   //! Incremented on every clearCache to discard stale translations.
+   std::atomic<uint64_t> mCacheGeneration { 0 };
 };
 
 } // namespace jit
@@ -100,13 +100,10 @@ sOptFlags = {
    {"CHAIN",                    {OptFlagInfo::OPTFLAG_CHAIN}},
 };
 
-void
-BinrecBackend::setOptFlags(const std::vector<std::string> &optList)
+static BinrecOptimisationFlags
+parseOptFlags(const std::vector<std::string> &optList)
 {
-   mOptFlags.common = 0;
-   mOptFlags.guest = 0;
-   mOptFlags.host = 0;
-   mOptFlags.useChaining = false;
+   auto optFlags = BinrecOptimisationFlags { };
 
    for (const auto &i : optList) {
       auto flag = sOptFlags.find(i);
@@ -118,19 +115,48 @@ BinrecBackend::setOptFlags(const std::vector<std::string> &optList)
 
       switch (flag->second.type) {
       case OptFlagInfo::OPTFLAG_CHAIN:
-         mOptFlags.useChaining = true;
+         optFlags.useChaining = true;
          break;
       case OptFlagInfo::OPTFLAG_COMMON:
-         mOptFlags.common |= flag->second.value;
+         optFlags.common |= flag->second.value;
          break;
       case OptFlagInfo::OPTFLAG_GUEST:
-         mOptFlags.guest |= flag->second.value;
+         optFlags.guest |= flag->second.value;
          break;
       case OptFlagInfo::OPTFLAG_HOST:
-         mOptFlags.host |= flag->second.value;
+         optFlags.host |= flag->second.value;
          break;
       }
    }
+
+   return optFlags;
+}
+
+void
+BinrecBackend::setOptFlags(const std::vector<std::string> &optList)
+{
+   mOptFlags = parseOptFlags(optList);
+}
+
+
+/**
+ * Enable tiered compilation.
+ *
+ * Blocks are first translated with the cheaper baseline optimisations and
+ * retranslated with the full optimisation flags once they have been entered
+ * threshold times. A threshold of 0 disables tiering.
+ */
+void
+BinrecBackend::setTieredCompilation(const std::vector<std::string> &baselineOptList,
+                                    unsigned threshold)
+{
+   mBaselineOptFlags = parseOptFlags(baselineOptList);
+
+   // Blocks must return to the dispatcher to be counted.
+   mBaselineOptFlags.useChaining = false;
+
+   // Verification compares against a single set of optimisation flags.
+   mTierThreshold = mVerifyEnabled ? 0 : threshold;
 }
 
 void
@@ -71,6 +71,20 @@ addReadOnlyRange(uint32_t address, uint32_t size)
 }
 
 
+/**
+ * Notify the JIT of a newly loaded range of guest code.
+ *
+ * This must be called once the code is in its final, relocated state.
+ */
+void
+addCodeRange(uint32_t address, uint32_t size)
+{
+   if (sBackend) {
+      sBackend->addCodeRange(address, size);
+   }
+}
+
+
 /**
  * Begin executing guest code on the current core.
  */
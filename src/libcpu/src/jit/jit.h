@@ -22,6 +22,9 @@ clearCache(uint32_t address, uint32_t size);
 void
 addReadOnlyRange(uint32_t address, uint32_t size);
 
+void
+addCodeRange(uint32_t address, uint32_t size);
+
 void
 resume();
 
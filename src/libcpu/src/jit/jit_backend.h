@@ -30,6 +30,10 @@ public:
    virtual void
    addReadOnlyRange(uint32_t address, uint32_t size) = 0;
 
+   //! Notify of a newly loaded region of code.
+   virtual void
+   addCodeRange(uint32_t address, uint32_t size) = 0;
+
    //! Sample JIT stats.
    virtual bool
    sampleStats(JitStats &stats) = 0;
@@ -278,13 +278,15 @@ CodeCache::setBlockIndex(uint32_t address,
  * Register a block of code in the CodeCache.
  *
  * This will allocate memory for the code and data, and update the code block index.
+ * If a block was already registered for address it is replaced in the index.
  */
 CodeBlock *
 CodeCache::registerCodeBlock(uint32_t address,
-                             void *code,
+                             const void *code,
                              size_t size,
-                             void *unwindInfo,
-                             size_t unwindSize)
+                             const void *unwindInfo,
+                             size_t unwindSize,
+                             uint32_t tier)
 {
    auto dataAddress = allocate(mDataAllocator, sizeof(CodeBlock), 1);
    auto codeAddress = allocate(mCodeAllocator, size, 16);
@@ -299,6 +301,9 @@ CodeCache::registerCodeBlock(uint32_t address,
    // Initialise profiling data
    block->profileData.count = 0;
    block->profileData.time = 0;
+   block->tier = tier;
+   block->executionCount = 0;
+   block->superseded = false;
 
 #ifdef PLATFORM_WINDOWS
    // Register unwind info
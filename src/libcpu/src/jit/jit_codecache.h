@@ -122,10 +122,11 @@ public:
 
    CodeBlock *
    registerCodeBlock(uint32_t address,
-                     void *code,
+                     const void *code,
                      size_t size,
-                     void *unwindInfo,
-                     size_t unwindSize);
+                     const void *unwindInfo,
+                     size_t unwindSize,
+                     uint32_t tier = 0);
 
 
 private:
@@ -0,0 +1,411 @@
+#include "jit_persistentcache.h"
+#include "mem.h"
+
+#include <algorithm>
+#include <common/align.h>
+#include <common/datahash.h>
+#include <common/log.h>
+#include <common/platform_dir.h>
+#include <cstring>
+#include <fmt/core.h>
+
+namespace cpu
+{
+
+namespace jit
+{
+
+//! Flush cache files once this much has been written to them, rather than
+//! after every record. A record lost in a crash is simply translated again.
+static constexpr size_t MaxUnflushedBytes = 256 * 1024;
+
+//! Stop appending to a cache file once it reaches this size. Records are only
+//! replaced when the file is next compacted, so without a limit a title which
+//! keeps clearing the JIT cache would grow the file for as long as it runs.
+static constexpr size_t MaxCacheFileSize = 256 * 1024 * 1024;
+
+PersistentCache::~PersistentCache()
+{
+   free();
+}
+
+
+/**
+ * Initialise the persistent cache.
+ *
+ * configHash must uniquely identify the translator configuration, any change
+ * to it causes all previously cached code to be ignored.
+ */
+bool
+PersistentCache::initialise(const std::string &directory,
+                            uint64_t configHash)
+{
+   free();
+
+   if (directory.empty()) {
+      return false;
+   }
+
+   if (!platform::isDirectory(directory) &&
+       !platform::createDirectory(directory)) {
+      gLog->warn("Could not create JIT cache directory {}", directory);
+      return false;
+   }
+
+   mDirectory = directory;
+   mConfigHash = configHash;
+   return true;
+}
+
+
+/**
+ * Close all cache files.
+ */
+void
+PersistentCache::free()
+{
+   std::lock_guard<std::mutex> lock { mMutex };
+
+   for (auto &range : mCodeRanges) {
+      if (range->file) {
+         fclose(range->file);
+      }
+
+      unloadRecords(*range);
+   }
+
+   mCodeRanges.clear();
+   mDirectory.clear();
+}
+
+
+/**
+ * Register a range of guest code, such as the text section of a loaded RPL.
+ *
+ * The cache file for the range is identified by a hash of its contents, so
+ * this must be called after relocations have been applied.
+ */
+void
+PersistentCache::addCodeRange(uint32_t address,
+                              uint32_t size)
+{
+   if (!enabled() || !size) {
+      return;
+   }
+
+   auto rangeHash = DataHash {}.write(mem::translate(address), size).value();
+   auto path = fmt::format("{}/{:016X}-{:016X}.bin", mDirectory, rangeHash, mConfigHash);
+
+   auto range = std::make_unique<CodeRange>();
+   range->address = address;
+   range->size = size;
+
+   auto mode = "ab";
+   auto needsCompaction = false;
+   if (platform::isFile(path)) {
+      if (!loadRecords(*range, path, needsCompaction)) {
+         // Start a fresh file rather than appending to an incompatible one.
+         mode = "wb";
+      } else if (needsCompaction) {
+         if (!compactRecords(*range, path) ||
+             !loadRecords(*range, path, needsCompaction)) {
+            unloadRecords(*range);
+            mode = "wb";
+         }
+      }
+   }
+
+   range->file = fopen(path.c_str(), mode);
+   if (range->file) {
+      fseek(range->file, 0, SEEK_END);
+      range->fileSize = static_cast<size_t>(ftell(range->file));
+   }
+
+   if (!range->file) {
+      gLog->warn("Could not open JIT cache file {}", path);
+   } else if (ftell(range->file) == 0) {
+      auto header = FileHeader { };
+      header.magic = FileHeader::Magic;
+      header.version = FileHeader::Version;
+      header.configHash = mConfigHash;
+      header.rangeHash = rangeHash;
+      header.rangeAddress = address;
+      header.rangeSize = size;
+      fwrite(&header, sizeof(FileHeader), 1, range->file);
+      fflush(range->file);
+      range->fileSize = sizeof(FileHeader);
+   }
+
+   std::lock_guard<std::mutex> lock { mMutex };
+   mCodeRanges.emplace_back(std::move(range));
+}
+
+
+/**
+ * Set the hash of the JIT read only ranges.
+ *
+ * Records translated with a different set of read only ranges may contain
+ * constants folded from memory which is not read only now, so they are
+ * ignored.
+ */
+void
+PersistentCache::setReadOnlyHash(uint64_t readOnlyHash)
+{
+   std::lock_guard<std::mutex> lock { mMutex };
+   mReadOnlyHash = readOnlyHash;
+}
+
+
+/**
+ * Map an existing cache file and index the records within it.
+ *
+ * Returns false if the file is not a compatible cache file. Sets
+ * needsCompaction when the file ends with a truncated record, or when much of
+ * it is taken up by records which have been replaced by a later translation.
+ */
+bool
+PersistentCache::loadRecords(CodeRange &range,
+                             const std::string &path,
+                             bool &needsCompaction)
+{
+   needsCompaction = false;
+
+   auto fileSize = size_t { 0 };
+   range.mapHandle = platform::openMemoryMappedFile(path,
+                                                    platform::ProtectFlags::ReadOnly,
+                                                    &fileSize);
+   if (range.mapHandle == platform::InvalidMapFileHandle) {
+      return false;
+   }
+
+   if (fileSize >= sizeof(FileHeader)) {
+      range.view = reinterpret_cast<const uint8_t *>(
+         platform::mapViewOfFile(range.mapHandle, platform::ProtectFlags::ReadOnly,
+                                 0, fileSize));
+   }
+
+   auto header = reinterpret_cast<const FileHeader *>(range.view);
+   if (!header ||
+       header->magic != FileHeader::Magic ||
+       header->version != FileHeader::Version ||
+       header->configHash != mConfigHash ||
+       header->rangeAddress != range.address ||
+       header->rangeSize != range.size) {
+      gLog->warn("Ignoring incompatible JIT cache file {}", path);
+      range.viewSize = fileSize;
+      unloadRecords(range);
+      return false;
+   }
+
+   range.viewSize = fileSize;
+
+   // Later records replace earlier ones for the same address.
+   auto offset = sizeof(FileHeader);
+   auto replacedBytes = size_t { 0 };
+   while (offset + sizeof(RecordHeader) <= fileSize) {
+      auto record = reinterpret_cast<const RecordHeader *>(range.view + offset);
+      auto recordSize = align_up(sizeof(RecordHeader) + record->unwindSize + record->codeSize, 8);
+      if (offset + recordSize > fileSize) {
+         // Truncated record, probably from a crash whilst writing it.
+         break;
+      }
+
+      auto &entry = range.records[record->address];
+      if (entry) {
+         replacedBytes += align_up(sizeof(RecordHeader) + entry->unwindSize + entry->codeSize, 8);
+      }
+
+      entry = record;
+      offset += recordSize;
+   }
+
+   needsCompaction = (offset != fileSize) || (replacedBytes > fileSize / 4);
+   gLog->info("Loaded {} JIT blocks from {}", range.records.size(), path);
+   return true;
+}
+
+
+/**
+ * Rewrite a loaded cache file with only the newest record for each address.
+ *
+ * The records are unloaded afterwards and must be loaded again from the new
+ * file.
+ */
+bool
+PersistentCache::compactRecords(CodeRange &range,
+                                const std::string &path)
+{
+   auto records = std::vector<const RecordHeader *> { };
+   for (auto &[address, record] : range.records) {
+      records.push_back(record);
+   }
+
+   // Keep the records in the order they were originally written.
+   std::sort(records.begin(), records.end());
+
+   auto tmpPath = path + ".tmp";
+   auto succeeded = false;
+   if (auto file = fopen(tmpPath.c_str(), "wb")) {
+      fwrite(range.view, sizeof(FileHeader), 1, file);
+
+      for (auto record : records) {
+         auto recordSize = align_up(sizeof(RecordHeader) + record->unwindSize + record->codeSize, 8);
+         fwrite(record, 1, recordSize, file);
+      }
+
+      succeeded = !ferror(file);
+      succeeded = (fclose(file) == 0) && succeeded;
+   }
+
+   // The file must be unmapped before it can be replaced on Windows.
+   unloadRecords(range);
+
+   if (succeeded) {
+      std::remove(path.c_str());
+      succeeded = (std::rename(tmpPath.c_str(), path.c_str()) == 0);
+   }
+
+   if (!succeeded) {
+      gLog->warn("Could not compact JIT cache file {}", path);
+      std::remove(tmpPath.c_str());
+   }
+
+   return succeeded;
+}
+
+
+/**
+ * Unmap the view of a cache file and forget the records within it.
+ */
+void
+PersistentCache::unloadRecords(CodeRange &range)
+{
+   range.records.clear();
+
+   if (range.view) {
+      platform::unmapViewOfFile(const_cast<uint8_t *>(range.view), range.viewSize);
+      range.view = nullptr;
+   }
+
+   if (range.mapHandle != platform::InvalidMapFileHandle) {
+      platform::closeMemoryMappedFile(range.mapHandle);
+      range.mapHandle = platform::InvalidMapFileHandle;
+   }
+
+   range.viewSize = 0;
+}
+
+
+/**
+ * Find the most recently registered code range containing address.
+ */
+PersistentCache::CodeRange *
+PersistentCache::findCodeRange(uint32_t address)
+{
+   for (auto itr = mCodeRanges.rbegin(); itr != mCodeRanges.rend(); ++itr) {
+      auto &range = **itr;
+      if (address >= range.address && address - range.address < range.size) {
+         return &range;
+      }
+   }
+
+   return nullptr;
+}
+
+
+/**
+ * Find previously translated code for a guest address.
+ *
+ * The guest code is hashed and compared against the hash recorded when the
+ * block was translated, so modified code is never returned.
+ */
+bool
+PersistentCache::lookup(uint32_t address,
+                        PersistentCodeBlock &block)
+{
+   std::lock_guard<std::mutex> lock { mMutex };
+   auto range = findCodeRange(address);
+   if (!range) {
+      return false;
+   }
+
+   auto itr = range->records.find(address);
+   if (itr == range->records.end()) {
+      return false;
+   }
+
+   // Only validate each record once, either it is used now or never.
+   auto record = itr->second;
+   range->records.erase(itr);
+
+   if (record->readOnlyHash != mReadOnlyHash) {
+      return false;
+   }
+
+   auto rangeEnd = range->address + range->size;
+   if (record->guestSize > rangeEnd - address) {
+      return false;
+   }
+
+   auto guestHash = DataHash {}.write(mem::translate(address), record->guestSize).value();
+   if (guestHash != record->guestHash) {
+      return false;
+   }
+
+   auto data = reinterpret_cast<const uint8_t *>(record + 1);
+   block.unwindInfo = data;
+   block.unwindSize = record->unwindSize;
+   block.code = data + record->unwindSize;
+   block.codeSize = record->codeSize;
+   return true;
+}
+
+
+/**
+ * Store a newly translated block.
+ *
+ * maxGuestSize is the maximum number of guest bytes the translator may have
+ * read when translating the block.
+ */
+void
+PersistentCache::store(uint32_t address,
+                       uint32_t maxGuestSize,
+                       const void *code,
+                       uint32_t codeSize,
+                       const void *unwindInfo,
+                       uint32_t unwindSize)
+{
+   std::lock_guard<std::mutex> lock { mMutex };
+   auto range = findCodeRange(address);
+   if (!range || !range->file || range->fileSize >= MaxCacheFileSize) {
+      return;
+   }
+
+   auto record = RecordHeader { };
+   record.address = address;
+   record.guestSize = std::min(maxGuestSize, range->address + range->size - address);
+   record.guestHash = DataHash {}.write(mem::translate(address), record.guestSize).value();
+   record.codeSize = codeSize;
+   record.unwindSize = unwindSize;
+   record.readOnlyHash = mReadOnlyHash;
+
+   static const uint8_t padding[8] = { 0 };
+   auto recordSize = sizeof(RecordHeader) + unwindSize + codeSize;
+   auto paddingSize = align_up(recordSize, 8) - recordSize;
+
+   fwrite(&record, sizeof(RecordHeader), 1, range->file);
+   fwrite(unwindInfo, 1, unwindSize, range->file);
+   fwrite(code, 1, codeSize, range->file);
+   fwrite(padding, 1, paddingSize, range->file);
+
+   range->fileSize += recordSize + paddingSize;
+   range->unflushedBytes += recordSize + paddingSize;
+   if (range->unflushedBytes >= MaxUnflushedBytes) {
+      fflush(range->file);
+      range->unflushedBytes = 0;
+   }
+}
+
+} // namespace jit
+
+} // namespace cpu
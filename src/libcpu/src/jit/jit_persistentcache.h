@@ -0,0 +1,161 @@
+#pragma once
+#include <common/platform_memory.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cpu
+{
+
+namespace jit
+{
+
+struct PersistentCodeBlock
+{
+   //! Host code, position independent as produced by the translator.
+   const void *code;
+
+   //! Size of host code.
+   uint32_t codeSize;
+
+   //! Code block unwind info, only used on Windows.
+   const void *unwindInfo;
+
+   //! Size of unwind info.
+   uint32_t unwindSize;
+};
+
+/**
+ * Persistent Code Cache Responsibilities:
+ *
+ * 1. Store translated code for a guest code range on disk, in a file keyed by
+ *    the hash of the guest code and of the translator configuration.
+ * 2. Map the file back on the next run and return previously translated
+ *    code, validating the guest code it was translated from on first use.
+ */
+class PersistentCache
+{
+   struct FileHeader
+   {
+      static constexpr uint32_t Magic = 0x4A544344; // "DCTJ"
+      static constexpr uint32_t Version = 2;
+
+      uint32_t magic;
+      uint32_t version;
+      uint64_t configHash;
+      uint64_t rangeHash;
+      uint32_t rangeAddress;
+      uint32_t rangeSize;
+   };
+
+   struct RecordHeader
+   {
+      //! Guest address of the code block.
+      uint32_t address;
+
+      //! Number of guest bytes hashed into guestHash.
+      uint32_t guestSize;
+
+      //! Hash of the guest code the block was translated from.
+      uint64_t guestHash;
+
+      //! Hash of the JIT read only ranges the block was translated with.
+      uint64_t readOnlyHash;
+
+      //! Size of host code following the unwind info.
+      uint32_t codeSize;
+
+      //! Size of unwind info following this header.
+      uint32_t unwindSize;
+   };
+
+   struct CodeRange
+   {
+      uint32_t address;
+      uint32_t size;
+
+      //! Read only view of the cache file as it was when the range was added.
+      platform::MapFileHandle mapHandle = platform::InvalidMapFileHandle;
+      const uint8_t *view = nullptr;
+      size_t viewSize = 0;
+
+      //! Records in the mapped view, validated lazily on lookup.
+      std::unordered_map<uint32_t, const RecordHeader *> records;
+
+      //! File new translations are appended to.
+      FILE *file = nullptr;
+
+      //! Current size of file.
+      size_t fileSize = 0;
+
+      //! Bytes written to file since it was last flushed.
+      size_t unflushedBytes = 0;
+   };
+
+public:
+   ~PersistentCache();
+
+   bool
+   initialise(const std::string &directory,
+              uint64_t configHash);
+
+   void
+   free();
+
+   bool
+   enabled() const
+   {
+      return !mDirectory.empty();
+   }
+
+   void
+   addCodeRange(uint32_t address,
+                uint32_t size);
+
+   void
+   setReadOnlyHash(uint64_t readOnlyHash);
+
+   bool
+   lookup(uint32_t address,
+          PersistentCodeBlock &block);
+
+   void
+   store(uint32_t address,
+         uint32_t maxGuestSize,
+         const void *code,
+         uint32_t codeSize,
+         const void *unwindInfo,
+         uint32_t unwindSize);
+
+private:
+   CodeRange *
+   findCodeRange(uint32_t address);
+
+   bool
+   loadRecords(CodeRange &range,
+               const std::string &path,
+               bool &needsCompaction);
+
+   bool
+   compactRecords(CodeRange &range,
+                  const std::string &path);
+
+   void
+   unloadRecords(CodeRange &range);
+
+private:
+   std::string mDirectory;
+   uint64_t mConfigHash = 0;
+   uint64_t mReadOnlyHash = 0;
+   std::mutex mMutex;
+   std::vector<std::unique_ptr<CodeRange>> mCodeRanges;
+};
+
+} // namespace jit
+
+} // namespace cpu
@@ -32,6 +32,7 @@ struct LogSettings
    bool branch_trace = false;
    bool hle_trace = false;
    bool hle_trace_res = false;
+   bool hle_trace_binary = false; // Record to a ring buffer which is dumped on exit
    std::vector<std::string> hle_trace_filters =
    {
       "+.*",
@@ -49,6 +50,7 @@ struct LogSettings
 struct SoundSettings
 {
    bool dump_sounds = false;
+   unsigned decode_threads = 0; // 0 decodes voices on the guest core
 };
 
 enum class SystemRegion
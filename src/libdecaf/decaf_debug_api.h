@@ -302,6 +302,22 @@ struct CafeVoice
    bool loopingEnabled;
 };
 
+struct CafeHleFunctionProfile
+{
+   //! Name of the library which exports the function.
+   std::string library;
+
+   //! Name of the function.
+   std::string function;
+
+   //! Number of calls which returned on each core.
+   std::array<uint64_t, 3> calls;
+
+   //! Cumulative host time spent in the function on each core, this includes
+   //! any time the calling thread spent blocked.
+   std::array<std::chrono::nanoseconds, 3> time;
+};
+
 enum class Pm4CaptureState
 {
    Disabled,
@@ -334,6 +350,13 @@ bool sampleCafeMemorySegments(std::vector<CafeMemorySegment> &segments);
 bool sampleCafeRunningThread(int coreId, CafeThread &info);
 bool sampleCafeThreads(std::vector<CafeThread> &threads);
 bool sampleCafeVoices(std::vector<CafeVoice> &voiceInfos);
+bool dumpHleTrace(const std::string &path);
+
+// HLE profiler
+void setHleProfilingEnabled(bool enabled);
+bool hleProfilingEnabled();
+void resetHleProfile();
+bool sampleHleProfile(std::vector<CafeHleFunctionProfile> &profile);
 
 // pm4 capture
 Pm4CaptureState pm4CaptureState();
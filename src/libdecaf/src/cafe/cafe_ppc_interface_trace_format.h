@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+
+/*
+Binary HLE trace dump format.
+
+A dump starts with a FileHeader, followed by numFunctions FunctionHeaders
+each immediately followed by nameLength bytes of the unterminated function
+name, and then numCores CoreHeaders each immediately followed by numRecords
+Records in the order they were traced.
+
+All values are stored in host byte order.
+*/
+
+namespace cafe::trace
+{
+
+static constexpr uint32_t Magic = 0x52544844; // "DHTR"
+static constexpr uint32_t Version = 1;
+
+//! Maximum number of arguments recorded for each call.
+static constexpr uint32_t MaxArgs = 10;
+
+//! Maximum number of bytes of the first string argument recorded for each
+//! call, including the null terminator.
+static constexpr uint32_t MaxStringLength = 32;
+
+struct FileHeader
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t numFunctions;
+   uint32_t numCores;
+};
+static_assert(sizeof(FileHeader) == 0x10);
+
+//! Matches cafe::RegisterType.
+enum class ArgType : uint8_t
+{
+   Gpr32,
+   Gpr64,
+   Fpr,
+   VarArgs,
+   Void,
+};
+
+enum ArgFlags : uint8_t
+{
+   ArgSigned   = 1 << 0,
+   ArgPointer  = 1 << 1,
+   ArgString   = 1 << 2,
+};
+
+struct ArgInfo
+{
+   ArgType type;
+   uint8_t flags;
+};
+static_assert(sizeof(ArgInfo) == 2);
+
+struct FunctionHeader
+{
+   uint16_t nameLength;
+
+   //! Non-zero if args[0] of each record is the this pointer.
+   uint8_t isMemberFunction;
+   uint8_t numArgs;
+   ArgInfo args[MaxArgs];
+};
+static_assert(sizeof(FunctionHeader) == 0x18);
+
+struct CoreHeader
+{
+   uint32_t coreId;
+   uint32_t numRecords;
+};
+static_assert(sizeof(CoreHeader) == 0x8);
+
+struct Record
+{
+   //! Host time of the call in nanoseconds since tracing started.
+   uint64_t time;
+
+   //! Index into the function table.
+   uint32_t function;
+
+   //! Guest link register, the address the function was called from.
+   uint32_t lr;
+
+   //! Raw argument values, 32 bit registers are zero extended and floating
+   //! point registers are stored as the bits of a double.
+   uint64_t args[MaxArgs];
+
+   //! Start of the first string argument, always null terminated.
+   char string[MaxStringLength];
+};
+static_assert(sizeof(Record) == 0x80);
+
+} // namespace cafe::trace
@@ -1,11 +1,145 @@
+#include "cafe_ppc_interface_trace_format.h"
 #include "cafe_ppc_interface_trace_host.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <common/bit_cast.h>
 #include <common/log.h>
+#include <cstring>
 #include <fmt/format.h>
+#include <fstream>
 #include <libcpu/cpu_formatters.h>
+#include <memory>
+#include <mutex>
 #include <string_view>
+#include <vector>
 
-namespace cafe::detail
+namespace cafe
+{
+
+static constexpr uint32_t NumCores = 3;
+
+//! Number of records in each core's ring, must be a power of two.
+static constexpr uint32_t TraceRingSize = 16 * 1024;
+
+struct TraceFunction
+{
+   std::string name;
+   trace::FunctionHeader header;
+};
+
+/**
+ * A fixed size ring of the most recent calls traced on one core.
+ *
+ * Only the core which owns the ring writes to it, so writes need no locking,
+ * the write index is published with release semantics so dumpTraceRing can
+ * read the ring from another thread whilst the core is still running.
+ */
+struct TraceRing
+{
+   std::unique_ptr<trace::Record[]> records;
+   std::atomic<uint64_t> writeIndex { 0 };
+};
+
+static std::mutex sTraceFunctionsMutex;
+static std::vector<TraceFunction> sTraceFunctions;
+
+static std::atomic<bool> sTraceRingEnabled { false };
+static std::once_flag sTraceRingAllocated;
+static std::array<TraceRing, NumCores> sTraceRings;
+static std::chrono::steady_clock::time_point sTraceRingStart;
+
+void
+setTraceRingEnabled(bool enabled)
+{
+   if (enabled) {
+      std::call_once(sTraceRingAllocated, []() {
+         for (auto &ring : sTraceRings) {
+            ring.records = std::make_unique<trace::Record[]>(TraceRingSize);
+         }
+
+         sTraceRingStart = std::chrono::steady_clock::now();
+      });
+   }
+
+   sTraceRingEnabled.store(enabled, std::memory_order_release);
+}
+
+bool
+getTraceRingEnabled()
+{
+   return sTraceRingEnabled.load(std::memory_order_acquire);
+}
+
+
+/**
+ * Write the function table and every core's trace ring to path.
+ *
+ * The cores may still be running, any records which were overwritten whilst
+ * they were being copied are dropped from the dump.
+ */
+bool
+dumpTraceRing(const std::string &path)
+{
+   auto file = std::ofstream { path, std::ofstream::out | std::ofstream::binary };
+   if (!file.is_open()) {
+      gLog->error("Could not open {} to write HLE trace", path);
+      return false;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock { sTraceFunctionsMutex };
+      auto header = trace::FileHeader { };
+      header.magic = trace::Magic;
+      header.version = trace::Version;
+      header.numFunctions = static_cast<uint32_t>(sTraceFunctions.size());
+      header.numCores = sTraceRings[0].records ? NumCores : 0;
+      file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+      for (auto &function : sTraceFunctions) {
+         file.write(reinterpret_cast<const char *>(&function.header), sizeof(function.header));
+         file.write(function.name.data(), function.header.nameLength);
+      }
+   }
+
+   auto records = std::vector<trace::Record> { };
+   for (auto coreId = 0u; coreId < NumCores; ++coreId) {
+      auto &ring = sTraceRings[coreId];
+      if (!ring.records) {
+         break;
+      }
+
+      auto end = ring.writeIndex.load(std::memory_order_acquire);
+      auto begin = end > TraceRingSize ? end - TraceRingSize : 0;
+      records.clear();
+
+      for (auto i = begin; i < end; ++i) {
+         records.push_back(ring.records[i & (TraceRingSize - 1)]);
+      }
+
+      // Drop anything the core may have overwritten whilst we were copying,
+      // including the slot for newEnd which the core may be writing right now
+      // as writeIndex is only advanced once a record is complete.
+      auto newEnd = ring.writeIndex.load(std::memory_order_acquire);
+      if (newEnd >= TraceRingSize && newEnd - TraceRingSize >= begin) {
+         auto numOverwritten = std::min<uint64_t>(newEnd - TraceRingSize - begin + 1, records.size());
+         records.erase(records.begin(), records.begin() + numOverwritten);
+      }
+
+      auto header = trace::CoreHeader { };
+      header.coreId = coreId;
+      header.numRecords = static_cast<uint32_t>(records.size());
+      file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      file.write(reinterpret_cast<const char *>(records.data()),
+                 records.size() * sizeof(trace::Record));
+   }
+
+   return file.good();
+}
+
+namespace detail
 {
 
 inline uint32_t
@@ -20,9 +154,102 @@ readGpr(cpu::Core *core, int regIndex)
    }
 }
 
+uint32_t
+register_trace_host_impl(const char *name, bool is_member_function, const RuntimeParamInfo *params, size_t numParams)
+{
+   std::lock_guard<std::mutex> lock { sTraceFunctionsMutex };
+   auto &function = sTraceFunctions.emplace_back();
+   function.name = name;
+   function.header.nameLength = static_cast<uint16_t>(std::min<size_t>(function.name.size(), 0xFFFF));
+   function.header.isMemberFunction = is_member_function ? 1 : 0;
+   function.header.numArgs = static_cast<uint8_t>(
+      std::min<size_t>(numParams, trace::MaxArgs - function.header.isMemberFunction));
+
+   for (auto i = 0u; i < function.header.numArgs; ++i) {
+      auto &arg = function.header.args[i];
+      arg.type = static_cast<trace::ArgType>(params[i].reg_type);
+      arg.flags = (params[i].is_signed ? trace::ArgSigned : 0) |
+                  (params[i].is_pointer ? trace::ArgPointer : 0) |
+                  (params[i].is_string ? trace::ArgString : 0);
+   }
+
+   return static_cast<uint32_t>(sTraceFunctions.size() - 1);
+}
+
 void
-invoke_trace_host_impl(cpu::Core *core, const char *name, bool is_member_function, const RuntimeParamInfo *params, size_t numParams)
+set_trace_name_host_impl(uint32_t traceId, std::string name)
 {
+   std::lock_guard<std::mutex> lock { sTraceFunctionsMutex };
+   if (traceId < sTraceFunctions.size()) {
+      auto &function = sTraceFunctions[traceId];
+      function.name = std::move(name);
+      function.header.nameLength = static_cast<uint16_t>(std::min<size_t>(function.name.size(), 0xFFFF));
+   }
+}
+
+static void
+trace_to_ring(cpu::Core *core, uint32_t traceId, bool is_member_function, const RuntimeParamInfo *params, size_t numParams)
+{
+   if (core->id >= NumCores) {
+      return;
+   }
+
+   auto &ring = sTraceRings[core->id];
+   auto index = ring.writeIndex.load(std::memory_order_relaxed);
+   auto &record = ring.records[index & (TraceRingSize - 1)];
+   auto numArgs = 0u;
+
+   record.time = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+         std::chrono::steady_clock::now() - sTraceRingStart).count());
+   record.function = traceId;
+   record.lr = core->lr;
+   record.string[0] = 0;
+
+   if (is_member_function) {
+      record.args[numArgs++] = readGpr(core, 3);
+   }
+
+   for (auto i = 0u; i < numParams && numArgs < trace::MaxArgs; ++i) {
+      auto &p = params[i];
+      auto value = uint64_t { 0 };
+
+      switch (p.reg_type) {
+      case RegisterType::Gpr32:
+         value = readGpr(core, p.reg_index);
+
+         if (p.is_string && value && !record.string[0]) {
+            auto str = virt_cast<const char *>(static_cast<virt_addr>(static_cast<uint32_t>(value)));
+            std::strncpy(record.string, str.get(), trace::MaxStringLength - 1);
+            record.string[trace::MaxStringLength - 1] = 0;
+         }
+         break;
+      case RegisterType::Gpr64:
+         value = (static_cast<uint64_t>(readGpr(core, p.reg_index)) << 32) |
+                 static_cast<uint64_t>(readGpr(core, p.reg_index + 1));
+         break;
+      case RegisterType::Fpr:
+         value = bit_cast<uint64_t>(core->fpr[p.reg_index].paired0);
+         break;
+      case RegisterType::VarArgs:
+      case RegisterType::Void:
+         break;
+      }
+
+      record.args[numArgs++] = value;
+   }
+
+   ring.writeIndex.store(index + 1, std::memory_order_release);
+}
+
+void
+invoke_trace_host_impl(cpu::Core *core, const char *name, uint32_t traceId, bool is_member_function, const RuntimeParamInfo *params, size_t numParams)
+{
+   if (sTraceRingEnabled.load(std::memory_order_relaxed)) {
+      trace_to_ring(core, traceId, is_member_function, params, numParams);
+      return;
+   }
+
    fmt::memory_buffer message;
    fmt::format_to(message, "{}(", name);
 
@@ -75,4 +302,6 @@ invoke_trace_host_impl(cpu::Core *core, const char *name, bool is_member_functio
    gLog->debug(std::string_view { message.data(), message.size() });
 }
 
-} // namespace cafe::detail
+} // namespace detail
+
+} // namespace cafe
@@ -2,6 +2,7 @@
 #include "cafe_ppc_interface.h"
 
 #include <libcpu/state.h>
+#include <string>
 
 namespace cafe
 {
@@ -9,19 +10,49 @@ namespace cafe
 namespace detail
 {
 
+uint32_t
+register_trace_host_impl(const char *name, bool is_member_function, const RuntimeParamInfo *params, size_t numParams);
+
+void
+set_trace_name_host_impl(uint32_t traceId, std::string name);
+
 void
-invoke_trace_host_impl(cpu::Core *core, const char *name, bool is_member_function, const RuntimeParamInfo *params, size_t numParams);
+invoke_trace_host_impl(cpu::Core *core, const char *name, uint32_t traceId, bool is_member_function, const RuntimeParamInfo *params, size_t numParams);
 
 } // namespace detail
 
+//! Register a host function with the binary trace ring, returning the id
+//! to pass to invoke_trace
+template<typename FunctionType>
+uint32_t
+register_trace(const char *name)
+{
+   using func_traits = detail::function_traits<FunctionType>;
+   return detail::register_trace_host_impl(name, func_traits::is_member_function, func_traits::runtime_param_info.data(), func_traits::runtime_param_info.size());
+}
+
 //! Trace log a host function call from a guest context
 template<typename FunctionType>
 void
 invoke_trace(cpu::Core *core,
-             const char *name)
+             const char *name,
+             uint32_t traceId)
 {
    using func_traits = detail::function_traits<FunctionType>;
-   invoke_trace_host_impl(core, name, func_traits::is_member_function, func_traits::runtime_param_info.data(), func_traits::runtime_param_info.size());
+   invoke_trace_host_impl(core, name, traceId, func_traits::is_member_function, func_traits::runtime_param_info.data(), func_traits::runtime_param_info.size());
 }
 
+//! Record traced calls into the per core binary trace rings rather than
+//! formatting them to the log
+void
+setTraceRingEnabled(bool enabled);
+
+bool
+getTraceRingEnabled();
+
+//! Write the contents of the binary trace rings to path, see
+//! cafe_ppc_interface_trace_format.h for the file format
+bool
+dumpTraceRing(const std::string &path);
+
 } // namespace cafe
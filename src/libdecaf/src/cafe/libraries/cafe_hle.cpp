@@ -67,6 +67,7 @@
 #include "vpad/vpad.h"
 #include "zlib125/zlib125.h"
 
+#include "cafe/cafe_ppc_interface_trace_host.h"
 #include "decaf_config.h"
 #include "decaf_configstorage.h"
 
@@ -79,6 +80,7 @@ namespace cafe::hle
 {
 
 volatile bool FunctionTraceEnabled = false;
+volatile bool FunctionProfileEnabled = false;
 
 static std::array<Library *, static_cast<size_t>(LibraryId::Max)>
 sLibraries;
@@ -161,6 +163,21 @@ initialiseLibraries()
    registerLibrary(new vpad::Library { });
    registerLibrary(new zlib125::Library { });
 
+   // Give the binary trace ring the full library::function names
+   for (auto library : sLibraries) {
+      if (!library) {
+         continue;
+      }
+
+      for (auto &[symbolName, symbol] : library->getSymbolMap()) {
+         if (symbol->type == LibrarySymbol::Function) {
+            auto funcSymbol = static_cast<LibraryFunction *>(symbol.get());
+            cafe::detail::set_trace_name_host_impl(funcSymbol->traceId,
+                                                   library->name() + "::" + funcSymbol->name);
+         }
+      }
+   }
+
    // Register config change handler
    static std::once_flag sRegisteredConfigChangeListener;
    std::call_once(sRegisteredConfigChangeListener,
@@ -168,12 +185,14 @@ initialiseLibraries()
          decaf::registerConfigChangeListener(
             [](const decaf::Settings &settings) {
                setTraceEnabled(settings.log.hle_trace);
+               setTraceRingEnabled(settings.log.hle_trace_binary);
                applyTraceFilters(settings.log.hle_trace_filters);
             });
       });
 
    // Apply trace config
    setTraceEnabled(decaf::config()->log.hle_trace);
+   setTraceRingEnabled(decaf::config()->log.hle_trace_binary);
    applyTraceFilters(decaf::config()->log.hle_trace_filters);
 }
 
@@ -277,4 +296,36 @@ setTraceEnabled(bool enabled)
    FunctionTraceEnabled = enabled;
 }
 
+void
+setProfileEnabled(bool enabled)
+{
+   FunctionProfileEnabled = enabled;
+}
+
+bool
+getProfileEnabled()
+{
+   return FunctionProfileEnabled;
+}
+
+
+/**
+ * Reset the profile counters of every HLE function.
+ */
+void
+resetProfile()
+{
+   for (auto library : sLibraries) {
+      if (!library) {
+         continue;
+      }
+
+      for (auto &[symbolName, symbol] : library->getSymbolMap()) {
+         if (symbol->type == LibrarySymbol::Function) {
+            static_cast<LibraryFunction *>(symbol.get())->profile.reset();
+         }
+      }
+   }
+}
+
 } // namespace cafe::hle
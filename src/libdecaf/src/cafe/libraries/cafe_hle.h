@@ -29,4 +29,13 @@ applyTraceFilters(const std::vector<std::string> &filters);
 void
 setTraceEnabled(bool enabled);
 
+void
+setProfileEnabled(bool enabled);
+
+bool
+getProfileEnabled();
+
+void
+resetProfile();
+
 } // namespace cafe::hle
@@ -3,22 +3,70 @@
 #include "cafe/cafe_ppc_interface_invoke_host.h"
 #include "cafe/cafe_ppc_interface_trace_host.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <common/platform_compiler.h>
 #include <libcpu/cpu_control.h>
 
 namespace cafe::hle
 {
 
 extern volatile bool FunctionTraceEnabled;
+extern volatile bool FunctionProfileEnabled;
+
+/**
+ * Call counts and cumulative host time spent in a HLE function.
+ *
+ * Counters are kept per core, each on its own cache line, so profiling
+ * does not make the cores contend with each other. Calls are counted on
+ * the core they return on, as the calling thread may have been rescheduled
+ * to another core, and the time includes any time spent blocked.
+ */
+struct FunctionProfile
+{
+   static constexpr auto NumCores = 3u;
+
+   struct alignas(64) CoreCounters
+   {
+      std::atomic<uint64_t> calls { 0 };
+      std::atomic<uint64_t> nanoseconds { 0 };
+   };
+
+   void record(cpu::Core *core, std::chrono::steady_clock::time_point start)
+   {
+      if (core->id < NumCores) {
+         auto &counters = cores[core->id];
+         auto elapsed = std::chrono::steady_clock::now() - start;
+         counters.calls.fetch_add(1, std::memory_order_relaxed);
+         counters.nanoseconds.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+            std::memory_order_relaxed);
+      }
+   }
+
+   void reset()
+   {
+      for (auto &counters : cores) {
+         counters.calls.store(0, std::memory_order_relaxed);
+         counters.nanoseconds.store(0, std::memory_order_relaxed);
+      }
+   }
+
+   std::array<CoreCounters, NumCores> cores;
+};
 
 using InvokeHandler = cpu::Core * (*)(cpu::Core * core, uint32_t id);
 
 struct LibraryFunction : public LibrarySymbol
 {
    LibraryFunction(InvokeHandler _invokeHandler,
-                   bool& _traceEnabledRef) :
+                   bool& _traceEnabledRef,
+                   FunctionProfile &_profileRef) :
       LibrarySymbol(LibrarySymbol::Function),
       invokeHandler(_invokeHandler),
-      traceEnabled(_traceEnabledRef)
+      traceEnabled(_traceEnabledRef),
+      profile(_profileRef)
    {
    }
 
@@ -33,9 +81,16 @@ struct LibraryFunction : public LibrarySymbol
    // value, specifying whether trace logging is enabled for this function or not.
    bool &traceEnabled;
 
+   //! Reference to the underlying invoke handler trace wrapper's profile
+   // counters, only updated whilst FunctionProfileEnabled is set.
+   FunctionProfile &profile;
+
    //! ID number of syscall.
    uint32_t syscallID = 0xFFFFFFFFu;
 
+   //! ID of this function in the binary trace ring function table.
+   uint32_t traceId = 0xFFFFFFFFu;
+
    //! Pointer to host function pointer, only set for internal functions.
    virt_ptr<void> *hostPtr = nullptr;
 };
@@ -49,25 +104,41 @@ struct TracingWrapper
    static inline cpu::Core *wrapped(cpu::Core *core, uint32_t kcId)
    {
       if (FunctionTraceEnabled && traceEnabled) {
-         invoke_trace<FunctionType>(core, traceName.c_str());
+         invoke_trace<FunctionType>(core, traceName.c_str(), traceId);
+      }
+
+      if (UNLIKELY(FunctionProfileEnabled)) {
+         auto start = std::chrono::steady_clock::now();
+         core = invoke<FunctionType, Func>(core);
+         profile.record(core, start);
+         return core;
       }
 
       return invoke<FunctionType, Func>(core);
    }
 
    static inline std::string traceName = "_missingName";
+   static inline uint32_t traceId = 0xFFFFFFFFu;
    static inline bool traceEnabled = false;
+   static inline FunctionProfile profile;
 };
 
 template<typename FunctionType, FunctionType Func>
 inline std::unique_ptr<LibraryFunction>
 makeLibraryFunction(const std::string &name)
 {
-   TracingWrapper<FunctionType, Func>::traceName = name;
+   using Wrapper = TracingWrapper<FunctionType, Func>;
+   Wrapper::traceName = name;
+
+   if (Wrapper::traceId == 0xFFFFFFFFu) {
+      Wrapper::traceId = register_trace<FunctionType>(name.c_str());
+   }
 
    auto libraryFunction = new LibraryFunction(
       TracingWrapper<FunctionType, Func>::wrapped,
-      TracingWrapper<FunctionType, Func>::traceEnabled);
+      TracingWrapper<FunctionType, Func>::traceEnabled,
+      TracingWrapper<FunctionType, Func>::profile);
+   libraryFunction->traceId = Wrapper::traceId;
    return std::unique_ptr<LibraryFunction> { libraryFunction };
 }
 
@@ -8,6 +8,7 @@
 #include "gx2_registers.h"
 #include "gx2_state.h"
 
+#include "cafe/kernel/cafe_kernel_process.h"
 #include "cafe/libraries/coreinit/coreinit_core.h"
 #include "cafe/libraries/coreinit/coreinit_memdefaultheap.h"
 #include "cafe/libraries/tcl/tcl_driver.h"
@@ -117,6 +118,7 @@ GX2Init(virt_ptr<GX2InitAttrib> attributes)
 
    // Initialise GPU callbacks
    gpu::setFlipCallback(&internal::onFlip);
+   gpu::setActiveTitleId(kernel::getCurrentTitleId());
 
    // Initialise command buffer pools
    internal::initialiseCommandBufferPool(cbPoolBase, cbPoolSize);
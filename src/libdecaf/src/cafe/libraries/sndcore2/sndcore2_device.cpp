@@ -2,14 +2,18 @@
 #include "sndcore2_config.h"
 #include "sndcore2_constants.h"
 #include "sndcore2_device.h"
+#include "sndcore2_mix.h"
 #include "sndcore2_voice.h"
+#include "decaf_config.h"
 #include "decaf_sound.h"
 
 #include "cafe/cafe_ppc_interface_invoke_guest.h"
 
 #include <array>
 #include <common/fixed.h>
+#include <common/workerpool.h>
 #include <libcpu/mmu.h>
+#include <vector>
 
 namespace cafe::sndcore2
 {
@@ -295,21 +299,63 @@ sampleVoice(virt_ptr<AXVoice> voice,
    extras->src.currentOffsetFrac = ufixed_0_16_t { offsetFrac };
 }
 
+//! Frames with fewer active voices than this are always decoded serially.
+static constexpr size_t MinParallelVoices = 8;
+
+//! Decodes the active voices of a frame across a set of host worker threads,
+//! with the calling guest core also taking part. Each voice only reads its
+//! own sample data and only writes to its own AXVoice and AXVoiceExtras, and
+//! mixing iterates the voices in acquisition order after they have all been
+//! decoded, so the output does not depend on thread scheduling.
+static WorkerPool
+sDecodePool;
+
+struct DecodeVoicesContext
+{
+   const std::vector<virt_ptr<AXVoice>> *voices;
+   int numSamples;
+};
+
+static void
+decodeVoice(virt_ptr<AXVoice> voice,
+            int numSamples)
+{
+   auto extras = getVoiceExtras(voice->index);
+
+   if (voice->state == AXVoiceState::Stopped) {
+      extras->numSamples = 0;
+      return;
+   }
+
+   extras->numSamples = numSamples;
+   sampleVoice(voice, extras->samples, numSamples);
+}
+
+static void
+decodeVoiceRange(const void *context,
+                 uint32_t first,
+                 uint32_t last)
+{
+   auto decode = reinterpret_cast<const DecodeVoicesContext *>(context);
+
+   for (auto i = first; i < last; ++i) {
+      decodeVoice((*decode->voices)[i], decode->numSamples);
+   }
+}
+
 void
 decodeVoiceSamples(int numSamples)
 {
    const auto voices = getAcquiredVoices();
+   auto context = DecodeVoicesContext { &voices, numSamples };
+   auto numVoices = static_cast<uint32_t>(voices.size());
 
-   for (auto voice : voices) {
-      auto extras = getVoiceExtras(voice->index);
-
-      if (voice->state == AXVoiceState::Stopped) {
-         extras->numSamples = 0;
-         continue;
-      }
+   sDecodePool.setNumThreads(decaf::config()->sound.decode_threads);
 
-      extras->numSamples = numSamples;
-      sampleVoice(voice, extras->samples, numSamples);
+   if (numVoices < MinParallelVoices) {
+      decodeVoiceRange(&context, 0, numVoices);
+   } else {
+      sDecodePool.run(numVoices, 1, decodeVoiceRange, &context);
    }
 
    // TODO: Apply Volume Evelope (ADSR)
@@ -321,6 +367,14 @@ decodeVoiceSamples(int numSamples)
 
 static Pcm16Sample gTvSamples[AXNumTvDevices][AXNumTvChannels][NumOutputSamples];
 
+static_assert(sizeof(Pcm16Sample) == sizeof(int16_t));
+
+static inline int16_t *
+toRawSamples(Pcm16Sample *samples)
+{
+   return reinterpret_cast<int16_t *>(samples);
+}
+
 static void
 invokeAuxCallback(AuxData &aux, uint32_t numChannels, uint32_t numSamples, Pcm16Sample samples[6][144])
 {
@@ -497,10 +551,13 @@ mixDevice(AXDeviceType type, uint16_t numSamples)
          for (auto bus = 0u; bus < numBus; ++bus) {
             for (auto channel = 0u; channel < numChannels; ++channel) {
                auto &volume = getVoiceMixVolume(extras, type, deviceId, channel, bus);
-               auto &out = busSamples[bus][deviceId][channel];
 
-               for (auto i = 0u; i < numSamples; ++i) {
-                  out[i] += extras->samples[i] * volume.volume;
+               // Most voices only play on a few of the buses and channels
+               if (auto volumeRaw = fixed_to_data(volume.volume)) {
+                  mixSamples(toRawSamples(busSamples[bus][deviceId][channel]),
+                             toRawSamples(extras->samples),
+                             volumeRaw,
+                             numSamples);
                }
 
                volume.volume += volume.delta;
@@ -524,25 +581,32 @@ mixDevice(AXDeviceType type, uint16_t numSamples)
       auto &device = devices->devices[deviceId];
 
       for (auto bus = 1u; bus < numBus; ++bus) {
-         auto returnVolume = device.aux[bus - 1].returnVolume;
+         auto returnVolume = fixed_to_data(device.aux[bus - 1].returnVolume);
          auto subBus = busSamples[bus];
 
+         if (!returnVolume) {
+            continue;
+         }
+
          for (auto channel = 0u; channel < numChannels; ++channel) {
-            for (auto i = 0u; i < numSamples; ++i) {
-               mainBus[deviceId][channel][i] += subBus[deviceId][channel][i] * returnVolume;
-            }
+            mixSamples(toRawSamples(mainBus[deviceId][channel]),
+                       toRawSamples(subBus[deviceId][channel]),
+                       returnVolume,
+                       numSamples);
          }
       }
    }
 
    // Apply overall device volume
    for (auto deviceId = 0u; deviceId < numDevices; ++deviceId) {
-      auto &device = devices->devices[deviceId];
+      auto volume = fixed_to_data(devices->devices[deviceId].volume);
+
+      if (volume == fixed_to_data(DefaultVolume)) {
+         continue;
+      }
 
       for (auto channel = 0u; channel < numChannels; ++channel) {
-         for (auto i = 0u; i < numSamples; ++i) {
-            mainBus[deviceId][channel][i] = mainBus[deviceId][channel][i] * device.volume;
-         }
+         scaleSamples(toRawSamples(mainBus[deviceId][channel]), volume, numSamples);
       }
    }
 
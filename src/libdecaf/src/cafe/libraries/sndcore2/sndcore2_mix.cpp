@@ -0,0 +1,252 @@
+#include "sndcore2_mix.h"
+
+#include <common/platform_intrin.h>
+
+namespace cafe::sndcore2::internal
+{
+
+static inline int16_t
+truncateSample(int32_t value)
+{
+   // Integer division rounds towards zero like the fixed point conversion
+   return static_cast<int16_t>(value / 0x8000);
+}
+
+static inline int16_t
+mixSample(int16_t out,
+          int16_t sample,
+          uint16_t volume)
+{
+   // The sum can overflow 32 bits for large volumes, which must wrap
+   auto product = static_cast<int32_t>(sample) * static_cast<int32_t>(volume);
+   auto sum = static_cast<uint32_t>(out * 0x8000) + static_cast<uint32_t>(product);
+   return truncateSample(static_cast<int32_t>(sum));
+}
+
+void
+mixSamplesScalar(int16_t *out,
+                 const int16_t *samples,
+                 uint16_t volume,
+                 uint32_t numSamples)
+{
+   for (auto i = 0u; i < numSamples; ++i) {
+      out[i] = mixSample(out[i], samples[i], volume);
+   }
+}
+
+void
+scaleSamplesScalar(int16_t *out,
+                   uint16_t volume,
+                   uint32_t numSamples)
+{
+   for (auto i = 0u; i < numSamples; ++i) {
+      out[i] = truncateSample(static_cast<int32_t>(out[i]) * volume);
+   }
+}
+
+
+/*
+The SIMD kernels work on 8 or 16 samples at a time, widening the 16 bit
+samples to 32 bit lanes for the products and sums. The unpack and pack
+instructions operate within 128 bit lanes, so the AVX2 kernels end up with
+the samples back in their original order without any extra permutes.
+
+_mm_mulhi_epi16 is a signed multiply, when the top bit of the volume is set
+the high half of the product is short by samples * 0x10000, which is
+corrected by adding volumeFix (samples & 0xFFFF or 0) to it.
+*/
+
+static inline __m128i
+truncateSSE2(__m128i sum)
+{
+   auto bias = _mm_srli_epi32(_mm_srai_epi32(sum, 31), 17);
+   auto result = _mm_srai_epi32(_mm_add_epi32(sum, bias), 15);
+   return _mm_srai_epi32(_mm_slli_epi32(result, 16), 16);
+}
+
+static inline void
+multiplySSE2(__m128i samples,
+             __m128i volume,
+             __m128i volumeFix,
+             __m128i &productLo,
+             __m128i &productHi)
+{
+   auto lo = _mm_mullo_epi16(samples, volume);
+   auto hi = _mm_add_epi16(_mm_mulhi_epi16(samples, volume),
+                           _mm_and_si128(samples, volumeFix));
+   productLo = _mm_unpacklo_epi16(lo, hi);
+   productHi = _mm_unpackhi_epi16(lo, hi);
+}
+
+uint32_t
+mixSamplesSSE2(int16_t *out,
+               const int16_t *samples,
+               uint16_t volume,
+               uint32_t numSamples)
+{
+   auto zero = _mm_setzero_si128();
+   auto volumeVec = _mm_set1_epi16(static_cast<int16_t>(volume));
+   auto volumeFix = _mm_set1_epi16((volume & 0x8000) ? -1 : 0);
+   auto i = 0u;
+
+   for (; i + 8 <= numSamples; i += 8) {
+      auto outPtr = reinterpret_cast<__m128i *>(out + i);
+      auto outVec = _mm_loadu_si128(outPtr);
+      auto samplesVec = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+
+      auto productLo = __m128i { };
+      auto productHi = __m128i { };
+      multiplySSE2(samplesVec, volumeVec, volumeFix, productLo, productHi);
+
+      // (out << 16) >> 1 sign extends out * 0x8000 to 32 bits
+      auto outLo = _mm_srai_epi32(_mm_unpacklo_epi16(zero, outVec), 1);
+      auto outHi = _mm_srai_epi32(_mm_unpackhi_epi16(zero, outVec), 1);
+
+      _mm_storeu_si128(outPtr,
+                       _mm_packs_epi32(truncateSSE2(_mm_add_epi32(outLo, productLo)),
+                                       truncateSSE2(_mm_add_epi32(outHi, productHi))));
+   }
+
+   return i;
+}
+
+uint32_t
+scaleSamplesSSE2(int16_t *out,
+                 uint16_t volume,
+                 uint32_t numSamples)
+{
+   auto volumeVec = _mm_set1_epi16(static_cast<int16_t>(volume));
+   auto volumeFix = _mm_set1_epi16((volume & 0x8000) ? -1 : 0);
+   auto i = 0u;
+
+   for (; i + 8 <= numSamples; i += 8) {
+      auto outPtr = reinterpret_cast<__m128i *>(out + i);
+      auto productLo = __m128i { };
+      auto productHi = __m128i { };
+      multiplySSE2(_mm_loadu_si128(outPtr), volumeVec, volumeFix, productLo, productHi);
+
+      _mm_storeu_si128(outPtr,
+                       _mm_packs_epi32(truncateSSE2(productLo),
+                                       truncateSSE2(productHi)));
+   }
+
+   return i;
+}
+
+PLATFORM_TARGET_AVX2 static inline __m256i
+truncateAVX2(__m256i sum)
+{
+   auto bias = _mm256_srli_epi32(_mm256_srai_epi32(sum, 31), 17);
+   auto result = _mm256_srai_epi32(_mm256_add_epi32(sum, bias), 15);
+   return _mm256_srai_epi32(_mm256_slli_epi32(result, 16), 16);
+}
+
+PLATFORM_TARGET_AVX2 static inline void
+multiplyAVX2(__m256i samples,
+             __m256i volume,
+             __m256i volumeFix,
+             __m256i &productLo,
+             __m256i &productHi)
+{
+   auto lo = _mm256_mullo_epi16(samples, volume);
+   auto hi = _mm256_add_epi16(_mm256_mulhi_epi16(samples, volume),
+                              _mm256_and_si256(samples, volumeFix));
+   productLo = _mm256_unpacklo_epi16(lo, hi);
+   productHi = _mm256_unpackhi_epi16(lo, hi);
+}
+
+PLATFORM_TARGET_AVX2 uint32_t
+mixSamplesAVX2(int16_t *out,
+               const int16_t *samples,
+               uint16_t volume,
+               uint32_t numSamples)
+{
+   auto zero = _mm256_setzero_si256();
+   auto volumeVec = _mm256_set1_epi16(static_cast<int16_t>(volume));
+   auto volumeFix = _mm256_set1_epi16((volume & 0x8000) ? -1 : 0);
+   auto i = 0u;
+
+   for (; i + 16 <= numSamples; i += 16) {
+      auto outPtr = reinterpret_cast<__m256i *>(out + i);
+      auto outVec = _mm256_loadu_si256(outPtr);
+      auto samplesVec = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + i));
+
+      auto productLo = __m256i { };
+      auto productHi = __m256i { };
+      multiplyAVX2(samplesVec, volumeVec, volumeFix, productLo, productHi);
+
+      auto outLo = _mm256_srai_epi32(_mm256_unpacklo_epi16(zero, outVec), 1);
+      auto outHi = _mm256_srai_epi32(_mm256_unpackhi_epi16(zero, outVec), 1);
+
+      _mm256_storeu_si256(outPtr,
+                          _mm256_packs_epi32(truncateAVX2(_mm256_add_epi32(outLo, productLo)),
+                                             truncateAVX2(_mm256_add_epi32(outHi, productHi))));
+   }
+
+   return i;
+}
+
+PLATFORM_TARGET_AVX2 uint32_t
+scaleSamplesAVX2(int16_t *out,
+                 uint16_t volume,
+                 uint32_t numSamples)
+{
+   auto volumeVec = _mm256_set1_epi16(static_cast<int16_t>(volume));
+   auto volumeFix = _mm256_set1_epi16((volume & 0x8000) ? -1 : 0);
+   auto i = 0u;
+
+   for (; i + 16 <= numSamples; i += 16) {
+      auto outPtr = reinterpret_cast<__m256i *>(out + i);
+      auto productLo = __m256i { };
+      auto productHi = __m256i { };
+      multiplyAVX2(_mm256_loadu_si256(outPtr), volumeVec, volumeFix, productLo, productHi);
+
+      _mm256_storeu_si256(outPtr,
+                          _mm256_packs_epi32(truncateAVX2(productLo),
+                                             truncateAVX2(productHi)));
+   }
+
+   return i;
+}
+
+bool
+mixSamplesUseAvx2()
+{
+   static const auto hasAvx2 = platform::hasAvx2();
+   return hasAvx2;
+}
+
+
+/**
+ * out[i] += samples[i] * volume
+ */
+void
+mixSamples(int16_t *out,
+           const int16_t *samples,
+           uint16_t volume,
+           uint32_t numSamples)
+{
+   auto i = mixSamplesUseAvx2() ?
+      mixSamplesAVX2(out, samples, volume, numSamples) :
+      mixSamplesSSE2(out, samples, volume, numSamples);
+
+   mixSamplesScalar(out + i, samples + i, volume, numSamples - i);
+}
+
+
+/**
+ * out[i] = out[i] * volume
+ */
+void
+scaleSamples(int16_t *out,
+             uint16_t volume,
+             uint32_t numSamples)
+{
+   auto i = mixSamplesUseAvx2() ?
+      scaleSamplesAVX2(out, volume, numSamples) :
+      scaleSamplesSSE2(out, volume, numSamples);
+
+   scaleSamplesScalar(out + i, volume, numSamples - i);
+}
+
+} // namespace cafe::sndcore2::internal
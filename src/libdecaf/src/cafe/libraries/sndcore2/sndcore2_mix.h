@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+
+namespace cafe::sndcore2::internal
+{
+
+/*
+The mixing kernels operate on the raw representation of the fixed point
+types used by the mixer, Pcm16Sample (signed 1.15) and ufixed_1_15_t
+(unsigned 1.15), and must give bit identical results to the equivalent
+fixed point expressions:
+
+   mixSamples:   out[i] += samples[i] * volume
+   scaleSamples: out[i] = out[i] * volume
+
+That is, the product has 30 fractional bits and is summed with out in a
+32 bit integer before being truncated towards zero back to 15 fractional
+bits, and wrapped to 16 bits.
+
+The SSE2 and AVX2 kernels only process whole vectors and return the number
+of samples they processed, the rest must be finished with the scalar
+kernels. mixSamples and scaleSamples pick the best kernel for the host, the
+individual kernels are exposed for the tests, the AVX2 ones must only be
+used when mixSamplesUseAvx2() returns true.
+*/
+
+void
+mixSamples(int16_t *out,
+           const int16_t *samples,
+           uint16_t volume,
+           uint32_t numSamples);
+
+void
+scaleSamples(int16_t *out,
+             uint16_t volume,
+             uint32_t numSamples);
+
+void
+mixSamplesScalar(int16_t *out,
+                 const int16_t *samples,
+                 uint16_t volume,
+                 uint32_t numSamples);
+
+void
+scaleSamplesScalar(int16_t *out,
+                   uint16_t volume,
+                   uint32_t numSamples);
+
+uint32_t
+mixSamplesSSE2(int16_t *out,
+               const int16_t *samples,
+               uint16_t volume,
+               uint32_t numSamples);
+
+uint32_t
+scaleSamplesSSE2(int16_t *out,
+                 uint16_t volume,
+                 uint32_t numSamples);
+
+uint32_t
+mixSamplesAVX2(int16_t *out,
+               const int16_t *samples,
+               uint16_t volume,
+               uint32_t numSamples);
+
+uint32_t
+scaleSamplesAVX2(int16_t *out,
+                 uint16_t volume,
+                 uint32_t numSamples);
+
+bool
+mixSamplesUseAvx2();
+
+} // namespace cafe::sndcore2::internal
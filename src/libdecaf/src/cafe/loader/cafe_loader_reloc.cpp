@@ -12,6 +12,7 @@
 #include "cafe/libraries/cafe_hle.h"
 
 #include <libcpu/be2_struct.h>
+#include <libcpu/cpu_control.h>
 #include <libcpu/cpu_formatters.h>
 #include <libcpu/espresso/espresso_instructionset.h>
 #include <libcpu/espresso/espresso_spr.h>
@@ -733,6 +734,7 @@ LiFixupRelocOneRPL(virt_ptr<LOADED_RPL> rpl,
       }
 
       LiSafeFlushCode(textAddress, rpl->textBufferSize);
+      cpu::addJitCodeRange(textAddress.getAddress(), rpl->textBufferSize);
    }
 
    // Relocate entry point
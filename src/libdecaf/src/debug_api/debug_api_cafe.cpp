@@ -1,8 +1,10 @@
 #include "decaf_debug_api.h"
 
+#include "cafe/cafe_ppc_interface_trace_host.h"
 #include "cafe/loader/cafe_loader_entry.h"
 #include "cafe/loader/cafe_loader_loaded_rpl.h"
 
+#include "cafe/libraries/cafe_hle.h"
 #include "cafe/libraries/coreinit/coreinit_enum_string.h"
 #include "cafe/libraries/coreinit/coreinit_scheduler.h"
 #include "cafe/libraries/coreinit/coreinit_thread.h"
@@ -222,4 +224,81 @@ sampleCafeVoices(std::vector<CafeVoice> &voiceInfos)
    return true;
 }
 
+bool
+dumpHleTrace(const std::string &path)
+{
+   if (!cafe::getTraceRingEnabled()) {
+      return false;
+   }
+
+   return cafe::dumpTraceRing(path);
+}
+
+void
+setHleProfilingEnabled(bool enabled)
+{
+   cafe::hle::setProfileEnabled(enabled);
+}
+
+bool
+hleProfilingEnabled()
+{
+   return cafe::hle::getProfileEnabled();
+}
+
+void
+resetHleProfile()
+{
+   cafe::hle::resetProfile();
+}
+
+
+/**
+ * Sample the profile counters of every HLE function which has been called
+ * since profiling was enabled or last reset.
+ */
+bool
+sampleHleProfile(std::vector<CafeHleFunctionProfile> &profile)
+{
+   using cafe::hle::LibraryFunction;
+   using cafe::hle::LibraryId;
+   using cafe::hle::LibrarySymbol;
+   static_assert(std::tuple_size<decltype(CafeHleFunctionProfile::calls)>::value ==
+                 cafe::hle::FunctionProfile::NumCores);
+   profile.clear();
+
+   for (auto i = 0u; i < static_cast<unsigned>(LibraryId::Max); ++i) {
+      auto library = cafe::hle::getLibrary(static_cast<LibraryId>(i));
+      if (!library) {
+         continue;
+      }
+
+      for (auto &[symbolName, symbol] : library->getSymbolMap()) {
+         if (symbol->type != LibrarySymbol::Function) {
+            continue;
+         }
+
+         auto funcSymbol = static_cast<LibraryFunction *>(symbol.get());
+         auto info = CafeHleFunctionProfile { };
+         auto totalCalls = uint64_t { 0 };
+
+         for (auto core = 0u; core < info.calls.size(); ++core) {
+            auto &counters = funcSymbol->profile.cores[core];
+            info.calls[core] = counters.calls.load(std::memory_order_relaxed);
+            info.time[core] = std::chrono::nanoseconds {
+               counters.nanoseconds.load(std::memory_order_relaxed) };
+            totalCalls += info.calls[core];
+         }
+
+         if (totalCalls) {
+            info.library = library->name();
+            info.function = funcSymbol->name;
+            profile.push_back(std::move(info));
+         }
+      }
+   }
+
+   return true;
+}
+
 } // namespace decaf::debug
@@ -5,6 +5,7 @@
 #include "decaf_slc.h"
 #include "decaf_sound.h"
 
+#include "cafe/cafe_ppc_interface_trace_host.h"
 #include "cafe/kernel/cafe_kernel.h"
 #include "cafe/kernel/cafe_kernel_process.h"
 #include "cafe/libraries/coreinit/coreinit_scheduler.h"
@@ -12,6 +13,7 @@
 #include "cafe/libraries/swkbd/swkbd_keyboard.h"
 #include "debugger/debugger.h"
 #include "vfs/vfs_host_device.h"
+#include "vfs/vfs_packed_device.h"
 #include "vfs/vfs_virtual_device.h"
 #include "input/input.h"
 #include "ios/ios.h"
@@ -22,6 +24,7 @@
 #include <common/platform.h>
 #include <common/platform_dir.h>
 #include <condition_variable>
+#include <ctime>
 #include <curl/curl.h>
 #include <filesystem>
 #include <fmt/core.h>
@@ -101,6 +104,7 @@ initialise(const std::string &gamePath)
    auto path = std::filesystem::path { gamePath };
    auto volPath = std::filesystem::path { };
    auto rpxPath = std::filesystem::path { };
+   auto packedDevice = std::shared_ptr<vfs::PackedDevice> { };
 
    if (std::filesystem::is_directory(path)) {
       if (std::filesystem::is_regular_file(path / "code" / "cos.xml")) {
@@ -114,7 +118,14 @@ initialise(const std::string &gamePath)
       auto parent1 = path.parent_path();
       auto parent2 = parent1.parent_path();
 
-      if (std::filesystem::is_regular_file(parent2 / "code" / "cos.xml")) {
+      if (path.extension().compare(".dpak") == 0) {
+         // Found packed image containing code/cos.xml
+         packedDevice = std::make_shared<vfs::PackedDevice>();
+         if (packedDevice->open(path) != vfs::Error::Success ||
+             !packedDevice->status(user, "code/cos.xml")) {
+            packedDevice.reset();
+         }
+      } else if (std::filesystem::is_regular_file(parent2 / "code" / "cos.xml")) {
          // Found file/../code/cos.xml
          volPath = parent2;
       } else if (path.extension().compare(".rpx") == 0) {
@@ -128,15 +139,23 @@ initialise(const std::string &gamePath)
    filesystem->makeFolder(user, "/vol/sys");
    filesystem->makeFolder(user, "/vol/temp");
 
-   if (!volPath.empty()) {
-      filesystem->mountDevice(user, "/vol/code", std::make_shared<vfs::HostDevice>(volPath / "code"));
-      filesystem->mountDevice(user, "/vol/content", std::make_shared<vfs::HostDevice>(volPath / "content"));
-      filesystem->mountDevice(user, "/vol/meta", std::make_shared<vfs::HostDevice>(volPath / "meta"));
+   if (packedDevice) {
+      for (auto volume : { "code", "content", "meta" }) {
+         if (packedDevice->status(user, volume)) {
+            filesystem->mountDevice(user, fmt::format("/vol/{}", volume),
+                                    *packedDevice->getLinkDevice(user, volume));
+         }
+      }
+   } else if (!volPath.empty()) {
+      // Title content is read only, so can be memory mapped.
+      filesystem->mountDevice(user, "/vol/code", std::make_shared<vfs::HostDevice>(volPath / "code", true));
+      filesystem->mountDevice(user, "/vol/content", std::make_shared<vfs::HostDevice>(volPath / "content", true));
+      filesystem->mountDevice(user, "/vol/meta", std::make_shared<vfs::HostDevice>(volPath / "meta", true));
    } else if (!rpxPath.empty()) {
-      filesystem->mountDevice(user, "/vol/code", std::make_shared<vfs::HostDevice>(rpxPath.parent_path()));
+      filesystem->mountDevice(user, "/vol/code", std::make_shared<vfs::HostDevice>(rpxPath.parent_path(), true));
 
       if (!decaf::config()->system.content_path.empty()) {
-         filesystem->mountDevice(user, "/vol/content", std::make_shared<vfs::HostDevice>(decaf::config()->system.content_path));
+         filesystem->mountDevice(user, "/vol/content", std::make_shared<vfs::HostDevice>(decaf::config()->system.content_path, true));
       }
 
       cafe::kernel::setExecutableFilename(rpxPath.filename().string());
@@ -234,6 +253,20 @@ shutdown()
    ios::join();
    cafe::kernel::join();
 
+   // Save the binary HLE trace
+   if (cafe::getTraceRingEnabled()) {
+      auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+      auto time = std::localtime(&now);
+      auto path = std::filesystem::path { decaf::config()->log.directory } /
+         fmt::format("hle_trace_{}-{:02}-{:02}_{:02}-{:02}-{:02}.bin",
+                     time->tm_year + 1900, time->tm_mon, time->tm_mday,
+                     time->tm_hour, time->tm_min, time->tm_sec);
+
+      if (cafe::dumpTraceRing(path.string())) {
+         gLog->info("Saved HLE trace to {}", path.string());
+      }
+   }
+
    // Stop graphics driver
    auto graphicsDriver = getGraphicsDriver();
 
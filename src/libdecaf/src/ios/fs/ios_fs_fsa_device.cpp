@@ -7,6 +7,7 @@
 
 #include <common/strutils.h>
 #include <libcpu/cpu_formatters.h>
+#include <libcpu/memtrack.h>
 
 namespace ios::fs::internal
 {
@@ -540,11 +541,18 @@ FSADevice::readFile(vfs::User user,
       return error;
    }
 
+   // The host file read writes to guest memory directly, so write tracking
+   // must not have the buffer protected whilst it does.
+   auto result = vfs::Result<int64_t> { 0 };
+   cpu::beginHostWrite(phys_cast<phys_addr>(buffer), bufferLen);
    if (request->readFlags & FSAReadFlag::ReadWithPos) {
-      handle->file->seek(vfs::FileHandle::SeekStart, request->pos);
+      result = handle->file->readAt(buffer.get(), request->size, request->count,
+                                    request->pos);
+   } else {
+      result = handle->file->read(buffer.get(), request->size, request->count);
    }
+   cpu::endHostWrite(phys_cast<phys_addr>(buffer), bufferLen);
 
-   auto result = handle->file->read(buffer.get(), request->size, request->count);
    if (!result) {
       return translateError(result.error());
    }
@@ -14,8 +14,13 @@
 #include "ios/ios_stackobject.h"
 #include "ios/ios_worker_thread.h"
 
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+
 using namespace ios::kernel;
 using ios::internal::submitWorkerTask;
+using ios::internal::WorkerTaskKey;
 
 namespace ios::fs::internal
 {
@@ -45,6 +50,12 @@ sData = nullptr;
 static HandleManager<FSADevice, FSADeviceHandle, FSAMaxClients>
 sDevices;
 
+//! Held shared by tasks which only use an already open file or directory
+//! handle, and exclusively by everything else, as the file system and the
+//! client handle tables are not thread safe.
+static std::shared_mutex
+sFileSystemMutex;
+
 FSAStatus
 getDevice(FSADeviceHandle handle,
           FSADevice **outDevice)
@@ -87,6 +98,52 @@ fsaDeviceClose(FSADeviceHandle handle,
    return FSAStatus::OK;
 }
 
+
+/**
+ * Submit a task which only operates on an open file or directory handle.
+ *
+ * These are ordered per handle, so reads on different handles can run
+ * concurrently whilst reads on the same handle complete in order.
+ */
+static void
+submitHandleTask(phys_ptr<ResourceRequest> resourceRequest,
+                 int32_t handle,
+                 std::function<FSAStatus()> task)
+{
+   auto key = (static_cast<WorkerTaskKey>(resourceRequest->requestData.handle) << 32) |
+              static_cast<uint32_t>(handle);
+
+   submitWorkerTask(key, [=]() {
+         auto lock = std::shared_lock { sFileSystemMutex };
+         auto status = task();
+         lock.unlock();
+
+         fsaAsyncTaskComplete(resourceRequest, status);
+      });
+}
+
+
+/**
+ * Submit a task which may open or close handles or modify the file system.
+ *
+ * These are ordered per client and run exclusively from all other tasks.
+ */
+static void
+submitClientTask(phys_ptr<ResourceRequest> resourceRequest,
+                 std::function<FSAStatus()> task)
+{
+   // Handles start at 1, so a low word of 0 never clashes with submitHandleTask
+   auto key = static_cast<WorkerTaskKey>(resourceRequest->requestData.handle) << 32;
+
+   submitWorkerTask(key, [=]() {
+         auto lock = std::unique_lock { sFileSystemMutex };
+         auto status = task();
+         lock.unlock();
+
+         fsaAsyncTaskComplete(resourceRequest, status);
+      });
+}
+
 static void
 fsaDeviceIoctl(phys_ptr<ResourceRequest> resourceRequest,
                FSACommand command,
@@ -127,184 +184,136 @@ fsaDeviceIoctl(phys_ptr<ResourceRequest> resourceRequest,
 
    switch (command) {
    case FSACommand::AppendFile:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->appendFile(user, phys_addrof(request->appendFile)));
+      submitHandleTask(resourceRequest, request->appendFile.handle, [=]() {
+            return device->appendFile(user, phys_addrof(request->appendFile));
          });
       break;
    case FSACommand::ChangeDir:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->changeDir(user, phys_addrof(request->changeDir)));
+      submitClientTask(resourceRequest, [=]() {
+            return device->changeDir(user, phys_addrof(request->changeDir));
          });
       break;
    case FSACommand::ChangeMode:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->changeMode(user, phys_addrof(request->changeMode)));
+      submitClientTask(resourceRequest, [=]() {
+            return device->changeMode(user, phys_addrof(request->changeMode));
          });
       break;
    case FSACommand::CloseDir:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->closeDir(user, phys_addrof(request->closeDir)));
+      submitHandleTask(resourceRequest, request->closeDir.handle, [=]() {
+            return device->closeDir(user, phys_addrof(request->closeDir));
          });
       break;
    case FSACommand::CloseFile:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->closeFile(user, phys_addrof(request->closeFile)));
+      submitHandleTask(resourceRequest, request->closeFile.handle, [=]() {
+            return device->closeFile(user, phys_addrof(request->closeFile));
          });
       break;
    case FSACommand::FlushFile:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->flushFile(user, phys_addrof(request->flushFile)));
+      submitHandleTask(resourceRequest, request->flushFile.handle, [=]() {
+            return device->flushFile(user, phys_addrof(request->flushFile));
          });
       break;
    case FSACommand::FlushQuota:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->flushQuota(user, phys_addrof(request->flushQuota)));
+      submitClientTask(resourceRequest, [=]() {
+            return device->flushQuota(user, phys_addrof(request->flushQuota));
          });
       break;
    case FSACommand::GetCwd:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->getCwd(user, phys_addrof(response->getCwd)));
+      submitClientTask(resourceRequest, [=]() {
+            return device->getCwd(user, phys_addrof(response->getCwd));
          });
       break;
    case FSACommand::GetInfoByQuery:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->getInfoByQuery(user,
-                                      phys_addrof(request->getInfoByQuery),
-                                      phys_addrof(response->getInfoByQuery)));
+      submitClientTask(resourceRequest, [=]() {
+            return device->getInfoByQuery(user,
+                                          phys_addrof(request->getInfoByQuery),
+                                          phys_addrof(response->getInfoByQuery));
          });
       break;
    case FSACommand::GetPosFile:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->getPosFile(user,
-                                  phys_addrof(request->getPosFile),
-                                  phys_addrof(response->getPosFile)));
+      submitHandleTask(resourceRequest, request->getPosFile.handle, [=]() {
+            return device->getPosFile(user,
+                                      phys_addrof(request->getPosFile),
+                                      phys_addrof(response->getPosFile));
          });
       break;
    case FSACommand::IsEof:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->isEof(user, phys_addrof(request->isEof)));
+      submitHandleTask(resourceRequest, request->isEof.handle, [=]() {
+            return device->isEof(user, phys_addrof(request->isEof));
          });
       break;
    case FSACommand::MakeDir:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->makeDir(user, phys_addrof(request->makeDir)));
+      submitClientTask(resourceRequest, [=]() {
+            return device->makeDir(user, phys_addrof(request->makeDir));
          });
       break;
    case FSACommand::MakeQuota:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->makeQuota(user, phys_addrof(request->makeQuota)));
+      submitClientTask(resourceRequest, [=]() {
+            return device->makeQuota(user, phys_addrof(request->makeQuota));
          });
       break;
    case FSACommand::OpenDir:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->openDir(user,
-                               phys_addrof(request->openDir),
-                               phys_addrof(response->openDir)));
+      submitClientTask(resourceRequest, [=]() {
+            return device->openDir(user,
+                                   phys_addrof(request->openDir),
+                                   phys_addrof(response->openDir));
          });
       break;
    case FSACommand::OpenFile:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->openFile(user,
-                                phys_addrof(request->openFile),
-                                phys_addrof(response->openFile)));
+      submitClientTask(resourceRequest, [=]() {
+            return device->openFile(user,
+                                    phys_addrof(request->openFile),
+                                    phys_addrof(response->openFile));
          });
       break;
    case FSACommand::ReadDir:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->readDir(user,
-                               phys_addrof(request->readDir),
-                               phys_addrof(response->readDir)));
+      submitHandleTask(resourceRequest, request->readDir.handle, [=]() {
+            return device->readDir(user,
+                                   phys_addrof(request->readDir),
+                                   phys_addrof(response->readDir));
          });
       break;
    case FSACommand::Remove:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->remove(user, phys_addrof(request->remove)));
+      submitClientTask(resourceRequest, [=]() {
+            return device->remove(user, phys_addrof(request->remove));
          });
       break;
    case FSACommand::Rename:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->rename(user, phys_addrof(request->rename)));
+      submitClientTask(resourceRequest, [=]() {
+            return device->rename(user, phys_addrof(request->rename));
          });
       break;
    case FSACommand::RewindDir:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->rewindDir(user, phys_addrof(request->rewindDir)));
+      submitHandleTask(resourceRequest, request->rewindDir.handle, [=]() {
+            return device->rewindDir(user, phys_addrof(request->rewindDir));
          });
       break;
    case FSACommand::SetPosFile:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->setPosFile(user, phys_addrof(request->setPosFile)));
+      submitHandleTask(resourceRequest, request->setPosFile.handle, [=]() {
+            return device->setPosFile(user, phys_addrof(request->setPosFile));
          });
       break;
    case FSACommand::StatFile:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->statFile(user,
-                                phys_addrof(request->statFile),
-                                phys_addrof(response->statFile)));
+      submitHandleTask(resourceRequest, request->statFile.handle, [=]() {
+            return device->statFile(user,
+                                    phys_addrof(request->statFile),
+                                    phys_addrof(response->statFile));
          });
       break;
    case FSACommand::TruncateFile:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->truncateFile(user, phys_addrof(request->truncateFile)));
+      submitHandleTask(resourceRequest, request->truncateFile.handle, [=]() {
+            return device->truncateFile(user, phys_addrof(request->truncateFile));
          });
       break;
    case FSACommand::Unmount:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->unmount(user, phys_addrof(request->unmount)));
+      submitClientTask(resourceRequest, [=]() {
+            return device->unmount(user, phys_addrof(request->unmount));
          });
       break;
    case FSACommand::UnmountWithProcess:
-      submitWorkerTask([=]() {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->unmountWithProcess(user,
-                                          phys_addrof(request->unmountWithProcess)));
+      submitClientTask(resourceRequest, [=]() {
+            return device->unmountWithProcess(user,
+                                              phys_addrof(request->unmountWithProcess));
          });
       break;
    default:
@@ -339,56 +348,31 @@ fsaDeviceIoctlv(phys_ptr<ResourceRequest> resourceRequest,
 
    switch (command) {
    case FSACommand::ReadFile:
-   {
-      submitWorkerTask(
-         [=]() {
+      submitHandleTask(resourceRequest, request->readFile.handle, [=]() {
             auto buffer = phys_cast<uint8_t *>(vecs[1].paddr);
             auto length = vecs[1].len;
-
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->readFile(user, phys_addrof(request->readFile),
-                                buffer, length));
+            return device->readFile(user, phys_addrof(request->readFile),
+                                    buffer, length);
          });
       break;
-   }
    case FSACommand::WriteFile:
-   {
-      submitWorkerTask(
-         [=]()
-         {
+      submitHandleTask(resourceRequest, request->writeFile.handle, [=]() {
             auto buffer = phys_cast<uint8_t *>(vecs[1].paddr);
             auto length = vecs[1].len;
-
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->writeFile(user, phys_addrof(request->writeFile),
-                                 buffer, length));
+            return device->writeFile(user, phys_addrof(request->writeFile),
+                                     buffer, length);
          });
       break;
-   }
    case FSACommand::Mount:
-   {
-      submitWorkerTask(
-         [=]()
-         {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->mount(user, phys_addrof(request->mount)));
+      submitClientTask(resourceRequest, [=]() {
+            return device->mount(user, phys_addrof(request->mount));
          });
       break;
-   }
    case FSACommand::MountWithProcess:
-   {
-      submitWorkerTask(
-         [=]()
-         {
-            fsaAsyncTaskComplete(
-               resourceRequest,
-               device->mountWithProcess(user, phys_addrof(request->mountWithProcess)));
+      submitClientTask(resourceRequest, [=]() {
+            return device->mountWithProcess(user, phys_addrof(request->mountWithProcess));
          });
       break;
-   }
    default:
       IOS_ResourceReply(resourceRequest,
                         static_cast<Error>(FSAStatus::UnsupportedCmd));
@@ -1,19 +1,30 @@
 #include "ios_worker_thread.h"
 
+#include <algorithm>
 #include <atomic>
+#include <common/log.h>
+#include <common/platform_thread.h>
 #include <condition_variable>
+#include <deque>
+#include <fmt/format.h>
 #include <functional>
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace ios::internal
 {
 
-using WorkerTask = std::function<void()>;
+struct PendingTask
+{
+   WorkerTask task;
+   std::chrono::steady_clock::time_point submitted;
+};
 
-static std::thread
-sWorkerThread;
+static std::vector<std::thread>
+sWorkerThreads;
 
 static std::atomic<bool>
 sWorkerThreadRunning { false };
@@ -24,27 +35,54 @@ sWorkerThreadConditionVariable;
 static std::mutex
 sWorkerThreadMutex;
 
-static std::queue<WorkerTask>
+//! Tasks waiting for each key, the task at the front is either running or
+//! about to run. A key is only present whilst it has tasks.
+static std::unordered_map<WorkerTaskKey, std::deque<PendingTask>>
 sWorkerThreadTasks;
 
+//! Keys whose front task is ready to run, a key is never in this queue
+//! whilst a worker is running one of its tasks.
+static std::queue<WorkerTaskKey>
+sWorkerThreadReadyKeys;
+
+static WorkerThreadStats
+sWorkerThreadStats;
+
 static void
 iosWorkerThread()
 {
-   while (sWorkerThreadRunning) {
-      auto lock = std::unique_lock { sWorkerThreadMutex };
+   auto lock = std::unique_lock { sWorkerThreadMutex };
 
-      if (sWorkerThreadTasks.empty()) {
+   while (sWorkerThreadRunning) {
+      if (sWorkerThreadReadyKeys.empty()) {
          sWorkerThreadConditionVariable.wait(lock);
-         if (!sWorkerThreadRunning) {
-            break;
-         }
+         continue;
       }
 
-      auto task = std::move(sWorkerThreadTasks.front());
-      sWorkerThreadTasks.pop();
+      auto key = sWorkerThreadReadyKeys.front();
+      sWorkerThreadReadyKeys.pop();
+
+      auto task = std::move(sWorkerThreadTasks[key].front().task);
       lock.unlock();
 
       task();
+
+      lock.lock();
+      auto &tasks = sWorkerThreadTasks[key];
+      auto latency = std::chrono::steady_clock::now() - tasks.front().submitted;
+      tasks.pop_front();
+
+      if (tasks.empty()) {
+         sWorkerThreadTasks.erase(key);
+      } else {
+         sWorkerThreadReadyKeys.push(key);
+         sWorkerThreadConditionVariable.notify_one();
+      }
+
+      sWorkerThreadStats.queueDepth--;
+      sWorkerThreadStats.completedTasks++;
+      sWorkerThreadStats.totalLatency += latency;
+      sWorkerThreadStats.maxLatency = std::max<std::chrono::nanoseconds>(sWorkerThreadStats.maxLatency, latency);
    }
 }
 
@@ -52,8 +90,17 @@ void
 startWorkerThread()
 {
    if(!sWorkerThreadRunning) {
+      // Tasks are mostly waiting on host file IO, so there is no need to
+      // match the number of host cores exactly.
+      auto numThreads = std::clamp(std::thread::hardware_concurrency(), 2u, 4u);
+
       sWorkerThreadRunning = true;
-      sWorkerThread = std::thread { iosWorkerThread };
+      sWorkerThreadStats = { };
+
+      for (auto i = 0u; i < numThreads; ++i) {
+         auto &thread = sWorkerThreads.emplace_back(iosWorkerThread);
+         platform::setThreadName(&thread, fmt::format("IOS Worker Thread {}", i));
+      }
    }
 }
 
@@ -63,17 +110,51 @@ stopWorkerThread()
    if(sWorkerThreadRunning) {
       sWorkerThreadRunning = false;
       sWorkerThreadConditionVariable.notify_all();
-      sWorkerThread.join();
+
+      for (auto &thread : sWorkerThreads) {
+         thread.join();
+      }
+
+      auto stats = getWorkerThreadStats();
+      if (stats.completedTasks) {
+         gLog->info("IOS worker threads completed {} tasks, max queue depth {}, average latency {}us, max latency {}us",
+                    stats.completedTasks,
+                    stats.maxQueueDepth,
+                    std::chrono::duration_cast<std::chrono::microseconds>(stats.totalLatency).count() / stats.completedTasks,
+                    std::chrono::duration_cast<std::chrono::microseconds>(stats.maxLatency).count());
+      }
+
+      sWorkerThreads.clear();
       sWorkerThreadTasks = {};
+      sWorkerThreadReadyKeys = {};
    }
 }
 
 void
-submitWorkerTask(WorkerTask task)
+submitWorkerTask(WorkerTaskKey key,
+                 WorkerTask task)
+{
+   auto lock = std::unique_lock { sWorkerThreadMutex };
+   auto &tasks = sWorkerThreadTasks[key];
+   tasks.push_back({ std::move(task), std::chrono::steady_clock::now() });
+
+   // If the key already had tasks then it is either running or already
+   // queued, it will be requeued once the task in front of this completes.
+   if (tasks.size() == 1) {
+      sWorkerThreadReadyKeys.push(key);
+      sWorkerThreadConditionVariable.notify_one();
+   }
+
+   sWorkerThreadStats.queueDepth++;
+   sWorkerThreadStats.maxQueueDepth = std::max(sWorkerThreadStats.maxQueueDepth,
+                                               sWorkerThreadStats.queueDepth);
+}
+
+WorkerThreadStats
+getWorkerThreadStats()
 {
    auto lock = std::unique_lock { sWorkerThreadMutex };
-   sWorkerThreadTasks.push(std::move(task));
-   sWorkerThreadConditionVariable.notify_all();
+   return sWorkerThreadStats;
 }
 
 } // namespace ios::internal
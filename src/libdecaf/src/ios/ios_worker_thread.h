@@ -1,3 +1,5 @@
+#include <chrono>
+#include <cstdint>
 #include <functional>
 
 namespace ios::internal
@@ -5,6 +7,28 @@ namespace ios::internal
 
 using WorkerTask = std::function<void()>;
 
+//! Tasks submitted with the same key run one at a time in submission order,
+//! tasks with different keys may run concurrently.
+using WorkerTaskKey = uint64_t;
+
+struct WorkerThreadStats
+{
+   //! Number of tasks which have been submitted but not yet completed.
+   uint64_t queueDepth = 0;
+
+   //! Largest queueDepth seen.
+   uint64_t maxQueueDepth = 0;
+
+   //! Number of tasks completed.
+   uint64_t completedTasks = 0;
+
+   //! Total time from submission to completion of all completed tasks.
+   std::chrono::nanoseconds totalLatency { 0 };
+
+   //! Longest time from submission to completion of a single task.
+   std::chrono::nanoseconds maxLatency { 0 };
+};
+
 void
 startWorkerThread();
 
@@ -12,6 +36,10 @@ void
 stopWorkerThread();
 
 void
-submitWorkerTask(WorkerTask task);
+submitWorkerTask(WorkerTaskKey key,
+                 WorkerTask task);
+
+WorkerThreadStats
+getWorkerThreadStats();
 
 } // namespace ios::internal
@@ -21,6 +21,7 @@ public:
       Virtual,
       Overlay,
       Link,
+      Packed,
    };
 
    Device(Type type) :
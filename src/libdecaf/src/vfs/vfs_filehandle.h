@@ -36,6 +36,19 @@ public:
    virtual Result<int64_t> truncate() = 0;
    virtual Result<int64_t> read(void *buffer, int64_t size, int64_t count) = 0;
    virtual Result<int64_t> write(const void *buffer, int64_t size, int64_t count) = 0;
+
+   //! Read from position, leaving the file position just past the data read.
+   //! Handles which can read at an offset directly should override this to
+   //! avoid the separate seek.
+   virtual Result<int64_t> readAt(void *buffer, int64_t size, int64_t count, int64_t position)
+   {
+      auto error = seek(SeekStart, position);
+      if (error != Error::Success) {
+         return { error };
+      }
+
+      return read(buffer, size, count);
+   }
 };
 
 } // namespace vfs
@@ -1,6 +1,7 @@
 #include "vfs_host_device.h"
 #include "vfs_host_directoryiterator.h"
 #include "vfs_host_filehandle.h"
+#include "vfs_host_mappedfilehandle.h"
 #include "vfs_link_device.h"
 #include "vfs_virtual_device.h"
 
@@ -12,9 +13,11 @@
 namespace vfs
 {
 
-HostDevice::HostDevice(std::filesystem::path path) :
+HostDevice::HostDevice(std::filesystem::path path,
+                       bool mapReadOnlyFiles) :
    Device(Device::Host),
    mHostPath(std::move(path)),
+   mMapReadOnlyFiles(mapReadOnlyFiles),
    mVirtualDevice(std::make_shared<VirtualDevice>())
 {
 }
@@ -172,6 +175,13 @@ HostDevice::openFile(const User &user,
       }
    }
 
+   if (mMapReadOnlyFiles &&
+       !(mode & (FileHandle::Write | FileHandle::Append | FileHandle::Update))) {
+      if (auto mapped = HostMappedFileHandle::open(makeHostPath(path), mode)) {
+         return { std::unique_ptr<FileHandle> { std::move(mapped) } };
+      }
+   }
+
    auto hostMode = translateOpenMode(mode);
 #ifdef PLATFORM_WINDOWS
    auto handle = static_cast<FILE *>(nullptr);
@@ -22,7 +22,8 @@ class VirtualDevice;
 class HostDevice : public Device, public std::enable_shared_from_this<HostDevice>
 {
 public:
-   HostDevice(std::filesystem::path path);
+   HostDevice(std::filesystem::path path,
+              bool mapReadOnlyFiles = false);
    ~HostDevice() override = default;
 
    Result<std::shared_ptr<Device>>
@@ -92,6 +93,10 @@ private:
    std::filesystem::path mHostPath;
    std::map<std::string, HostNodePermission> mPermissionsCache;
 
+   //! Open files in read only mode with a HostMappedFileHandle, only safe
+   //! for content which is never modified whilst we are running.
+   bool mMapReadOnlyFiles;
+
    //! We want a virtual device backing this host device so we can do things
    //! like mount other devices within a host device. For example this could
    //! be useful if we have MLC / SLC on host device and we want to mount
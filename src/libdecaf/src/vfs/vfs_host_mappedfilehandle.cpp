@@ -0,0 +1,206 @@
+#include "vfs_host_mappedfilehandle.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vfs
+{
+
+HostMappedFileHandle::HostMappedFileHandle(platform::MapFileHandle handle,
+                                           const uint8_t *view,
+                                           int64_t size) :
+   mHandle(handle),
+   mView(view),
+   mSize(size),
+   mPosition(0)
+{
+}
+
+HostMappedFileHandle::~HostMappedFileHandle()
+{
+   close();
+}
+
+
+/**
+ * Open and map the file at path, returns nullptr if it could not be mapped,
+ * or mode allows writing to it, so the caller can fall back to a
+ * HostFileHandle.
+ */
+std::unique_ptr<HostMappedFileHandle>
+HostMappedFileHandle::open(const std::filesystem::path &path,
+                           Mode mode)
+{
+   if (mode & (FileHandle::Write | FileHandle::Append | FileHandle::Update)) {
+      return nullptr;
+   }
+
+   auto ec = std::error_code { };
+   if (!std::filesystem::is_regular_file(path, ec)) {
+      return nullptr;
+   }
+
+   auto size = size_t { 0 };
+   auto handle = platform::openMemoryMappedFile(path.string(),
+                                                platform::ProtectFlags::ReadOnly,
+                                                &size);
+   if (handle == platform::InvalidMapFileHandle) {
+      return nullptr;
+   }
+
+   // An empty file cannot be mapped, but there is nothing to read anyway.
+   auto view = static_cast<void *>(nullptr);
+   if (size > 0) {
+      view = platform::mapViewOfFile(handle, platform::ProtectFlags::ReadOnly,
+                                     0, size);
+      if (!view) {
+         platform::closeMemoryMappedFile(handle);
+         return nullptr;
+      }
+   }
+
+   return std::make_unique<HostMappedFileHandle>(
+      handle, static_cast<const uint8_t *>(view), static_cast<int64_t>(size));
+}
+
+Error
+HostMappedFileHandle::close()
+{
+   if (mView) {
+      platform::unmapViewOfFile(const_cast<uint8_t *>(mView),
+                                static_cast<size_t>(mSize));
+      mView = nullptr;
+   }
+
+   if (mHandle != platform::InvalidMapFileHandle) {
+      platform::closeMemoryMappedFile(mHandle);
+      mHandle = platform::InvalidMapFileHandle;
+   }
+
+   return Error::Success;
+}
+
+Result<bool>
+HostMappedFileHandle::eof()
+{
+   if (mHandle == platform::InvalidMapFileHandle) {
+      return { Error::NotOpen };
+   }
+
+   return { mPosition >= mSize };
+}
+
+Error
+HostMappedFileHandle::flush()
+{
+   if (mHandle == platform::InvalidMapFileHandle) {
+      return Error::NotOpen;
+   }
+
+   return Error::Success;
+}
+
+Error
+HostMappedFileHandle::seek(SeekDirection direction,
+                           int64_t offset)
+{
+   if (mHandle == platform::InvalidMapFileHandle) {
+      return Error::NotOpen;
+   }
+
+   auto position = mPosition;
+   switch (direction) {
+   case SeekCurrent:
+      position += offset;
+      break;
+   case SeekEnd:
+      position = mSize + offset;
+      break;
+   case SeekStart:
+      position = offset;
+      break;
+   default:
+      return Error::InvalidSeekDirection;
+   }
+
+   if (position < 0) {
+      return Error::InvalidSeekPosition;
+   }
+
+   mPosition = position;
+   return Error::Success;
+}
+
+Result<int64_t>
+HostMappedFileHandle::size()
+{
+   if (mHandle == platform::InvalidMapFileHandle) {
+      return { Error::NotOpen };
+   }
+
+   return { mSize };
+}
+
+Result<int64_t>
+HostMappedFileHandle::tell()
+{
+   if (mHandle == platform::InvalidMapFileHandle) {
+      return { Error::NotOpen };
+   }
+
+   return { mPosition };
+}
+
+Result<int64_t>
+HostMappedFileHandle::truncate()
+{
+   return { Error::ReadOnly };
+}
+
+Result<int64_t>
+HostMappedFileHandle::read(void *buffer,
+                           int64_t size,
+                           int64_t count)
+{
+   return readAt(buffer, size, count, mPosition);
+}
+
+
+/**
+ * Matches the behaviour of fread, a partial element at the end of the file
+ * is copied and advances the position but is not included in the count.
+ */
+Result<int64_t>
+HostMappedFileHandle::readAt(void *buffer,
+                             int64_t size,
+                             int64_t count,
+                             int64_t position)
+{
+   if (mHandle == platform::InvalidMapFileHandle) {
+      return { Error::NotOpen };
+   }
+
+   if (position < 0) {
+      return { Error::InvalidSeekPosition };
+   }
+
+   if (size <= 0 || count <= 0 || position >= mSize) {
+      mPosition = position;
+      return { 0 };
+   }
+
+   auto bytes = std::min(size * count, mSize - position);
+   std::memcpy(buffer, mView + position, static_cast<size_t>(bytes));
+   mPosition = position + bytes;
+   return { bytes / size };
+}
+
+Result<int64_t>
+HostMappedFileHandle::write(const void *buffer,
+                            int64_t size,
+                            int64_t count)
+{
+   return { Error::ReadOnly };
+}
+
+} // namespace vfs
@@ -0,0 +1,47 @@
+#pragma once
+#include "vfs_filehandle.h"
+
+#include <common/platform_memory.h>
+#include <filesystem>
+#include <memory>
+
+namespace vfs
+{
+
+/**
+ * A read only host file which is mapped into memory when opened, so reads
+ * are a memcpy from the mapping with no stdio buffering or seeking.
+ *
+ * Only use this for files which are not modified whilst open, e.g. title
+ * content, as the size of the mapping is fixed when the file is opened.
+ */
+class HostMappedFileHandle : public FileHandle
+{
+public:
+   HostMappedFileHandle(platform::MapFileHandle handle,
+                        const uint8_t *view,
+                        int64_t size);
+   ~HostMappedFileHandle() override;
+
+   static std::unique_ptr<HostMappedFileHandle>
+   open(const std::filesystem::path &path, Mode mode);
+
+   Error close() override;
+   Result<bool> eof() override;
+   Error flush() override;
+   Error seek(SeekDirection direction, int64_t offset) override;
+   Result<int64_t> size() override;
+   Result<int64_t> tell() override;
+   Result<int64_t> truncate() override;
+   Result<int64_t> read(void *buffer, int64_t size, int64_t count) override;
+   Result<int64_t> readAt(void *buffer, int64_t size, int64_t count, int64_t position) override;
+   Result<int64_t> write(const void *buffer, int64_t size, int64_t count) override;
+
+private:
+   platform::MapFileHandle mHandle;
+   const uint8_t *mView;
+   int64_t mSize;
+   int64_t mPosition;
+};
+
+} // namespace vfs
@@ -29,6 +29,8 @@ Error
 OverlayDevice::makeFolder(const User &user,
                           const Path &path)
 {
+   auto invalidation = PathCacheInvalidation { };
+
    for (auto &[priority, device] : mDevices) {
       auto result = device->makeFolder(user, path);
       if (result == Error::Success) {
@@ -43,6 +45,8 @@ Error
 OverlayDevice::makeFolders(const User &user,
                            const Path &path)
 {
+   auto invalidation = PathCacheInvalidation { };
+
    for (auto &[priority, device] : mDevices) {
       auto result = device->makeFolders(user, path);
       if (result == Error::Success) {
@@ -58,6 +62,8 @@ OverlayDevice::mountDevice(const User &user,
                            const Path &path,
                            std::shared_ptr<Device> device)
 {
+   auto invalidation = PathCacheInvalidation { };
+
    if (path.depth() == 0) {
       // Should be using mountOverlayDevice, not mountDevice...
       return Error::OperationNotSupported;
@@ -79,6 +85,8 @@ OverlayDevice::mountOverlayDevice(const User &user,
                                   const Path &path,
                                   std::shared_ptr<Device> device)
 {
+   auto invalidation = PathCacheInvalidation { };
+
    if (path.depth() == 0) {
       for (auto itr = mDevices.begin(); itr != mDevices.end(); ++itr) {
          if (itr->first == priority) {
@@ -109,6 +117,8 @@ Error
 OverlayDevice::unmountDevice(const User &user,
                              const Path &path)
 {
+   auto invalidation = PathCacheInvalidation { };
+
    if (mDevices.empty()) {
       return Error::NotFound;
    }
@@ -133,6 +143,8 @@ OverlayDevice::unmountOverlayDevice(const User &user,
                                     OverlayPriority priority,
                                     const Path &path)
 {
+   auto invalidation = PathCacheInvalidation { };
+
    if (path.depth() == 0) {
       for (auto itr = mDevices.begin(); itr != mDevices.end(); ++itr) {
          if (itr->first == priority) {
@@ -172,13 +184,35 @@ OverlayDevice::openFile(const User &user,
                         const Path &path,
                         FileHandle::Mode mode)
 {
+   auto canCreate = (mode & (FileHandle::Write | FileHandle::Append)) != 0;
+   auto invalidation = std::optional<PathCacheInvalidation> { };
+   auto generation = getPathCacheGeneration();
+   if (canCreate) {
+      invalidation.emplace();
+   } else {
+      auto found = false;
+      if (auto layer = findCachedLayer(path, found)) {
+         return layer->openFile(user, path, mode);
+      } else if (found) {
+         return { Error::NotFound };
+      }
+   }
+
    for (auto &[priority, device] : mDevices) {
       auto result = device->openFile(user, path, mode);
       if (result.error() != Error::NotFound) {
+         if (!canCreate) {
+            mLayerCache.insert(path.path(), device, generation);
+         }
+
          return result;
       }
    }
 
+   if (!canCreate) {
+      mLayerCache.insert(path.path(), nullptr, generation);
+   }
+
    return { Error::NotFound };
 }
 
@@ -186,6 +220,8 @@ Error
 OverlayDevice::remove(const User &user,
                       const Path &path)
 {
+   auto invalidation = PathCacheInvalidation { };
+
    for (auto &[priority, device] : mDevices) {
       auto result = device->remove(user, path);
       if (result == Error::Success) {
@@ -201,6 +237,8 @@ OverlayDevice::rename(const User &user,
                       const Path &src,
                       const Path &dst)
 {
+   auto invalidation = PathCacheInvalidation { };
+
    for (auto &[priority, device] : mDevices) {
       auto result = device->rename(user, src, dst);
       if (result == Error::Success) {
@@ -260,14 +298,40 @@ Result<Status>
 OverlayDevice::status(const User &user,
                       const Path &path)
 {
+   auto generation = getPathCacheGeneration();
+   auto found = false;
+   if (auto layer = findCachedLayer(path, found)) {
+      return layer->status(user, path);
+   } else if (found) {
+      return { Error::NotFound };
+   }
+
    for (auto &[priority, device] : mDevices) {
       auto result = device->status(user, path);
       if (result.error() != Error::NotFound) {
+         mLayerCache.insert(path.path(), device, generation);
          return result;
       }
    }
 
+   mLayerCache.insert(path.path(), nullptr, generation);
    return { Error::NotFound };
 }
 
+
+/**
+ * Find the layer which path was last found in.
+ *
+ * Sets found to true when there is a cache entry for path, in which case the
+ * returned device is nullptr if the path does not exist in any layer.
+ */
+std::shared_ptr<Device>
+OverlayDevice::findCachedLayer(const Path &path,
+                               bool &found)
+{
+   auto cached = mLayerCache.find(path.path());
+   found = cached.has_value();
+   return found ? std::move(*cached) : nullptr;
+}
+
 } // namespace vfs
@@ -1,5 +1,6 @@
 #pragma once
 #include "vfs_device.h"
+#include "vfs_pathcache.h"
 #include "vfs_permissions.h"
 #include "vfs_result.h"
 
@@ -91,8 +92,16 @@ public:
       return mDevices.end();
    }
 
+private:
+   std::shared_ptr<Device>
+   findCachedLayer(const Path &path, bool &found);
+
 private:
    device_list mDevices;
+
+   //! The layer which each path was last found in, nullptr if it was not
+   //! found in any layer.
+   PathCache<std::shared_ptr<Device>> mLayerCache;
 };
 
 } // namespace vfs
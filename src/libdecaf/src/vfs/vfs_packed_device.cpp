@@ -0,0 +1,317 @@
+#include "vfs_link_device.h"
+#include "vfs_packed_device.h"
+#include "vfs_packed_directoryiterator.h"
+#include "vfs_packed_filehandle.h"
+
+#include <algorithm>
+#include <common/log.h>
+
+namespace vfs
+{
+
+/**
+ * Convert a device relative path into the form stored in the image index.
+ */
+static std::string_view
+makeIndexPath(const Path &path)
+{
+   auto result = std::string_view { path.path() };
+
+   while (!result.empty() && result.front() == '/') {
+      result.remove_prefix(1);
+   }
+
+   if (result == ".") {
+      return { };
+   }
+
+   return result;
+}
+
+PackedDevice::PackedDevice() :
+   Device(Device::Packed)
+{
+}
+
+PackedDevice::~PackedDevice()
+{
+   close();
+}
+
+
+/**
+ * Map the image at path and validate its header and index.
+ */
+Error
+PackedDevice::open(const std::filesystem::path &path)
+{
+   close();
+
+   auto ec = std::error_code { };
+   if (!std::filesystem::is_regular_file(path, ec)) {
+      return Error::NotFound;
+   }
+
+   mHandle = platform::openMemoryMappedFile(path.string(),
+                                            platform::ProtectFlags::ReadOnly,
+                                            &mSize);
+   if (mHandle == platform::InvalidMapFileHandle) {
+      return Error::GenericError;
+   }
+
+   if (mSize >= sizeof(packed::FileHeader)) {
+      mView = static_cast<const uint8_t *>(
+         platform::mapViewOfFile(mHandle, platform::ProtectFlags::ReadOnly,
+                                 0, mSize));
+   }
+
+   if (!mView) {
+      gLog->error("Could not map packed image {}", path.string());
+      close();
+      return Error::GenericError;
+   }
+
+   mHeader = reinterpret_cast<const packed::FileHeader *>(mView);
+   if (mHeader->magic != packed::Magic || mHeader->version != packed::Version) {
+      gLog->error("Packed image {} has unsupported version", path.string());
+      close();
+      return Error::GenericError;
+   }
+
+   auto indexSize = uint64_t { mHeader->numEntries } * sizeof(packed::Entry);
+   if (mHeader->chunkSize == 0 ||
+       mHeader->indexOffset > mSize || indexSize > mSize - mHeader->indexOffset ||
+       mHeader->stringsOffset > mSize || mHeader->stringsSize > mSize - mHeader->stringsOffset) {
+      gLog->error("Packed image {} is truncated", path.string());
+      close();
+      return Error::GenericError;
+   }
+
+   mEntries = reinterpret_cast<const packed::Entry *>(mView + mHeader->indexOffset);
+   mStrings = reinterpret_cast<const char *>(mView + mHeader->stringsOffset);
+
+   for (auto entry = entriesBegin(); entry != entriesEnd(); ++entry) {
+      if (uint64_t { entry->pathOffset } + entry->pathLength > mHeader->stringsSize ||
+          entry->dataOffset > mSize ||
+          (!(entry->flags & (packed::Directory | packed::Compressed)) &&
+           entry->size > mSize - entry->dataOffset)) {
+         gLog->error("Packed image {} has an invalid index", path.string());
+         close();
+         return Error::GenericError;
+      }
+   }
+
+   return Error::Success;
+}
+
+void
+PackedDevice::close()
+{
+   if (mView) {
+      platform::unmapViewOfFile(const_cast<uint8_t *>(mView), mSize);
+      mView = nullptr;
+   }
+
+   if (mHandle != platform::InvalidMapFileHandle) {
+      platform::closeMemoryMappedFile(mHandle);
+      mHandle = platform::InvalidMapFileHandle;
+   }
+
+   mSize = 0;
+   mHeader = nullptr;
+   mEntries = nullptr;
+   mStrings = nullptr;
+}
+
+const packed::Entry *
+PackedDevice::lowerBound(std::string_view path) const
+{
+   return std::lower_bound(entriesBegin(), entriesEnd(), path,
+                           [this](const packed::Entry &entry,
+                                  std::string_view value) {
+                              return entryPath(entry) < value;
+                           });
+}
+
+const packed::Entry *
+PackedDevice::findEntry(const Path &path) const
+{
+   if (!mEntries) {
+      return nullptr;
+   }
+
+   auto indexPath = makeIndexPath(path);
+   auto itr = lowerBound(indexPath);
+   if (itr == entriesEnd() || entryPath(*itr) != indexPath) {
+      return nullptr;
+   }
+
+   return itr;
+}
+
+std::string_view
+PackedDevice::entryPath(const packed::Entry &entry) const
+{
+   return { mStrings + entry.pathOffset, entry.pathLength };
+}
+
+Status
+PackedDevice::entryStatus(const packed::Entry &entry) const
+{
+   auto path = entryPath(entry);
+   auto status = Status { };
+   status.name = std::string { path.substr(path.find_last_of('/') + 1) };
+
+   if (entry.flags & packed::Directory) {
+      status.flags = Status::IsDirectory;
+   } else {
+      status.size = entry.size;
+      status.flags = Status::HasSize;
+   }
+
+   return status;
+}
+
+Result<std::shared_ptr<Device>>
+PackedDevice::getLinkDevice(const User &user,
+                            const Path &path)
+{
+   return { std::make_shared<LinkDevice>(shared_from_this(), path) };
+}
+
+Error
+PackedDevice::makeFolder(const User &user,
+                         const Path &path)
+{
+   return Error::ReadOnly;
+}
+
+Error
+PackedDevice::makeFolders(const User &user,
+                          const Path &path)
+{
+   return Error::ReadOnly;
+}
+
+Error
+PackedDevice::mountDevice(const User &user,
+                          const Path &path,
+                          std::shared_ptr<Device> device)
+{
+   return Error::OperationNotSupported;
+}
+
+Error
+PackedDevice::mountOverlayDevice(const User &user,
+                                 OverlayPriority priority,
+                                 const Path &path,
+                                 std::shared_ptr<Device> device)
+{
+   return Error::OperationNotSupported;
+}
+
+Error
+PackedDevice::unmountDevice(const User &user,
+                            const Path &path)
+{
+   return Error::OperationNotSupported;
+}
+
+Error
+PackedDevice::unmountOverlayDevice(const User &user,
+                                   OverlayPriority priority,
+                                   const Path &path)
+{
+   return Error::OperationNotSupported;
+}
+
+Result<DirectoryIterator>
+PackedDevice::openDirectory(const User &user,
+                            const Path &path)
+{
+   auto entry = findEntry(path);
+   if (!entry) {
+      return { Error::NotFound };
+   }
+
+   if (!(entry->flags & packed::Directory)) {
+      return { Error::NotDirectory };
+   }
+
+   return { DirectoryIterator {
+      std::make_shared<PackedDirectoryIterator>(shared_from_this(), entry) } };
+}
+
+Result<std::unique_ptr<FileHandle>>
+PackedDevice::openFile(const User &user,
+                       const Path &path,
+                       FileHandle::Mode mode)
+{
+   if (mode & (FileHandle::Write | FileHandle::Append | FileHandle::Update)) {
+      return { Error::ReadOnly };
+   }
+
+   auto entry = findEntry(path);
+   if (!entry) {
+      return { Error::NotFound };
+   }
+
+   if (entry->flags & packed::Directory) {
+      return { Error::NotFile };
+   }
+
+   return { std::make_unique<PackedFileHandle>(shared_from_this(), entry, mode) };
+}
+
+Error
+PackedDevice::remove(const User &user,
+                     const Path &path)
+{
+   return Error::ReadOnly;
+}
+
+Error
+PackedDevice::rename(const User &user,
+                     const Path &src,
+                     const Path &dst)
+{
+   return Error::ReadOnly;
+}
+
+Error
+PackedDevice::setGroup(const User &user,
+                       const Path &path,
+                       GroupId group)
+{
+   return Error::ReadOnly;
+}
+
+Error
+PackedDevice::setOwner(const User &user,
+                       const Path &path,
+                       OwnerId owner)
+{
+   return Error::ReadOnly;
+}
+
+Error
+PackedDevice::setPermissions(const User &user,
+                             const Path &path,
+                             Permissions mode)
+{
+   return Error::ReadOnly;
+}
+
+Result<Status>
+PackedDevice::status(const User &user,
+                     const Path &path)
+{
+   auto entry = findEntry(path);
+   if (!entry) {
+      return { Error::NotFound };
+   }
+
+   return { entryStatus(*entry) };
+}
+
+} // namespace vfs
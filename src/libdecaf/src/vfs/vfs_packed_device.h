@@ -0,0 +1,134 @@
+#pragma once
+#include "vfs_device.h"
+#include "vfs_packed_format.h"
+
+#include <common/platform_memory.h>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+namespace vfs
+{
+
+/**
+ * A read only device backed by a single packed content image, see
+ * vfs_packed_format.h.
+ *
+ * The whole image is memory mapped and paths are found with a binary search
+ * of the sorted index, so there are no host file system calls after open.
+ */
+class PackedDevice : public Device, public std::enable_shared_from_this<PackedDevice>
+{
+public:
+   PackedDevice();
+   ~PackedDevice() override;
+
+   Error
+   open(const std::filesystem::path &path);
+
+   Result<std::shared_ptr<Device>>
+   getLinkDevice(const User &user, const Path &path) override;
+
+   Error
+   makeFolder(const User &user, const Path &path) override;
+
+   Error
+   makeFolders(const User &user, const Path &path) override;
+
+   Error
+   mountDevice(const User &user, const Path &path,
+               std::shared_ptr<Device> device) override;
+
+   Error
+   mountOverlayDevice(const User &user, OverlayPriority priority,
+                      const Path &path,
+                      std::shared_ptr<Device> device) override;
+
+   Error
+   unmountDevice(const User &user, const Path &path) override;
+
+   Error
+   unmountOverlayDevice(const User &user, OverlayPriority priority,
+                        const Path &path) override;
+
+   Result<DirectoryIterator>
+   openDirectory(const User &user, const Path &path) override;
+
+   Result<std::unique_ptr<FileHandle>>
+   openFile(const User &user, const Path &path,
+            FileHandle::Mode mode) override;
+
+   Error
+   remove(const User &user, const Path &path) override;
+
+   Error
+   rename(const User &user, const Path &src, const Path &dst) override;
+
+   Error
+   setGroup(const User &user, const Path &path, GroupId group) override;
+
+   Error
+   setOwner(const User &user, const Path &path, OwnerId owner) override;
+
+   Error
+   setPermissions(const User &user, const Path &path, Permissions mode) override;
+
+   Result<Status>
+   status(const User &user, const Path &path) override;
+
+   const packed::Entry *
+   findEntry(const Path &path) const;
+
+   //! Returns the first entry whose path is not less than path.
+   const packed::Entry *
+   lowerBound(std::string_view path) const;
+
+   Status
+   entryStatus(const packed::Entry &entry) const;
+
+   std::string_view
+   entryPath(const packed::Entry &entry) const;
+
+   uint32_t
+   chunkSize() const
+   {
+      return mHeader->chunkSize;
+   }
+
+   const uint8_t *
+   data() const
+   {
+      return mView;
+   }
+
+   size_t
+   dataSize() const
+   {
+      return mSize;
+   }
+
+   const packed::Entry *
+   entriesBegin() const
+   {
+      return mEntries;
+   }
+
+   const packed::Entry *
+   entriesEnd() const
+   {
+      return mEntries + mHeader->numEntries;
+   }
+
+private:
+   void close();
+
+private:
+   platform::MapFileHandle mHandle = platform::InvalidMapFileHandle;
+   const uint8_t *mView = nullptr;
+   size_t mSize = 0;
+   const packed::FileHeader *mHeader = nullptr;
+   const packed::Entry *mEntries = nullptr;
+   const char *mStrings = nullptr;
+};
+
+} // namespace vfs
@@ -0,0 +1,53 @@
+#include "vfs_packed_device.h"
+#include "vfs_packed_directoryiterator.h"
+
+namespace vfs
+{
+
+PackedDirectoryIterator::PackedDirectoryIterator(std::shared_ptr<const PackedDevice> device,
+                                                 const packed::Entry *directory) :
+   mDevice(std::move(device))
+{
+   mPrefix = std::string { mDevice->entryPath(*directory) };
+
+   if (mPrefix.empty()) {
+      // Everything except the root itself is inside the root
+      mBegin = directory + 1;
+   } else {
+      // Skip siblings such as "dir.txt" which sort between "dir" and "dir/"
+      mPrefix.push_back('/');
+      mBegin = mDevice->lowerBound(mPrefix);
+   }
+
+   mIterator = mBegin;
+}
+
+Result<Status>
+PackedDirectoryIterator::readEntry()
+{
+   for (; mIterator != mDevice->entriesEnd(); ++mIterator) {
+      auto path = mDevice->entryPath(*mIterator);
+      if (path.compare(0, mPrefix.size(), mPrefix) != 0) {
+         // Left this directory
+         break;
+      }
+
+      if (path.find('/', mPrefix.size()) != std::string_view::npos) {
+         // Inside a subdirectory
+         continue;
+      }
+
+      return { mDevice->entryStatus(*mIterator++) };
+   }
+
+   return { Error::EndOfDirectory };
+}
+
+Error
+PackedDirectoryIterator::rewind()
+{
+   mIterator = mBegin;
+   return Error::Success;
+}
+
+} // namespace vfs
@@ -0,0 +1,35 @@
+#pragma once
+#include "vfs_directoryiterator.h"
+#include "vfs_packed_format.h"
+
+#include <memory>
+#include <string>
+
+namespace vfs
+{
+
+class PackedDevice;
+
+class PackedDirectoryIterator : public DirectoryIteratorImpl
+{
+public:
+   PackedDirectoryIterator(std::shared_ptr<const PackedDevice> device,
+                           const packed::Entry *directory);
+   ~PackedDirectoryIterator() override = default;
+
+   Result<Status> readEntry() override;
+   Error rewind() override;
+
+private:
+   std::shared_ptr<const PackedDevice> mDevice;
+
+   //! Path prefix shared by every entry inside this directory.
+   std::string mPrefix;
+
+   //! All entries inside this directory (including those in subdirectories)
+   //! are contiguous in the sorted index, as they all start with mPrefix.
+   const packed::Entry *mBegin;
+   const packed::Entry *mIterator;
+};
+
+} // namespace vfs
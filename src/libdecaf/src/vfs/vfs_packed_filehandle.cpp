@@ -0,0 +1,225 @@
+#include "vfs_packed_device.h"
+#include "vfs_packed_filehandle.h"
+
+#include <algorithm>
+#include <common/decaf_assert.h>
+#include <cstring>
+#include <zlib.h>
+
+namespace vfs
+{
+
+PackedFileHandle::PackedFileHandle(std::shared_ptr<const PackedDevice> device,
+                                   const packed::Entry *entry,
+                                   Mode mode) :
+   mDevice(std::move(device)),
+   mEntry(entry),
+   mSize(static_cast<int64_t>(entry->size)),
+   mPosition(0),
+   mMode(mode)
+{
+}
+
+PackedFileHandle::~PackedFileHandle()
+{
+   close();
+}
+
+Error
+PackedFileHandle::close()
+{
+   mDevice.reset();
+   mEntry = nullptr;
+   mChunk.clear();
+   return Error::Success;
+}
+
+Result<bool>
+PackedFileHandle::eof()
+{
+   if (!mDevice) {
+      return { Error::NotOpen };
+   }
+
+   return { mPosition >= mSize };
+}
+
+Error
+PackedFileHandle::flush()
+{
+   if (!mDevice) {
+      return Error::NotOpen;
+   }
+
+   return Error::Success;
+}
+
+Error
+PackedFileHandle::seek(SeekDirection direction,
+                       int64_t offset)
+{
+   if (!mDevice) {
+      return Error::NotOpen;
+   }
+
+   auto position = mPosition;
+   switch (direction) {
+   case SeekCurrent:
+      position += offset;
+      break;
+   case SeekEnd:
+      position = mSize + offset;
+      break;
+   case SeekStart:
+      position = offset;
+      break;
+   default:
+      return Error::InvalidSeekDirection;
+   }
+
+   if (position < 0) {
+      return Error::InvalidSeekPosition;
+   }
+
+   mPosition = position;
+   return Error::Success;
+}
+
+Result<int64_t>
+PackedFileHandle::size()
+{
+   if (!mDevice) {
+      return { Error::NotOpen };
+   }
+
+   return { mSize };
+}
+
+Result<int64_t>
+PackedFileHandle::tell()
+{
+   if (!mDevice) {
+      return { Error::NotOpen };
+   }
+
+   return { mPosition };
+}
+
+Result<int64_t>
+PackedFileHandle::truncate()
+{
+   return { Error::ReadOnly };
+}
+
+
+/**
+ * Returns a pointer to the uncompressed data of a chunk of a compressed
+ * file, or nullptr if the chunk is corrupt.
+ */
+const uint8_t *
+PackedFileHandle::readChunk(uint64_t index)
+{
+   auto chunkSize = uint64_t { mDevice->chunkSize() };
+   auto numChunks = (mEntry->size + chunkSize - 1) / chunkSize;
+   decaf_check(index < numChunks);
+
+   auto offsets = reinterpret_cast<const uint64_t *>(mDevice->data() + mEntry->dataOffset);
+   if (mEntry->dataOffset + (numChunks + 1) * sizeof(uint64_t) > mDevice->dataSize() ||
+       offsets[index] > offsets[index + 1] ||
+       offsets[index + 1] > mDevice->dataSize()) {
+      return nullptr;
+   }
+
+   auto stored = mDevice->data() + offsets[index];
+   auto storedSize = offsets[index + 1] - offsets[index];
+   auto rawSize = std::min(chunkSize, mEntry->size - index * chunkSize);
+
+   if (storedSize == rawSize) {
+      return stored;
+   }
+
+   if (mChunkIndex != index) {
+      mChunk.resize(chunkSize);
+
+      auto destSize = static_cast<uLongf>(rawSize);
+      if (uncompress(mChunk.data(), &destSize, stored,
+                     static_cast<uLong>(storedSize)) != Z_OK ||
+          destSize != rawSize) {
+         mChunkIndex = ~uint64_t { 0 };
+         return nullptr;
+      }
+
+      mChunkIndex = index;
+   }
+
+   return mChunk.data();
+}
+
+Result<int64_t>
+PackedFileHandle::read(void *buffer,
+                       int64_t size,
+                       int64_t count)
+{
+   return readAt(buffer, size, count, mPosition);
+}
+
+
+/**
+ * Matches the behaviour of fread, a partial element at the end of the file
+ * is copied and advances the position but is not included in the count.
+ */
+Result<int64_t>
+PackedFileHandle::readAt(void *buffer,
+                         int64_t size,
+                         int64_t count,
+                         int64_t position)
+{
+   if (!mDevice) {
+      return { Error::NotOpen };
+   }
+
+   if (position < 0) {
+      return { Error::InvalidSeekPosition };
+   }
+
+   if (size <= 0 || count <= 0 || position >= mSize) {
+      mPosition = position;
+      return { 0 };
+   }
+
+   auto bytes = std::min(size * count, mSize - position);
+
+   if (!(mEntry->flags & packed::Compressed)) {
+      std::memcpy(buffer, mDevice->data() + mEntry->dataOffset + position,
+                  static_cast<size_t>(bytes));
+   } else {
+      auto chunkSize = int64_t { mDevice->chunkSize() };
+      auto dst = static_cast<uint8_t *>(buffer);
+
+      for (auto offset = position; offset < position + bytes; ) {
+         auto chunk = readChunk(static_cast<uint64_t>(offset / chunkSize));
+         if (!chunk) {
+            return { Error::GenericError };
+         }
+
+         auto chunkOffset = offset % chunkSize;
+         auto copySize = std::min(chunkSize - chunkOffset, position + bytes - offset);
+         std::memcpy(dst, chunk + chunkOffset, static_cast<size_t>(copySize));
+         dst += copySize;
+         offset += copySize;
+      }
+   }
+
+   mPosition = position + bytes;
+   return { bytes / size };
+}
+
+Result<int64_t>
+PackedFileHandle::write(const void *buffer,
+                        int64_t size,
+                        int64_t count)
+{
+   return { Error::ReadOnly };
+}
+
+} // namespace vfs
@@ -0,0 +1,48 @@
+#pragma once
+#include "vfs_filehandle.h"
+#include "vfs_packed_format.h"
+
+#include <memory>
+#include <vector>
+
+namespace vfs
+{
+
+class PackedDevice;
+
+class PackedFileHandle : public FileHandle
+{
+public:
+   PackedFileHandle(std::shared_ptr<const PackedDevice> device,
+                    const packed::Entry *entry,
+                    Mode mode);
+   ~PackedFileHandle() override;
+
+   Error close() override;
+   Result<bool> eof() override;
+   Error flush() override;
+   Error seek(SeekDirection direction, int64_t offset) override;
+   Result<int64_t> size() override;
+   Result<int64_t> tell() override;
+   Result<int64_t> truncate() override;
+   Result<int64_t> read(void *buffer, int64_t size, int64_t count) override;
+   Result<int64_t> readAt(void *buffer, int64_t size, int64_t count, int64_t position) override;
+   Result<int64_t> write(const void *buffer, int64_t size, int64_t count) override;
+
+private:
+   const uint8_t *
+   readChunk(uint64_t index);
+
+private:
+   std::shared_ptr<const PackedDevice> mDevice;
+   const packed::Entry *mEntry;
+   int64_t mSize;
+   int64_t mPosition;
+   Mode mMode;
+
+   //! The most recently decompressed chunk of a compressed file.
+   std::vector<uint8_t> mChunk;
+   uint64_t mChunkIndex = ~uint64_t { 0 };
+};
+
+} // namespace vfs
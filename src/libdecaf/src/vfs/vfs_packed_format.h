@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * Packed content image format, written by tools/dpak-tool and read by
+ * vfs::PackedDevice.
+ *
+ * Layout:
+ *    FileHeader
+ *    File data, in index order so a title loads mostly sequentially
+ *    Entry[numEntries], sorted by path
+ *    Path strings
+ *
+ * Paths are relative to the root of the image, separated by '/', with no
+ * leading or trailing separator. The root directory itself has an empty path.
+ *
+ * An uncompressed file is stored contiguously at dataOffset. A compressed
+ * file is split into chunkSize chunks which are each zlib compressed, at
+ * dataOffset is a table of numChunks + 1 absolute offsets to the start of
+ * each chunk followed by the chunk data. A chunk whose stored size equals
+ * its uncompressed size is stored uncompressed.
+ *
+ * All values are little endian.
+ */
+namespace vfs::packed
+{
+
+static constexpr uint32_t Magic = 0x4B415044; // "DPAK"
+static constexpr uint32_t Version = 1;
+static constexpr uint32_t DefaultChunkSize = 64 * 1024;
+
+struct FileHeader
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t numEntries;
+   uint32_t chunkSize;
+   uint64_t indexOffset;
+   uint64_t stringsOffset;
+   uint64_t stringsSize;
+};
+
+enum EntryFlags : uint32_t
+{
+   Directory   = 1 << 0,
+   Compressed  = 1 << 1,
+};
+
+struct Entry
+{
+   uint64_t dataOffset;
+   uint64_t size;
+   uint32_t pathOffset;
+   uint32_t pathLength;
+   uint32_t flags;
+   uint32_t padding;
+};
+
+static_assert(sizeof(FileHeader) == 0x28);
+static_assert(sizeof(Entry) == 0x20);
+
+} // namespace vfs::packed
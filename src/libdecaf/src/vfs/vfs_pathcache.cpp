@@ -0,0 +1,28 @@
+#include "vfs_pathcache.h"
+
+#include <atomic>
+
+namespace vfs
+{
+
+static std::atomic<uint64_t> sPathCacheGeneration { 1 };
+
+uint64_t
+getPathCacheGeneration()
+{
+   return sPathCacheGeneration.load(std::memory_order_acquire);
+}
+
+
+/**
+ * Invalidate every PathCache, must be called after a file or directory is
+ * created, removed or renamed, or a device is mounted or unmounted. Usually
+ * through PathCacheInvalidation.
+ */
+void
+invalidatePathCaches()
+{
+   sPathCacheGeneration.fetch_add(1, std::memory_order_acq_rel);
+}
+
+} // namespace vfs
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace vfs
+{
+
+uint64_t
+getPathCacheGeneration();
+
+void
+invalidatePathCaches();
+
+/**
+ * Invalidates every PathCache when constructed and again when destroyed, for
+ * the start of any function which modifies the file system tree.
+ *
+ * The invalidation on destruction is the one which matters, it happens after
+ * the tree has been changed so nothing looked up before the change can be
+ * inserted under the new generation.
+ */
+class PathCacheInvalidation
+{
+public:
+   PathCacheInvalidation()
+   {
+      invalidatePathCaches();
+   }
+
+   ~PathCacheInvalidation()
+   {
+      invalidatePathCaches();
+   }
+
+   PathCacheInvalidation(const PathCacheInvalidation &) = delete;
+   PathCacheInvalidation &operator=(const PathCacheInvalidation &) = delete;
+};
+
+/**
+ * Cache of path lookups, keyed by the full normalised path.
+ *
+ * Devices which are used as links or overlay layers can be modified through
+ * more than one path, so rather than tracking which entries a change affects
+ * every change to the file system tree invalidates every cache by incrementing
+ * a global generation counter. Caches check the generation on each lookup and
+ * clear themselves when it has changed.
+ *
+ * Callers read the generation with getPathCacheGeneration before doing the
+ * uncached lookup and pass it to insert, which drops the value if the tree
+ * has changed since.
+ */
+template<typename ValueType>
+class PathCache
+{
+   static constexpr size_t MaxEntries = 4096;
+
+public:
+   std::optional<ValueType>
+   find(const std::string &path)
+   {
+      std::lock_guard<std::mutex> lock { mMutex };
+      if (!validate()) {
+         return { };
+      }
+
+      auto itr = mEntries.find(path);
+      if (itr == mEntries.end()) {
+         return { };
+      }
+
+      return itr->second;
+   }
+
+   void
+   insert(const std::string &path,
+          ValueType value,
+          uint64_t generation)
+   {
+      std::lock_guard<std::mutex> lock { mMutex };
+      validate();
+
+      if (mGeneration != generation) {
+         return;
+      }
+
+      if (mEntries.size() >= MaxEntries) {
+         mEntries.clear();
+      }
+
+      mEntries.insert_or_assign(path, std::move(value));
+   }
+
+private:
+   bool
+   validate()
+   {
+      auto generation = getPathCacheGeneration();
+      if (mGeneration != generation) {
+         mEntries.clear();
+         mGeneration = generation;
+         return false;
+      }
+
+      return true;
+   }
+
+private:
+   std::mutex mMutex;
+   uint64_t mGeneration = 0;
+   std::unordered_map<std::string, ValueType> mEntries;
+};
+
+} // namespace vfs
@@ -32,6 +32,7 @@ Error
 VirtualDevice::makeFolder(const User &user,
                           const Path &path)
 {
+   auto invalidation = PathCacheInvalidation { };
    auto [node, relativePath] = findDeepest(user, path);
    if (relativePath.empty()) {
       return Error::AlreadyExists;
@@ -61,6 +62,7 @@ Error
 VirtualDevice::makeFolders(const User &user,
                            const Path &path)
 {
+   auto invalidation = PathCacheInvalidation { };
    auto [node, relativePath] = findDeepest(user, path);
    if (relativePath.empty()) {
       return Error::AlreadyExists;
@@ -90,6 +92,7 @@ VirtualDevice::mountDevice(const User &user,
                            const Path &path,
                            std::shared_ptr<Device> device)
 {
+   auto invalidation = PathCacheInvalidation { };
    auto [node, relativePath] = findDeepest(user, path);
    if (relativePath.depth() == 0) {
       return Error::AlreadyExists;
@@ -122,6 +125,7 @@ VirtualDevice::mountOverlayDevice(const User &user,
                                   const Path &path,
                                   std::shared_ptr<Device> device)
 {
+   auto invalidation = PathCacheInvalidation { };
    auto[node, relativePath] = findDeepest(user, path);
    if (node->type == VirtualNode::MountedDevice) {
       auto mountedDevice = static_cast<VirtualMountedDevice *>(node.get());
@@ -166,6 +170,7 @@ Error
 VirtualDevice::unmountDevice(const User &user,
                              const Path &path)
 {
+   auto invalidation = PathCacheInvalidation { };
    auto [parentNode, relativePath] = findDeepest(user, path, 1);
    if (parentNode->type == VirtualNode::MountedDevice) {
       auto mountedDevice = static_cast<VirtualMountedDevice *>(parentNode.get());
@@ -191,6 +196,7 @@ VirtualDevice::unmountOverlayDevice(const User &user,
                                     vfs::OverlayPriority priority,
                                     const Path &path)
 {
+   auto invalidation = PathCacheInvalidation { };
    auto [node, relativePath] = findDeepest(user, path);
    if (node->type != VirtualNode::MountedDevice) {
       return Error::NotMountDevice;
@@ -204,7 +210,7 @@ Result<DirectoryIterator>
 VirtualDevice::openDirectory(const User &user,
                              const Path &path)
 {
-   auto [node, relativePath] = findDeepest(user, path);
+   auto [node, relativePath] = findDeepestCached(user, path);
    if (node->type == VirtualNode::MountedDevice) {
       auto mountedDevice = static_cast<VirtualMountedDevice *>(node.get());
       return mountedDevice->device->openDirectory(user, relativePath);
@@ -228,7 +234,14 @@ VirtualDevice::openFile(const User &user,
                         const Path &path,
                         FileHandle::Mode mode)
 {
-   auto [node, relativePath] = findDeepest(user, path);
+   auto canCreate = (mode & (FileHandle::Write | FileHandle::Append)) != 0;
+   auto invalidation = std::optional<PathCacheInvalidation> { };
+   if (canCreate) {
+      invalidation.emplace();
+   }
+
+   auto [node, relativePath] =
+      canCreate ? findDeepest(user, path) : findDeepestCached(user, path);
    if (node->type == VirtualNode::MountedDevice) {
       if (relativePath.depth() == 0) {
          return Error::NotFile;
@@ -254,6 +267,7 @@ Error
 VirtualDevice::remove(const User &user,
                       const Path &path)
 {
+   auto invalidation = PathCacheInvalidation { };
    auto [parentNode, relativePath] = findDeepest(user, path, 1);
    if (parentNode->type == VirtualNode::MountedDevice) {
       // Forward remove into mounted device
@@ -281,6 +295,7 @@ VirtualDevice::rename(const User &user,
                       const Path &src,
                       const Path &dst)
 {
+   auto invalidation = PathCacheInvalidation { };
    auto [srcParent, srcRelativePath] = findDeepest(user, src, 1);
    auto [dstParent, dstRelativePath] = findDeepest(user, dst, 1);
 
@@ -321,7 +336,7 @@ VirtualDevice::setGroup(const User &user,
                         const Path &path,
                         GroupId group)
 {
-   auto [node, relativePath] = findDeepest(user, path);
+   auto [node, relativePath] = findDeepestCached(user, path);
    if (node->type == VirtualNode::MountedDevice) {
       auto mountedDevice = static_cast<VirtualMountedDevice *>(node.get());
       return mountedDevice->device->setGroup(user, relativePath, group);
@@ -340,7 +355,7 @@ VirtualDevice::setOwner(const User &user,
                         const Path &path,
                         OwnerId owner)
 {
-   auto [node, relativePath] = findDeepest(user, path);
+   auto [node, relativePath] = findDeepestCached(user, path);
    if (node->type == VirtualNode::MountedDevice) {
       auto mountedDevice = static_cast<VirtualMountedDevice *>(node.get());
       return mountedDevice->device->setOwner(user, relativePath, owner);
@@ -359,7 +374,7 @@ VirtualDevice::setPermissions(const User &user,
                               const Path &path,
                               Permissions mode)
 {
-   auto [node, relativePath] = findDeepest(user, path);
+   auto [node, relativePath] = findDeepestCached(user, path);
    if (node->type == VirtualNode::MountedDevice) {
       auto mountedDevice = static_cast<VirtualMountedDevice *>(node.get());
       return mountedDevice->device->setPermissions(user, relativePath, mode);
@@ -376,7 +391,7 @@ VirtualDevice::setPermissions(const User &user,
 Result<Status>
 VirtualDevice::status(const User &user, const Path &path)
 {
-   auto [node, relativePath] = findDeepest(user, path);
+   auto [node, relativePath] = findDeepestCached(user, path);
    if (node->type == VirtualNode::MountedDevice) {
       auto mountedDevice = static_cast<VirtualMountedDevice *>(node.get());
       return mountedDevice->device->status(user, relativePath);
@@ -405,7 +420,7 @@ VirtualDevice::status(const User &user, const Path &path)
    return status;
 }
 
-std::pair<std::shared_ptr<VirtualNode>, Path>
+VirtualDevice::FindResult
 VirtualDevice::findDeepest(const User &user,
                            Path path,
                            int parentLevel)
@@ -451,4 +466,23 @@ VirtualDevice::findDeepest(const User &user,
    return { dir, Path { itr, path.end() } };
 }
 
+
+/**
+ * Equivalent to findDeepest(user, path), but remembers the result until the
+ * file system tree is next modified.
+ */
+VirtualDevice::FindResult
+VirtualDevice::findDeepestCached(const User &user,
+                                 const Path &path)
+{
+   auto generation = getPathCacheGeneration();
+   if (auto cached = mPathCache.find(path.path())) {
+      return std::move(*cached);
+   }
+
+   auto result = findDeepest(user, path);
+   mPathCache.insert(path.path(), result, generation);
+   return result;
+}
+
 } // namespace vfs
@@ -1,8 +1,10 @@
 #pragma once
 #include "vfs_device.h"
+#include "vfs_pathcache.h"
 #include "vfs_virtual_directory.h"
 
 #include <memory>
+#include <utility>
 
 namespace vfs
 {
@@ -64,12 +66,20 @@ public:
    status(const User &user, const Path &path) override;
 
 private:
-   std::pair<std::shared_ptr<VirtualNode>, Path>
+   using FindResult = std::pair<std::shared_ptr<VirtualNode>, Path>;
+
+   FindResult
    findDeepest(const User &user, Path path, int parentLevel = 0);
 
+   FindResult
+   findDeepestCached(const User &user, const Path &path);
+
 private:
    std::string mRootDeviceName;
    std::shared_ptr<VirtualDirectory> mRoot;
+
+   //! Results of findDeepest for paths which do not modify the tree.
+   PathCache<FindResult> mPathCache;
 };
 
 } // namespace vfs
@@ -9,4 +9,7 @@ using FlipCallbackFn = void(*)();
 void
 setFlipCallback(FlipCallbackFn callback);
 
+void
+setActiveTitleId(uint64_t titleId);
+
 } // namespace gpu
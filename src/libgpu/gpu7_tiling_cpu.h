@@ -4,6 +4,25 @@
 namespace gpu7::tiling::cpu
 {
 
+enum class SimdLevel
+{
+   None,
+   SSE2,
+   AVX2,
+};
+
+SimdLevel
+getSupportedSimdLevel();
+
+void
+setSimdLevel(SimdLevel level);
+
+SimdLevel
+getSimdLevel();
+
+void
+setNumWorkerThreads(uint32_t numThreads);
+
 void
 untile(const RetileInfo& desc,
        uint8_t* untiled,
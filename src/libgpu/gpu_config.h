@@ -2,11 +2,19 @@
 #include <array>
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace gpu
 {
 
+struct CacheSettings
+{
+   //! Directory to store translated shaders and pipelines in between runs,
+   //! a subdirectory is created for each title.
+   std::string directory;
+};
+
 struct DebugSettings
 {
    //! Enable debugging
@@ -17,6 +25,9 @@ struct DebugSettings
 
    //! Only dump shader binaries
    bool dump_shader_binaries_only = false;
+
+   //! Log draws which are skipped because their pipeline is still compiling
+   bool log_skipped_draws = false;
 };
 
 struct DisplaySettings
@@ -50,10 +61,43 @@ struct DisplaySettings
    ViewMode viewMode = ViewMode::Split;
 };
 
+struct PipelineSettings
+{
+   //! Number of threads to compile new pipelines on in the background, when
+   //! 0 pipelines are compiled on the GPU thread by the draw which needs them.
+   unsigned compile_threads = 0;
+
+   //! How long a draw waits for a pipeline compiling in the background before
+   //! the draw is skipped, in milliseconds.
+   unsigned compile_wait_ms = 0;
+};
+
+struct TilingSettings
+{
+   enum SimdLevel
+   {
+      Auto,
+      None,
+      SSE2,
+      AVX2,
+   };
+
+   //! Number of threads used to retile large surfaces on the CPU, in addition
+   //! to the thread which requested the retile. When 0 retiling is serial.
+   unsigned cpu_retile_threads = 0;
+
+   //! SIMD kernels used to retile surfaces on the CPU, Auto picks the best one
+   //! the host CPU supports.
+   SimdLevel cpu_retile_simd = Auto;
+};
+
 struct Settings
 {
+   CacheSettings cache;
    DebugSettings debug;
    DisplaySettings display;
+   PipelineSettings pipeline;
+   TilingSettings tiling;
 };
 
 std::shared_ptr<const Settings> config();
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+
+namespace gpu
+{
+
+/*
+Conversions from guest index data to something the host GPU can draw with.
+
+unpackQuadList expands each quad a, b, c, d into the two triangles a, b, c
+and a, c, d. Any trailing indices which do not make up a whole quad are
+dropped, so dst must have room for numIndices / 4 * 6 indices. When swap is
+set the indices are byte swapped as they are expanded. Indices which only
+need a byte swap should use byte_swap_to_scratch from common instead.
+
+generateQuadList writes the triangle list for numIndices sequential vertices
+drawn as quads, for quad list draws which do not have an index buffer.
+
+getQuadListNumIndices returns the number of indices either of them writes,
+which is zero for fewer than 4 indices.
+
+unpackQuadListScalar is the reference implementation the SIMD kernels must
+match, it is exposed for the tests.
+*/
+
+void
+unpackQuadList(uint16_t *dst,
+               const uint16_t *src,
+               uint32_t numIndices,
+               bool swap);
+
+void
+unpackQuadList(uint32_t *dst,
+               const uint32_t *src,
+               uint32_t numIndices,
+               bool swap);
+
+void
+generateQuadList(uint16_t *dst,
+                 uint32_t numIndices);
+
+void
+generateQuadList(uint32_t *dst,
+                 uint32_t numIndices);
+
+uint32_t
+getQuadListNumIndices(uint32_t numIndices);
+
+void
+unpackQuadListScalar(uint16_t *dst,
+                     const uint16_t *src,
+                     uint32_t numIndices,
+                     bool swap);
+
+void
+unpackQuadListScalar(uint32_t *dst,
+                     const uint32_t *src,
+                     uint32_t numIndices,
+                     bool swap);
+
+} // namespace gpu
@@ -13,10 +13,19 @@ write(const Buffer &buffer);
 Buffer
 read();
 
+void
+release();
+
 bool
 wait();
 
 void
 wake();
 
+size_t
+depth();
+
+uint64_t
+submitted();
+
 } // namespace gpu::ringbuffer
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gpu
+{
+
+/**
+ * Shader Cache File Responsibilities:
+ *
+ * 1. Store serialised shaders in an append only file, keyed by a persistent
+ *    hash of the shader along with the type of the shader.
+ * 2. Discard the file when it was written by a different shader translator
+ *    revision.
+ * 3. Skip records which fail their checksum, and drop a partially written
+ *    record from the end of the file so new records are not appended after
+ *    it.
+ *
+ * Records stored whilst the file is open are only visible to lookup after
+ * the file has been opened again.
+ */
+class ShaderCacheFile
+{
+   static constexpr uint32_t Magic = 0x43535644; // "DVSC"
+
+   struct FileHeader
+   {
+      uint32_t magic;
+      uint32_t padding;
+
+      //! Revision of the shader translator which wrote the file.
+      uint64_t revision;
+   };
+
+   struct RecordHeader
+   {
+      //! Persistent hash of the shader.
+      uint64_t key;
+
+      //! Type of the shader, so that different stages never alias.
+      uint32_t type;
+
+      //! Size of the serialised shader following this header.
+      uint32_t size;
+
+      //! Hash of the serialised shader.
+      uint64_t checksum;
+   };
+
+   struct Record
+   {
+      uint32_t type;
+      size_t offset;
+      uint32_t size;
+   };
+
+public:
+   ~ShaderCacheFile();
+
+   bool
+   open(const std::string &path,
+        uint64_t revision);
+
+   void
+   close();
+
+   bool
+   enabled() const
+   {
+      return mFile != nullptr;
+   }
+
+   const uint8_t *
+   lookup(uint32_t type,
+          uint64_t key,
+          uint32_t &size) const;
+
+   void
+   store(uint32_t type,
+         uint64_t key,
+         const std::vector<uint8_t> &data);
+
+private:
+   FILE *mFile = nullptr;
+   std::vector<uint8_t> mData;
+   std::unordered_map<uint64_t, Record> mRecords;
+};
+
+} // namespace gpu
@@ -21,6 +21,10 @@ struct VulkanDriverDebugInfo : GraphicsDriverDebugInfo
    uint64_t numSamplers = 0;
    uint64_t numSurfaces = 0;
    uint64_t numDataBuffers = 0;
+   uint64_t numIndexBuffers = 0;
+   uint64_t numDisplayLists = 0;
+   uint64_t displayListCacheHits = 0;
+   uint64_t displayListCacheMisses = 0;
 };
 
 } // namespace gpu
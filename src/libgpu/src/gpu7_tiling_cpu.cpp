@@ -2,12 +2,135 @@
 
 #include <common/align.h>
 #include <common/decaf_assert.h>
+#include <common/platform_intrin.h>
+#include <common/workerpool.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 
 namespace gpu7::tiling::cpu
 {
 
+//! Surfaces with fewer micro tiles than this are always retiled serially.
+static constexpr uint32_t MinParallelTiles = 256;
+
+//! Smallest number of micro tiles given to a worker at once.
+static constexpr uint32_t MinTilesPerChunk = 64;
+
+static std::atomic<SimdLevel>
+sSimdLevel { getSupportedSimdLevel() };
+
+//! Threads used to retile large surfaces, set by setNumWorkerThreads.
+static WorkerPool
+sWorkerPool;
+
+/*
+The SIMD kernels below retile whole micro tiles so that the AVX2 ones, which
+cannot be inlined into code built without AVX2, are only called once per tile.
+*/
+
+template<bool IsUntiling>
+static inline void
+retileRows8SSE2(uint8_t *tiled,
+                uint8_t *untiled,
+                uint32_t untiledStride,
+                uint32_t numRowQuads)
+{
+   // Each group of 4 untiled rows is stored in the order 0, 2, 1, 3
+   for (auto i = 0u; i < numRowQuads; ++i) {
+      auto untiledRow0 = reinterpret_cast<__m128i *>(untiled + 0 * untiledStride);
+      auto untiledRow1 = reinterpret_cast<__m128i *>(untiled + 1 * untiledStride);
+      auto untiledRow2 = reinterpret_cast<__m128i *>(untiled + 2 * untiledStride);
+      auto untiledRow3 = reinterpret_cast<__m128i *>(untiled + 3 * untiledStride);
+      auto tiledRows = reinterpret_cast<__m128i *>(tiled);
+
+      if constexpr (IsUntiling) {
+         auto rows02 = _mm_loadu_si128(tiledRows + 0);
+         auto rows13 = _mm_loadu_si128(tiledRows + 1);
+         _mm_storel_epi64(untiledRow0, rows02);
+         _mm_storel_epi64(untiledRow2, _mm_unpackhi_epi64(rows02, rows02));
+         _mm_storel_epi64(untiledRow1, rows13);
+         _mm_storel_epi64(untiledRow3, _mm_unpackhi_epi64(rows13, rows13));
+      } else {
+         _mm_storeu_si128(tiledRows + 0,
+                          _mm_unpacklo_epi64(_mm_loadl_epi64(untiledRow0),
+                                             _mm_loadl_epi64(untiledRow2)));
+         _mm_storeu_si128(tiledRows + 1,
+                          _mm_unpacklo_epi64(_mm_loadl_epi64(untiledRow1),
+                                             _mm_loadl_epi64(untiledRow3)));
+      }
+
+      untiled += 4 * untiledStride;
+      tiled += 32;
+   }
+}
+
+template<bool IsUntiling>
+PLATFORM_TARGET_AVX2 static void
+retileRows16AVX2(uint8_t *tiled,
+                 uint8_t *untiled,
+                 uint32_t untiledStride,
+                 uint32_t numRowPairs)
+{
+   // Untiled rows are stored consecutively, so copy two rows at a time
+   for (auto i = 0u; i < numRowPairs; ++i) {
+      auto untiledRow1 = reinterpret_cast<__m128i *>(untiled + 0 * untiledStride);
+      auto untiledRow2 = reinterpret_cast<__m128i *>(untiled + 1 * untiledStride);
+      auto tiledRows = reinterpret_cast<__m256i *>(tiled);
+
+      if constexpr (IsUntiling) {
+         auto rows = _mm256_loadu_si256(tiledRows);
+         _mm_storeu_si128(untiledRow1, _mm256_castsi256_si128(rows));
+         _mm_storeu_si128(untiledRow2, _mm256_extracti128_si256(rows, 1));
+      } else {
+         auto rows = _mm256_castsi128_si256(_mm_loadu_si128(untiledRow1));
+         rows = _mm256_inserti128_si256(rows, _mm_loadu_si128(untiledRow2), 1);
+         _mm256_storeu_si256(tiledRows, rows);
+      }
+
+      untiled += 2 * untiledStride;
+      tiled += 32;
+   }
+}
+
+/**
+ * For 32, 64 and 128 bpp a pair of untiled rows is stored with their 16 byte
+ * groups interleaved, which is exactly a 128 bit lane permute of each 32 byte
+ * chunk of the two rows.
+ */
+template<bool IsUntiling, uint32_t ChunksPerRow>
+PLATFORM_TARGET_AVX2 static void
+retileRowPairsAVX2(uint8_t *tiled,
+                   uint32_t tiledPairStride,
+                   uint8_t *untiled,
+                   uint32_t untiledStride,
+                   uint32_t numRowPairs)
+{
+   for (auto i = 0u; i < numRowPairs; ++i) {
+      auto untiledRow1 = reinterpret_cast<__m256i *>(untiled + 0 * untiledStride);
+      auto untiledRow2 = reinterpret_cast<__m256i *>(untiled + 1 * untiledStride);
+      auto tiledRows = reinterpret_cast<__m256i *>(tiled);
+
+      for (auto j = 0u; j < ChunksPerRow; ++j) {
+         if constexpr (IsUntiling) {
+            auto lo = _mm256_loadu_si256(tiledRows + j * 2 + 0);
+            auto hi = _mm256_loadu_si256(tiledRows + j * 2 + 1);
+            _mm256_storeu_si256(untiledRow1 + j, _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256(untiledRow2 + j, _mm256_permute2x128_si256(lo, hi, 0x31));
+         } else {
+            auto row1 = _mm256_loadu_si256(untiledRow1 + j);
+            auto row2 = _mm256_loadu_si256(untiledRow2 + j);
+            _mm256_storeu_si256(tiledRows + j * 2 + 0, _mm256_permute2x128_si256(row1, row2, 0x20));
+            _mm256_storeu_si256(tiledRows + j * 2 + 1, _mm256_permute2x128_si256(row1, row2, 0x31));
+         }
+      }
+
+      untiled += 2 * untiledStride;
+      tiled += tiledPairStride;
+   }
+}
+
 template<
    bool IsUntiling,
    uint32_t MicroTileThickness,
@@ -16,7 +139,8 @@ template<
    bool IsMacro3X,
    bool IsBankSwapped,
    uint32_t BitsPerElement,
-   bool IsDepth
+   bool IsDepth,
+   SimdLevel Simd
 >
 struct RetileCore
 {
@@ -44,6 +168,11 @@ struct RetileCore
       static constexpr auto tiledStride = MicroTileWidth;
       static constexpr auto rowElems = MicroTileWidth / 8;
 
+      if constexpr (Simd != SimdLevel::None) {
+         retileRows8SSE2<IsUntiling>(tiled, untiled, untiledStride, MicroTileHeight / 4);
+         return;
+      }
+
       for (int y = 0; y < MicroTileHeight; y += 4) {
          auto untiledRow0 = untiled + 0 * untiledStride;
          auto untiledRow1 = untiled + 1 * untiledStride;
@@ -73,6 +202,11 @@ struct RetileCore
       static constexpr auto tiledStride = MicroTileWidth * 2;
       static constexpr auto rowElems = MicroTileWidth * 2 / 16;
 
+      if constexpr (Simd == SimdLevel::AVX2) {
+         retileRows16AVX2<IsUntiling>(tiled, untiled, untiledStride, MicroTileHeight / 2);
+         return;
+      }
+
       for (int y = 0; y < MicroTileHeight; ++y) {
          copyElems<16>(untiled, tiled, rowElems);
 
@@ -89,6 +223,13 @@ struct RetileCore
       static constexpr auto tiledStride = MicroTileWidth * 4;
       static constexpr auto groupElems = 4 * 4 / 16;
 
+      if constexpr (Simd == SimdLevel::AVX2) {
+         retileRowPairsAVX2<IsUntiling, 1>(tiled, tiledStride * 2,
+                                           untiled, untiledStride,
+                                           MicroTileHeight / 2);
+         return;
+      }
+
       for (int y = 0; y < MicroTileHeight; y += 2) {
          auto untiledRow1 = untiled + 0 * untiledStride;
          auto untiledRow2 = untiled + 1 * untiledStride;
@@ -115,6 +256,23 @@ struct RetileCore
       static constexpr auto tiledStride = MicroTileWidth * 8;
       static constexpr auto groupElems = 2 * (64 / 8) / 16;
 
+      if constexpr (Simd == SimdLevel::AVX2) {
+         if constexpr (IsMacroTiling) {
+            // At y == 4 we hit the next group (at element offset 256)
+            retileRowPairsAVX2<IsUntiling, 2>(tiled, tiledStride * 2,
+                                              untiled, untiledStride,
+                                              2);
+            retileRowPairsAVX2<IsUntiling, 2>(tiled + (0x100 << (NumBankBits + NumPipeBits)), tiledStride * 2,
+                                              untiled + 4 * untiledStride, untiledStride,
+                                              2);
+         } else {
+            retileRowPairsAVX2<IsUntiling, 2>(tiled, tiledStride * 2,
+                                              untiled, untiledStride,
+                                              MicroTileHeight / 2);
+         }
+         return;
+      }
+
       for (int y = 0; y < MicroTileHeight; y += 2) {
          if constexpr (IsMacroTiling) {
             if (y == 4) {
@@ -156,6 +314,15 @@ struct RetileCore
       static constexpr auto groupBytes = 16;
       static constexpr auto groupElems = 16 / 16;
 
+      if constexpr (Simd == SimdLevel::AVX2) {
+         static constexpr auto tiledPairStride =
+            IsMacroTiling ? (0x100 << (NumBankBits + NumPipeBits)) : tiledStride * 2;
+         retileRowPairsAVX2<IsUntiling, 4>(tiled, tiledPairStride,
+                                           untiled, untiledStride,
+                                           MicroTileHeight / 2);
+         return;
+      }
+
       for (int y = 0; y < MicroTileHeight; y += 2) {
          auto untiledRow1 = untiled + 0 * untiledStride;
          auto untiledRow2 = untiled + 1 * untiledStride;
@@ -463,9 +630,10 @@ struct RetileCore
 template<bool IsUntiling,
    TileMode RetileMode,
    uint32_t BitsPerElement,
-   bool IsDepth>
+   bool IsDepth,
+   SimdLevel Simd>
    static inline void
-retileTiledSurface3(const RetileInfo& info,
+retileTiledSurface4(const RetileInfo& info,
                     uint8_t *untiled,
                     uint8_t *tiled,
                     uint32_t firstSlice,
@@ -479,9 +647,18 @@ retileTiledSurface3(const RetileInfo& info,
       getTileModeIs3X(RetileMode),
       getTileModeIsBankSwapped(RetileMode),
       BitsPerElement,
-      IsDepth>;
+      IsDepth,
+      Simd>;
+
+   struct Context
+   {
+      typename Retiler::Params params;
+      uint8_t *untiled;
+      uint8_t *tiled;
+   };
 
-   typename Retiler::Params params;
+   Context context;
+   auto &params = context.params;
    params.firstSliceIndex = firstSlice;
 
    params.numTilesPerRow = info.numTilesPerRow;
@@ -493,9 +670,53 @@ retileTiledSurface3(const RetileInfo& info,
    params.pipeSwizzle = info.pipeSwizzle;
    params.bankSwapWidth = info.bankSwapWidth;
 
+   context.untiled = untiled;
+   context.tiled = tiled;
+
+   // Every micro tile is written to a distinct location so the tiles can be
+   // split across threads however we like.
    uint32_t numTiles = numSlices * info.numTilesPerSlice;
-   for (auto tileIndex = 0u; tileIndex < numTiles; ++tileIndex) {
-      Retiler::retile(params, tileIndex, untiled, tiled);
+   auto retileRange =
+      [](const void *ctx, uint32_t firstTile, uint32_t lastTile)
+      {
+         auto &context = *reinterpret_cast<const Context *>(ctx);
+         for (auto tileIndex = firstTile; tileIndex < lastTile; ++tileIndex) {
+            Retiler::retile(context.params, tileIndex, context.untiled, context.tiled);
+         }
+      };
+
+   if (numTiles < MinParallelTiles) {
+      retileRange(&context, 0, numTiles);
+   } else {
+      sWorkerPool.run(numTiles, MinTilesPerChunk, retileRange, &context);
+   }
+}
+
+template<bool IsUntiling,
+   TileMode RetileMode,
+   uint32_t BitsPerElement,
+   bool IsDepth>
+   static inline void
+retileTiledSurface3(const RetileInfo& info,
+                    uint8_t *untiled,
+                    uint8_t *tiled,
+                    uint32_t firstSlice,
+                    uint32_t numSlices)
+{
+   if constexpr (IsDepth) {
+      // There are no SIMD depth kernels
+      retileTiledSurface4<IsUntiling, RetileMode, BitsPerElement, IsDepth, SimdLevel::None>(info, untiled, tiled, firstSlice, numSlices);
+   } else {
+      switch (sSimdLevel.load(std::memory_order_relaxed)) {
+      case SimdLevel::AVX2:
+         retileTiledSurface4<IsUntiling, RetileMode, BitsPerElement, IsDepth, SimdLevel::AVX2>(info, untiled, tiled, firstSlice, numSlices);
+         break;
+      case SimdLevel::SSE2:
+         retileTiledSurface4<IsUntiling, RetileMode, BitsPerElement, IsDepth, SimdLevel::SSE2>(info, untiled, tiled, firstSlice, numSlices);
+         break;
+      default:
+         retileTiledSurface4<IsUntiling, RetileMode, BitsPerElement, IsDepth, SimdLevel::None>(info, untiled, tiled, firstSlice, numSlices);
+      }
    }
 }
 
@@ -632,6 +853,47 @@ retile(const RetileInfo& info,
    retileTiledSurface<IsUntiling>(info, untiled, tiled, firstSlice, numSlices);
 }
 
+/**
+ * Returns the best SIMD level supported by the host CPU.
+ */
+SimdLevel
+getSupportedSimdLevel()
+{
+   if (platform::hasAvx2()) {
+      return SimdLevel::AVX2;
+   }
+
+   return SimdLevel::SSE2;
+}
+
+
+/**
+ * Select the SIMD kernels used for retiling, limited to what the host CPU
+ * supports. Defaults to getSupportedSimdLevel().
+ */
+void
+setSimdLevel(SimdLevel level)
+{
+   sSimdLevel.store(std::min(level, getSupportedSimdLevel()));
+}
+
+SimdLevel
+getSimdLevel()
+{
+   return sSimdLevel.load();
+}
+
+
+/**
+ * Set the number of worker threads used to retile large surfaces, in addition
+ * to the calling thread. Defaults to 0, where all retiling is done serially.
+ */
+void
+setNumWorkerThreads(uint32_t numThreads)
+{
+   sWorkerPool.setNumThreads(numThreads);
+}
+
 void
 untile(const RetileInfo& info,
        uint8_t *untiled,
@@ -1,5 +1,6 @@
 #include "gpu_config.h"
 #include "gpu_configstorage.h"
+#include "gpu7_tiling_cpu.h"
 
 #include <common/configstorage.h>
 
@@ -14,10 +15,37 @@ config()
    return sSettings.get();
 }
 
+/**
+ * Apply the settings for the CPU retiler, which is used by GX2 whichever
+ * graphics driver is running.
+ */
+static void
+applyTilingSettings(const TilingSettings &settings)
+{
+   using gpu7::tiling::cpu::SimdLevel;
+
+   switch (settings.cpu_retile_simd) {
+   case TilingSettings::None:
+      gpu7::tiling::cpu::setSimdLevel(SimdLevel::None);
+      break;
+   case TilingSettings::SSE2:
+      gpu7::tiling::cpu::setSimdLevel(SimdLevel::SSE2);
+      break;
+   case TilingSettings::AVX2:
+      gpu7::tiling::cpu::setSimdLevel(SimdLevel::AVX2);
+      break;
+   default:
+      gpu7::tiling::cpu::setSimdLevel(gpu7::tiling::cpu::getSupportedSimdLevel());
+   }
+
+   gpu7::tiling::cpu::setNumWorkerThreads(settings.cpu_retile_threads);
+}
+
 void
 setConfig(const Settings &settings)
 {
    sSettings.set(std::make_shared<Settings>(settings));
+   applyTilingSettings(settings.tiling);
 }
 
 void
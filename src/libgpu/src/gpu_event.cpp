@@ -1,10 +1,13 @@
 #include "gpu.h"
 #include "gpu_event.h"
 
+#include <atomic>
+
 namespace gpu
 {
 
 static FlipCallbackFn sFlipCallbackFn = nullptr;
+static std::atomic<uint64_t> sActiveTitleId { 0 };
 
 void
 setFlipCallback(FlipCallbackFn callback)
@@ -12,6 +15,22 @@ setFlipCallback(FlipCallbackFn callback)
    sFlipCallbackFn = callback;
 }
 
+/**
+ * Set the title which is currently using the GPU, drivers use this to pick
+ * which on disk caches to load.
+ */
+void
+setActiveTitleId(uint64_t titleId)
+{
+   sActiveTitleId.store(titleId);
+}
+
+uint64_t
+getActiveTitleId()
+{
+   return sActiveTitleId.load();
+}
+
 void
 onFlip()
 {
@@ -7,4 +7,7 @@ namespace gpu
 void
 onFlip();
 
+uint64_t
+getActiveTitleId();
+
 } // namespace gpu
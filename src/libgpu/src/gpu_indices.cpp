@@ -0,0 +1,205 @@
+#include "gpu_indices.h"
+
+#include <common/byte_swap.h>
+#include <common/platform_intrin.h>
+
+#include <cstring>
+#include <initializer_list>
+
+namespace gpu
+{
+
+template<typename IndexType>
+static void
+unpackQuadListScalar(IndexType *dst,
+                     const IndexType *src,
+                     uint32_t numIndices,
+                     bool swap)
+{
+   for (auto i = 0u; i < numIndices / 4; ++i, src += 4) {
+      auto index0 = swap ? byte_swap(src[0]) : src[0];
+      auto index1 = swap ? byte_swap(src[1]) : src[1];
+      auto index2 = swap ? byte_swap(src[2]) : src[2];
+      auto index3 = swap ? byte_swap(src[3]) : src[3];
+
+      *(dst++) = index0;
+      *(dst++) = index1;
+      *(dst++) = index2;
+
+      *(dst++) = index0;
+      *(dst++) = index2;
+      *(dst++) = index3;
+   }
+}
+
+template<typename IndexType>
+static void
+generateQuadListScalar(IndexType *dst,
+                       uint32_t numIndices)
+{
+   for (auto i = 0u; i < numIndices / 4; ++i) {
+      auto index = static_cast<IndexType>(i * 4);
+
+      *(dst++) = static_cast<IndexType>(index + 0);
+      *(dst++) = static_cast<IndexType>(index + 1);
+      *(dst++) = static_cast<IndexType>(index + 2);
+
+      *(dst++) = static_cast<IndexType>(index + 0);
+      *(dst++) = static_cast<IndexType>(index + 2);
+      *(dst++) = static_cast<IndexType>(index + 3);
+   }
+}
+
+void
+unpackQuadListScalar(uint16_t *dst,
+                     const uint16_t *src,
+                     uint32_t numIndices,
+                     bool swap)
+{
+   unpackQuadListScalar<uint16_t>(dst, src, numIndices, swap);
+}
+
+void
+unpackQuadListScalar(uint32_t *dst,
+                     const uint32_t *src,
+                     uint32_t numIndices,
+                     bool swap)
+{
+   unpackQuadListScalar<uint32_t>(dst, src, numIndices, swap);
+}
+
+
+/*
+The SIMD kernels are all a single byte shuffle per 16 bytes of input. Each
+byte of a shuffle mask selects the input byte for that byte of the output,
+so the byte swap is folded into the same shuffle as the quad expansion and
+costs nothing extra. Mask bytes of 0x80 zero the output byte, these are only
+used for the parts of a vector which are not stored.
+
+The kernels return the number of indices they consumed, the remainder is
+left to the scalar code.
+*/
+
+template<typename IndexType>
+static __m128i
+makeShuffleMask(std::initializer_list<unsigned> elements,
+                bool swap)
+{
+   alignas(16) uint8_t bytes[16];
+   std::memset(bytes, 0x80, sizeof(bytes));
+
+   auto pos = 0u;
+   for (auto element : elements) {
+      for (auto i = 0u; i < sizeof(IndexType); ++i) {
+         auto srcByte = swap ? (sizeof(IndexType) - 1 - i) : i;
+         bytes[pos++] = static_cast<uint8_t>(element * sizeof(IndexType) + srcByte);
+      }
+   }
+
+   return _mm_load_si128(reinterpret_cast<const __m128i *>(bytes));
+}
+
+PLATFORM_TARGET_SSSE3 static uint32_t
+unpackQuadList16SSSE3(uint16_t *dst,
+                      const uint16_t *src,
+                      uint32_t numIndices,
+                      __m128i maskLo,
+                      __m128i maskHi)
+{
+   auto i = 0u;
+
+   // Two quads at a time, giving 12 output indices
+   for (; i + 8 <= numIndices; i += 8, dst += 12) {
+      auto quads = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst),
+                       _mm_shuffle_epi8(quads, maskLo));
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + 8),
+                       _mm_shuffle_epi8(quads, maskHi));
+   }
+
+   return i;
+}
+
+PLATFORM_TARGET_SSSE3 static uint32_t
+unpackQuadList32SSSE3(uint32_t *dst,
+                      const uint32_t *src,
+                      uint32_t numIndices,
+                      __m128i maskLo,
+                      __m128i maskHi)
+{
+   auto i = 0u;
+
+   // One quad at a time, giving 6 output indices
+   for (; i + 4 <= numIndices; i += 4, dst += 6) {
+      auto quad = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst),
+                       _mm_shuffle_epi8(quad, maskLo));
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + 4),
+                       _mm_shuffle_epi8(quad, maskHi));
+   }
+
+   return i;
+}
+
+static bool
+useSsse3()
+{
+   static const auto hasSsse3 = platform::hasSsse3();
+   return hasSsse3;
+}
+
+void
+unpackQuadList(uint16_t *dst,
+               const uint16_t *src,
+               uint32_t numIndices,
+               bool swap)
+{
+   auto i = 0u;
+
+   if (useSsse3()) {
+      i = unpackQuadList16SSSE3(dst, src, numIndices,
+                                makeShuffleMask<uint16_t>({ 0, 1, 2, 0, 2, 3, 4, 5 }, swap),
+                                makeShuffleMask<uint16_t>({ 6, 4, 6, 7 }, swap));
+   }
+
+   unpackQuadListScalar<uint16_t>(dst + i / 4 * 6, src + i, numIndices - i, swap);
+}
+
+void
+unpackQuadList(uint32_t *dst,
+               const uint32_t *src,
+               uint32_t numIndices,
+               bool swap)
+{
+   auto i = 0u;
+
+   if (useSsse3()) {
+      i = unpackQuadList32SSSE3(dst, src, numIndices,
+                                makeShuffleMask<uint32_t>({ 0, 1, 2, 0 }, swap),
+                                makeShuffleMask<uint32_t>({ 2, 3 }, swap));
+   }
+
+   unpackQuadListScalar<uint32_t>(dst + i / 4 * 6, src + i, numIndices - i, swap);
+}
+
+void
+generateQuadList(uint16_t *dst,
+                 uint32_t numIndices)
+{
+   generateQuadListScalar<uint16_t>(dst, numIndices);
+}
+
+void
+generateQuadList(uint32_t *dst,
+                 uint32_t numIndices)
+{
+   generateQuadListScalar<uint32_t>(dst, numIndices);
+}
+
+uint32_t
+getQuadListNumIndices(uint32_t numIndices)
+{
+   return numIndices / 4 * 6;
+}
+
+} // namespace gpu
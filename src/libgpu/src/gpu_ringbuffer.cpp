@@ -1,17 +1,53 @@
 #include "gpu_ringbuffer.h"
 
+#include <array>
+#include <atomic>
 #include <condition_variable>
+#include <cstring>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 namespace gpu::ringbuffer
 {
 
-static std::vector<uint32_t>
-mWriteVector;
+//! Number of buffer descriptors in the ring, must be a power of two.
+static constexpr size_t Capacity = 4096;
 
-static std::vector<uint32_t>
-mReadVector;
+//! Buffers up to this many words are copied into their slot.
+static constexpr size_t MaxInlineWords = 16;
+
+//! A slot's storage is freed on release if it grew larger than this, so one
+//! huge submission does not stay allocated for the life of the ring.
+static constexpr size_t MaxRetainedWords = 64 * 1024;
+
+struct Slot
+{
+   //! Twice the lap of the ring the slot is on, plus one once it has been
+   //! written and not yet released by the reader.
+   std::atomic<uint64_t> turn { 0 };
+
+   //! Buffer as seen by the reader, points to inlineWords or storage.
+   Buffer buffer;
+
+   std::array<uint32_t, MaxInlineWords> inlineWords;
+
+   //! Copy of buffers too large for inlineWords, kept between uses of the
+   //! slot so the allocation can be reused.
+   std::vector<uint32_t> storage;
+};
+
+static std::array<Slot, Capacity>
+sSlots;
+
+static std::atomic<uint64_t>
+sWritePosition { 0 };
+
+static std::atomic<uint64_t>
+sReadPosition { 0 };
+
+static std::atomic<bool>
+sReaderWaiting { false };
 
 static std::mutex
 sMutex;
@@ -22,34 +58,136 @@ sConditionVariable;
 static bool
 sPendingWake = false;
 
+static uint64_t
+getTurn(uint64_t position)
+{
+   return (position / Capacity) * 2;
+}
+
+static bool
+hasPendingBuffer()
+{
+   auto position = sReadPosition.load(std::memory_order_relaxed);
+   auto &slot = sSlots[position % Capacity];
+   return slot.turn.load(std::memory_order_acquire) == getTurn(position) + 1;
+}
+
+
+/**
+ * Queue a buffer for the GPU.
+ *
+ * The buffer is copied into the ring, so the caller is free to reuse it as soon
+ * as this returns, as with TCLSubmitToRing on real hardware.
+ *
+ * Safe to call from multiple threads at once.
+ */
 void
-write(const Buffer &items)
+write(const Buffer &buffer)
 {
-   std::unique_lock<std::mutex> lock { sMutex };
-   mWriteVector.insert(mWriteVector.end(), items.begin(), items.end());
-   sConditionVariable.notify_all();
+   if (buffer.empty()) {
+      return;
+   }
+
+   auto position = sWritePosition.load(std::memory_order_relaxed);
+   auto slot = static_cast<Slot *>(nullptr);
+
+   while (true) {
+      slot = &sSlots[position % Capacity];
+      auto turn = slot->turn.load(std::memory_order_acquire);
+      auto diff = static_cast<int64_t>(turn - getTurn(position));
+
+      if (diff == 0) {
+         if (sWritePosition.compare_exchange_weak(position, position + 1,
+                                                  std::memory_order_relaxed)) {
+            break;
+         }
+      } else if (diff < 0) {
+         // The ring is full, wait for the GPU to catch up.
+         std::this_thread::yield();
+         position = sWritePosition.load(std::memory_order_relaxed);
+      } else {
+         position = sWritePosition.load(std::memory_order_relaxed);
+      }
+   }
+
+   if (buffer.size() <= MaxInlineWords) {
+      std::memcpy(slot->inlineWords.data(), buffer.data(), buffer.size_bytes());
+      slot->buffer = { slot->inlineWords.data(), buffer.size() };
+   } else {
+      slot->storage.assign(buffer.begin(), buffer.end());
+      slot->buffer = { slot->storage.data(), buffer.size() };
+   }
+
+   slot->turn.store(getTurn(position) + 1, std::memory_order_release);
+
+   // Only take the lock when the reader is, or is about to be, asleep.
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+   if (sReaderWaiting.load(std::memory_order_relaxed)) {
+      std::unique_lock<std::mutex> lock { sMutex };
+      sConditionVariable.notify_all();
+   }
 }
 
+
+/**
+ * Get the oldest buffer in the ring without removing it.
+ *
+ * Returns an empty buffer if the ring is empty. The returned buffer remains
+ * valid until release is called. Must only be called from the GPU thread.
+ */
 Buffer
 read()
 {
-   std::unique_lock<std::mutex> lock { sMutex };
-   mReadVector.clear();
-   mReadVector.swap(mWriteVector);
-   return mReadVector;
+   if (!hasPendingBuffer()) {
+      return { };
+   }
+
+   auto position = sReadPosition.load(std::memory_order_relaxed);
+   return sSlots[position % Capacity].buffer;
+}
+
+
+/**
+ * Remove the buffer last returned by read from the ring.
+ */
+void
+release()
+{
+   auto position = sReadPosition.load(std::memory_order_relaxed);
+   auto &slot = sSlots[position % Capacity];
+
+   if (slot.storage.capacity() > MaxRetainedWords) {
+      std::vector<uint32_t> { }.swap(slot.storage);
+   }
+
+   slot.turn.store(getTurn(position) + 2, std::memory_order_release);
+   sReadPosition.store(position + 1, std::memory_order_relaxed);
 }
 
+
+/**
+ * Wait until there is a buffer in the ring or wake is called.
+ *
+ * Returns true if there is a buffer to read.
+ */
 bool
 wait()
 {
-   std::unique_lock<std::mutex> lock { sMutex };
-   if (mWriteVector.empty() && !sPendingWake) {
-      sConditionVariable.wait(lock);
+   if (hasPendingBuffer()) {
+      return true;
    }
 
-   sPendingWake = false;
+   std::unique_lock<std::mutex> lock { sMutex };
+   sReaderWaiting.store(true, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_seq_cst);
 
-   return !mWriteVector.empty();
+   sConditionVariable.wait(lock, [] {
+      return sPendingWake || hasPendingBuffer();
+   });
+
+   sReaderWaiting.store(false, std::memory_order_relaxed);
+   sPendingWake = false;
+   return hasPendingBuffer();
 }
 
 void
@@ -60,4 +198,26 @@ wake()
    sConditionVariable.notify_all();
 }
 
+
+/**
+ * Number of buffers which have been written but not yet released.
+ */
+size_t
+depth()
+{
+   auto readPosition = sReadPosition.load(std::memory_order_relaxed);
+   auto writePosition = sWritePosition.load(std::memory_order_relaxed);
+   return static_cast<size_t>(writePosition - readPosition);
+}
+
+
+/**
+ * Total number of buffers written since startup.
+ */
+uint64_t
+submitted()
+{
+   return sWritePosition.load(std::memory_order_relaxed);
+}
+
 } // namespace gpu::ringbuffer
@@ -0,0 +1,174 @@
+#include "gpu_shadercachefile.h"
+
+#include <common/datahash.h>
+#include <common/log.h>
+#include <cstring>
+
+namespace gpu
+{
+
+static uint64_t
+checksumRecord(const uint8_t *data,
+               size_t size)
+{
+   return DataHash {}.write(data, size).value();
+}
+
+ShaderCacheFile::~ShaderCacheFile()
+{
+   close();
+}
+
+
+/**
+ * Open the cache file at path, creating it if it does not exist.
+ *
+ * Files written by a different translator revision are discarded.
+ */
+bool
+ShaderCacheFile::open(const std::string &path,
+                      uint64_t revision)
+{
+   close();
+
+   if (auto file = fopen(path.c_str(), "rb")) {
+      fseek(file, 0, SEEK_END);
+      auto size = ftell(file);
+      fseek(file, 0, SEEK_SET);
+
+      if (size > 0) {
+         mData.resize(static_cast<size_t>(size));
+         if (fread(mData.data(), 1, mData.size(), file) != mData.size()) {
+            mData.clear();
+         }
+      }
+
+      fclose(file);
+   }
+
+   auto header = FileHeader { };
+   if (mData.size() >= sizeof(FileHeader)) {
+      std::memcpy(&header, mData.data(), sizeof(FileHeader));
+   }
+
+   if (header.magic != Magic || header.revision != revision) {
+      if (!mData.empty()) {
+         gLog->info("Discarding shader cache file {} from a different shader translator", path);
+      }
+
+      mData.clear();
+   }
+
+   // Later records replace earlier ones for the same shader.
+   auto offset = sizeof(FileHeader);
+   auto numCorrupt = 0u;
+   while (offset + sizeof(RecordHeader) <= mData.size()) {
+      auto record = RecordHeader { };
+      std::memcpy(&record, mData.data() + offset, sizeof(RecordHeader));
+
+      auto dataOffset = offset + sizeof(RecordHeader);
+      if (record.size > mData.size() - dataOffset) {
+         break;
+      }
+
+      if (checksumRecord(mData.data() + dataOffset, record.size) != record.checksum) {
+         numCorrupt++;
+      } else {
+         mRecords[record.key] = Record { record.type, dataOffset, record.size };
+      }
+
+      offset = dataOffset + record.size;
+   }
+
+   if (numCorrupt) {
+      gLog->warn("Skipped {} corrupt shaders in shader cache file {}", numCorrupt, path);
+   }
+
+   // Anything left over is a record which was still being written when we
+   // last exited, it must be cut off before we append anything new.
+   auto truncate = !mData.empty() && offset < mData.size();
+   if (truncate) {
+      gLog->warn("Removing partially written shader from shader cache file {}", path);
+      mData.resize(offset);
+   }
+
+   mFile = fopen(path.c_str(), (mData.empty() || truncate) ? "wb" : "ab");
+   if (!mFile) {
+      gLog->warn("Could not open shader cache file {}", path);
+      close();
+      return false;
+   }
+
+   if (mData.empty()) {
+      header.magic = Magic;
+      header.padding = 0;
+      header.revision = revision;
+      fwrite(&header, sizeof(FileHeader), 1, mFile);
+   } else {
+      if (truncate) {
+         fwrite(mData.data(), 1, mData.size(), mFile);
+      }
+
+      gLog->info("Loaded {} shaders from {}", mRecords.size(), path);
+   }
+
+   fflush(mFile);
+   return true;
+}
+
+
+/**
+ * Close the cache file and forget all loaded shaders.
+ */
+void
+ShaderCacheFile::close()
+{
+   if (mFile) {
+      fclose(mFile);
+      mFile = nullptr;
+   }
+
+   mData.clear();
+   mRecords.clear();
+}
+
+
+/**
+ * Find the serialised shader stored for key, returns nullptr if there is no
+ * shader of the given type stored for it.
+ */
+const uint8_t *
+ShaderCacheFile::lookup(uint32_t type,
+                        uint64_t key,
+                        uint32_t &size) const
+{
+   auto itr = mRecords.find(key);
+   if (itr == mRecords.end() || itr->second.type != type) {
+      return nullptr;
+   }
+
+   size = itr->second.size;
+   return mData.data() + itr->second.offset;
+}
+
+void
+ShaderCacheFile::store(uint32_t type,
+                       uint64_t key,
+                       const std::vector<uint8_t> &data)
+{
+   if (!mFile) {
+      return;
+   }
+
+   auto record = RecordHeader { };
+   record.key = key;
+   record.type = type;
+   record.size = static_cast<uint32_t>(data.size());
+   record.checksum = checksumRecord(data.data(), data.size());
+
+   fwrite(&record, sizeof(RecordHeader), 1, mFile);
+   fwrite(data.data(), 1, data.size(), mFile);
+   fflush(mFile);
+}
+
+} // namespace gpu
@@ -1,7 +1,12 @@
 #include "null_driver.h"
+#include "gpu_clock.h"
 #include "gpu_event.h"
+#include "gpu_ih.h"
+#include "gpu_memory.h"
 #include "gpu_ringbuffer.h"
 
+#include "latte/latte_endian.h"
+
 #include <common/decaf_assert.h>
 
 namespace null
@@ -29,8 +34,7 @@ Driver::run()
 
    while (mRunning) {
       if (gpu::ringbuffer::wait()) {
-         auto items = gpu::ringbuffer::read();
-         // TODO: We need to actually process pm4 to do EVENT_WRITE_EOP for retired timestamps
+         executeBuffers();
       }
    }
 }
@@ -38,7 +42,18 @@ Driver::run()
 void
 Driver::runUntilFlip()
 {
-   decaf_abort("NullDriver::runUntilFlip unimplemented");
+   auto startingFlips = mNumFlips;
+   mRunning = true;
+
+   while (mRunning) {
+      if (gpu::ringbuffer::wait()) {
+         executeBuffers();
+      }
+
+      if (mNumFlips > startingFlips) {
+         break;
+      }
+   }
 }
 
 void
@@ -48,6 +63,26 @@ Driver::stop()
    gpu::ringbuffer::wake();
 }
 
+/**
+ * Execute all the command buffers which are currently in the ring.
+ *
+ * As we never render anything every packet completes immediately, so there
+ * is no need to defer the memory writes or interrupts like the Vulkan driver.
+ */
+void
+Driver::executeBuffers()
+{
+   for (auto i = gpu::ringbuffer::depth(); i > 0; --i) {
+      auto buffer = gpu::ringbuffer::read();
+      if (buffer.empty()) {
+         break;
+      }
+
+      runCommandBuffer(buffer);
+      gpu::ringbuffer::release();
+   }
+}
+
 gpu::GraphicsDriverType
 Driver::type()
 {
@@ -57,7 +92,7 @@ Driver::type()
 gpu::GraphicsDriverDebugInfo *
 Driver::getDebugInfo()
 {
-   return nullptr;
+   return &mDebugInfo;
 }
 
 void
@@ -72,4 +107,210 @@ Driver::notifyGpuFlush(phys_addr address,
 {
 }
 
+void
+Driver::decafSetBuffer(const latte::pm4::DecafSetBuffer &data)
+{
+}
+
+void
+Driver::decafCopyColorToScan(const latte::pm4::DecafCopyColorToScan &data)
+{
+}
+
+void
+Driver::decafSwapBuffers(const latte::pm4::DecafSwapBuffers &data)
+{
+   static const auto weight = 0.9;
+
+   // Send out the flip event
+   gpu::onFlip();
+   ++mNumFlips;
+
+   // Update our frametime and last swap times
+   auto now = std::chrono::system_clock::now();
+
+   if (mLastSwap.time_since_epoch().count()) {
+      mAverageFrameTime = weight * mAverageFrameTime + (1.0 - weight) * (now - mLastSwap);
+   }
+
+   mLastSwap = now;
+
+   auto averageFrameTime = std::chrono::duration_cast<duration_ms>(mAverageFrameTime).count();
+   mDebugInfo.averageFrameTimeMS = averageFrameTime;
+
+   if (averageFrameTime > 0.0) {
+      mDebugInfo.averageFps = 1000.0 / averageFrameTime;
+   } else {
+      mDebugInfo.averageFps = 0.0;
+   }
+}
+
+void
+Driver::decafClearColor(const latte::pm4::DecafClearColor &data)
+{
+}
+
+void
+Driver::decafClearDepthStencil(const latte::pm4::DecafClearDepthStencil &data)
+{
+}
+
+void
+Driver::decafOSScreenFlip(const latte::pm4::DecafOSScreenFlip &data)
+{
+}
+
+void
+Driver::decafCopySurface(const latte::pm4::DecafCopySurface &data)
+{
+}
+
+void
+Driver::decafExpandColorBuffer(const latte::pm4::DecafExpandColorBuffer &data)
+{
+}
+
+void
+Driver::drawIndexAuto(const latte::pm4::DrawIndexAuto &data)
+{
+}
+
+void
+Driver::drawIndex2(const latte::pm4::DrawIndex2 &data)
+{
+}
+
+void
+Driver::drawIndexImmd(const latte::pm4::DrawIndexImmd &data)
+{
+}
+
+void
+Driver::memWrite(const latte::pm4::MemWrite &data)
+{
+   auto addr = phys_addr { data.addrLo.ADDR_LO() << 2 };
+   auto ptr = gpu::internal::translateAddress(addr);
+   auto value = uint64_t { 0 };
+
+   // Read value
+   if (data.addrHi.CNTR_SEL() == latte::pm4::MW_WRITE_CLOCK) {
+      value = gpu::clock::now();
+   } else if (data.addrHi.DATA32()) {
+      value = static_cast<uint64_t>(data.dataLo);
+   } else {
+      value = static_cast<uint64_t>(data.dataLo) |
+              (static_cast<uint64_t>(data.dataHi) << 32);
+   }
+
+   // Swap value
+   value = latte::applyEndianSwap(value, data.addrLo.ENDIAN_SWAP());
+
+   // Write value
+   if (data.addrHi.DATA32()) {
+      *reinterpret_cast<uint32_t *>(ptr) = static_cast<uint32_t>(value);
+   } else {
+      *reinterpret_cast<uint64_t *>(ptr) = value;
+   }
+}
+
+void
+Driver::eventWrite(const latte::pm4::EventWrite &data)
+{
+   if (data.eventInitiator.EVENT_TYPE() == latte::VGT_EVENT_TYPE::ZPASS_DONE) {
+      // Nothing is ever drawn so no samples can pass, writing zero to both the
+      // begin and end counts of an occlusion query gives a result of zero.
+      auto addr = phys_addr { data.addrLo.ADDR_LO() << 2 };
+      *reinterpret_cast<uint64_t *>(gpu::internal::translateAddress(addr)) = 0;
+   }
+}
+
+void
+Driver::eventWriteEOP(const latte::pm4::EventWriteEOP &data)
+{
+   // Write event data to memory if required
+   if (data.addrHi.DATA_SEL() != latte::pm4::EWP_DATA_DISCARD) {
+      auto addr = phys_addr { data.addrLo.ADDR_LO() << 2 };
+      auto ptr = gpu::internal::translateAddress(addr);
+      decaf_assert(data.addrHi.ADDR_HI() == 0, "Invalid event write address (high word not zero)");
+
+      // Read value
+      auto value = uint64_t { 0u };
+      switch (data.addrHi.DATA_SEL()) {
+      case latte::pm4::EWP_DATA_32:
+         value = data.dataLo;
+         break;
+      case latte::pm4::EWP_DATA_64:
+         value = static_cast<uint64_t>(data.dataLo) |
+                 (static_cast<uint64_t>(data.dataHi) << 32);
+         break;
+      case latte::pm4::EWP_DATA_CLOCK:
+         value = gpu::clock::now();
+         break;
+      }
+
+      // Swap value
+      value = latte::applyEndianSwap(value, data.addrLo.ENDIAN_SWAP());
+
+      // Write value
+      switch (data.addrHi.DATA_SEL()) {
+      case latte::pm4::EWP_DATA_32:
+         *reinterpret_cast<uint32_t *>(ptr) = static_cast<uint32_t>(value);
+         break;
+      case latte::pm4::EWP_DATA_64:
+      case latte::pm4::EWP_DATA_CLOCK:
+         *reinterpret_cast<uint64_t *>(ptr) = value;
+         break;
+      }
+   }
+
+   // Generate interrupt if required
+   if (data.addrHi.INT_SEL() != latte::pm4::EWP_INT_NONE) {
+      auto interrupt = gpu::ih::Entry { };
+      interrupt.word0 = latte::CP_INT_SRC_ID::CP_EOP_EVENT;
+      gpu::ih::write(interrupt);
+   }
+}
+
+void
+Driver::pfpSyncMe(const latte::pm4::PfpSyncMe &data)
+{
+}
+
+void
+Driver::setPredication(const latte::pm4::SetPredication &data)
+{
+}
+
+void
+Driver::streamOutBaseUpdate(const latte::pm4::StreamOutBaseUpdate &data)
+{
+}
+
+void
+Driver::streamOutBufferUpdate(const latte::pm4::StreamOutBufferUpdate &data)
+{
+   auto bufferIdx = data.control.SELECT_BUFFER();
+
+   // Nothing is ever streamed out, so the filled size is whatever offset the
+   // buffer was last given.
+   if (data.control.STORE_BUFFER_FILLED_SIZE()) {
+      decaf_check(data.dstLo);
+      auto dstPtr = gpu::internal::translateAddress(phys_addr { data.dstLo });
+      *reinterpret_cast<uint32_t *>(dstPtr) = mStreamOutOffset[bufferIdx];
+   }
+
+   if (data.control.OFFSET_SOURCE() == latte::pm4::STRMOUT_OFFSET_FROM_MEM) {
+      auto srcPtr = phys_cast<uint32_t *>(data.srcLo);
+      decaf_check(srcPtr);
+      mStreamOutOffset[bufferIdx] = *srcPtr;
+   } else if (data.control.OFFSET_SOURCE() == latte::pm4::STRMOUT_OFFSET_FROM_PACKET) {
+      mStreamOutOffset[bufferIdx] = static_cast<uint32_t>(data.srcLo);
+   }
+}
+
+void
+Driver::surfaceSync(const latte::pm4::SurfaceSync &data)
+{
+}
+
 } // namespace null
@@ -1,10 +1,27 @@
 #pragma once
 #include "gpu_graphicsdriver.h"
+#include "pm4_processor.h"
+#include "latte/latte_constants.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
 
 namespace null
 {
 
-class Driver : public gpu::GraphicsDriver
+/**
+ * Null Driver Responsibilities:
+ *
+ * 1. Execute every PM4 packet submitted to the ring buffer, so register state,
+ *    timestamps, memory writes, interrupts and flips all behave as they would
+ *    with a real driver.
+ * 2. Do not render anything, draws and clears are discarded.
+ *
+ * This allows headless runs (e.g. decaf-cli) to measure the throughput of
+ * the rest of the emulator without being blocked on the GPU.
+ */
+class Driver : public gpu::GraphicsDriver, public Pm4Processor
 {
 public:
    virtual ~Driver() = default;
@@ -24,7 +41,43 @@ public:
    virtual void notifyGpuFlush(phys_addr address, uint32_t size) override;
 
 private:
+   void executeBuffers();
+
+   // Pm4Processor
+   virtual void decafSetBuffer(const latte::pm4::DecafSetBuffer &data) override;
+   virtual void decafCopyColorToScan(const latte::pm4::DecafCopyColorToScan &data) override;
+   virtual void decafSwapBuffers(const latte::pm4::DecafSwapBuffers &data) override;
+   virtual void decafClearColor(const latte::pm4::DecafClearColor &data) override;
+   virtual void decafClearDepthStencil(const latte::pm4::DecafClearDepthStencil &data) override;
+   virtual void decafOSScreenFlip(const latte::pm4::DecafOSScreenFlip &data) override;
+   virtual void decafCopySurface(const latte::pm4::DecafCopySurface &data) override;
+   virtual void decafExpandColorBuffer(const latte::pm4::DecafExpandColorBuffer &data) override;
+   virtual void drawIndexAuto(const latte::pm4::DrawIndexAuto &data) override;
+   virtual void drawIndex2(const latte::pm4::DrawIndex2 &data) override;
+   virtual void drawIndexImmd(const latte::pm4::DrawIndexImmd &data) override;
+   virtual void memWrite(const latte::pm4::MemWrite &data) override;
+   virtual void eventWrite(const latte::pm4::EventWrite &data) override;
+   virtual void eventWriteEOP(const latte::pm4::EventWriteEOP &data) override;
+   virtual void pfpSyncMe(const latte::pm4::PfpSyncMe &data) override;
+   virtual void setPredication(const latte::pm4::SetPredication &data) override;
+   virtual void streamOutBaseUpdate(const latte::pm4::StreamOutBaseUpdate &data) override;
+   virtual void streamOutBufferUpdate(const latte::pm4::StreamOutBufferUpdate &data) override;
+   virtual void surfaceSync(const latte::pm4::SurfaceSync &data) override;
+
+private:
+   using duration_system_clock = std::chrono::duration<double, std::chrono::system_clock::period>;
+   using duration_ms = std::chrono::duration<double, std::chrono::milliseconds::period>;
+
    bool mRunning = false;
+   uint64_t mNumFlips = 0;
+
+   //! Stream out buffer offsets, nothing is ever written so these only
+   //! change when the guest sets them.
+   std::array<uint32_t, latte::MaxStreamOutBuffers> mStreamOutOffset = { 0 };
+
+   std::chrono::time_point<std::chrono::system_clock> mLastSwap;
+   duration_system_clock mAverageFrameTime { 0 };
+   gpu::GraphicsDriverDebugInfo mDebugInfo;
 };
 
 } // namespace null
@@ -4,38 +4,145 @@
 
 #include <common/byte_swap_array.h>
 #include <common/log.h>
+#include <libcpu/memtrack.h>
 #include <libcpu/mmu.h>
 
 void
 Pm4Processor::indirectBufferCall(const IndirectBufferCall &data)
 {
-   auto buffer = gpu::internal::translateAddress<uint32_t>(data.addr);
-   runCommandBuffer({ buffer, data.size });
+   runIndirectBuffer(data.addr, data.size);
 }
 
 void
 Pm4Processor::indirectBufferCallPriv(const IndirectBufferCallPriv &data)
 {
-   auto buffer = gpu::internal::translateAddress<uint32_t>(data.addr);
-   runCommandBuffer({ buffer, data.size });
+   runIndirectBuffer(data.addr, data.size);
 }
 
 void
 Pm4Processor::runCommandBuffer(const gpu::ringbuffer::Buffer &buffer)
 {
    decaf_check(mSwapScratchDepth + 1 < MaxPm4IndirectDepth);
-   auto& scratchBuffer = mSwapScratch[mSwapScratchDepth++];
+   auto& scratchBuffer = mSwapScratch[mSwapScratchDepth];
+   auto& packets = mPacketScratch[mSwapScratchDepth];
+   mSwapScratchDepth++;
 
-   auto numDwords = buffer.size();
+   auto numDwords = static_cast<uint32_t>(buffer.size());
    auto swappedBytes = byte_swap_to_scratch<uint32_t>(
       buffer.data(), static_cast<uint32_t>(buffer.size_bytes()), scratchBuffer);
    auto swapped = reinterpret_cast<uint32_t*>(swappedBytes);
 
+   decodePackets(swapped, numDwords, packets);
+   runPackets(swapped, packets);
+
+   mSwapScratchDepth--;
+}
+
+
+/**
+ * Run an indirect buffer, going through the display list cache when it was
+ * called from within another indirect buffer.
+ *
+ * The top level indirect buffers are the command buffers GX2 submits from its
+ * pool, which are rewritten every frame so there is no point caching them.
+ * The nested ones are display lists replayed with GX2CallDisplayList, which
+ * are usually static, so we keep them byte swapped and split into packets for
+ * as long as their memory is unchanged.
+ */
+void
+Pm4Processor::runIndirectBuffer(phys_addr address,
+                                uint32_t numDwords)
+{
+   if (mSwapScratchDepth < 2 || numDwords == 0) {
+      auto buffer = gpu::internal::translateAddress<uint32_t>(address);
+      runCommandBuffer({ buffer, numDwords });
+      return;
+   }
+
+   auto key = (static_cast<uint64_t>(address.getAddress()) << 32) | numDwords;
+   auto &displayList = mDisplayListCache[key];
+
+   if (displayList.inUse) {
+      // A display list calling itself, we cannot rebuild it whilst running it
+      auto buffer = gpu::internal::translateAddress<uint32_t>(address);
+      runCommandBuffer({ buffer, numDwords });
+      return;
+   }
+
+   // Read the memory state before the memory itself, so a write landing in
+   // between makes us decode it again next time rather than go unnoticed.
+   auto state = cpu::getMemoryState(address, numDwords * 4);
+
+   if (displayList.data && displayList.state == state) {
+      mDisplayListCacheHits++;
+   } else {
+      mDisplayListCacheMisses++;
+      mDisplayListCacheBytes -= displayList.scratch.size();
+
+      auto buffer = gpu::internal::translateAddress<uint32_t>(address);
+      displayList.state = state;
+      displayList.data = reinterpret_cast<uint32_t *>(
+         byte_swap_to_scratch<uint32_t>(buffer, numDwords * 4, displayList.scratch));
+      decodePackets(displayList.data, numDwords, displayList.packets);
+
+      mDisplayListCacheBytes += displayList.scratch.size();
+   }
+
+   decaf_check(mSwapScratchDepth + 1 < MaxPm4IndirectDepth);
+   mSwapScratchDepth++;
+   displayList.lastUsed = ++mDisplayListCacheUseCounter;
+   displayList.inUse = true;
+
+   trimDisplayListCache();
+   runPackets(displayList.data, displayList.packets);
+
+   displayList.inUse = false;
+   mSwapScratchDepth--;
+}
+
+
+/**
+ * Evict the least recently used display lists until we are back under
+ * budget, skipping any which are currently running.
+ */
+void
+Pm4Processor::trimDisplayListCache()
+{
+   while (mDisplayListCacheBytes > MaxPm4DisplayListCacheBytes) {
+      auto oldest = mDisplayListCache.end();
+
+      for (auto itr = mDisplayListCache.begin(); itr != mDisplayListCache.end(); ++itr) {
+         if (!itr->second.inUse &&
+             (oldest == mDisplayListCache.end() || itr->second.lastUsed < oldest->second.lastUsed)) {
+            oldest = itr;
+         }
+      }
+
+      if (oldest == mDisplayListCache.end()) {
+         break;
+      }
+
+      mDisplayListCacheBytes -= oldest->second.scratch.size();
+      mDisplayListCache.erase(oldest);
+   }
+}
+
+
+/**
+ * Split a byte swapped command buffer into its packets.
+ */
+void
+Pm4Processor::decodePackets(uint32_t *data,
+                            uint32_t numDwords,
+                            std::vector<Pm4Packet> &packets)
+{
+   packets.clear();
+
    for (auto pos = 0u; pos < numDwords; ) {
-      auto header = *reinterpret_cast<Header *>(&swapped[pos]);
+      auto header = *reinterpret_cast<Header *>(&data[pos]);
       auto size = 0u;
 
-      if (swapped[pos] == 0) {
+      if (data[pos] == 0) {
          break;
       }
 
@@ -46,7 +153,7 @@ Pm4Processor::runCommandBuffer(const gpu::ringbuffer::Buffer &buffer)
          size = header3.size() + 1;
 
          decaf_check(pos + size <= numDwords);
-         handlePacketType3(header3, gsl::make_span(&swapped[pos + 1], size));
+         packets.push_back({ PacketType::Type3, header.value, pos + 1, size });
          break;
       }
       case PacketType::Type0:
@@ -55,7 +162,7 @@ Pm4Processor::runCommandBuffer(const gpu::ringbuffer::Buffer &buffer)
          size = header0.count() + 1;
 
          decaf_check(pos + size <= numDwords);
-         handlePacketType0(header0, gsl::make_span(&swapped[pos + 1], size));
+         packets.push_back({ PacketType::Type0, header.value, pos + 1, size });
          break;
       }
       case PacketType::Type2:
@@ -67,14 +174,27 @@ Pm4Processor::runCommandBuffer(const gpu::ringbuffer::Buffer &buffer)
       default:
          gLog->error("Invalid packet header type {}, header = 0x{:08X}",
                      header.type(), header.value);
-         pos = static_cast<uint32_t>(numDwords);
+         pos = numDwords;
          break;
       }
 
       pos += size + 1;
    }
+}
 
-   mSwapScratchDepth--;
+void
+Pm4Processor::runPackets(uint32_t *data,
+                         const std::vector<Pm4Packet> &packets)
+{
+   for (auto &packet : packets) {
+      auto span = gsl::make_span(&data[packet.offset], packet.size);
+
+      if (packet.type == PacketType::Type3) {
+         handlePacketType3(HeaderType3::get(packet.header), span);
+      } else {
+         handlePacketType0(HeaderType0::get(packet.header), span);
+      }
+   }
 }
 
 void
@@ -246,14 +366,16 @@ void Pm4Processor::nopPacket(const Nop &data)
 void
 Pm4Processor::indexType(const IndexType &data)
 {
-   mRegisters[latte::Register::VGT_INDEX_TYPE / 4] = data.type.value;
-   mRegisters[latte::Register::VGT_DMA_INDEX_TYPE / 4] = data.type.value;
+   auto value = data.type.value;
+   setRegisters(latte::Register::VGT_INDEX_TYPE, gsl::make_span(&value, 1));
+   setRegisters(latte::Register::VGT_DMA_INDEX_TYPE, gsl::make_span(&value, 1));
 }
 
 void
 Pm4Processor::numInstances(const NumInstances &data)
 {
-   mRegisters[latte::Register::VGT_DMA_NUM_INSTANCES / 4] = data.count;
+   auto value = static_cast<uint32_t>(data.count);
+   setRegisters(latte::Register::VGT_DMA_NUM_INSTANCES, gsl::make_span(&value, 1));
 }
 
 void Pm4Processor::contextControl(const ContextControl &data)
@@ -289,12 +411,28 @@ Pm4Processor::setRegisters(latte::Register base,
       auto clearFlags = values[valueIdx];
       for (auto i = 0u; i < 32; ++i) {
          if (clearFlags & (1 << i)) {
+            if (mRegisters[clearRegBase + i] != 0xffffffff) {
+               mDirtyRegisterGroups |= mRegisterGroups[clearRegBase + i];
+            }
+
             mRegisters[clearRegBase + i] = 0xffffffff;
          }
       }
    }
 
-   memcpy(&mRegisters[base / 4], values.data(), values.size_bytes());
+   // Only registers whose value actually changes dirty their groups, as
+   // games tend to rewrite most of their state before every draw
+   auto first = base / 4;
+   auto dirty = uint8_t { 0 };
+
+   for (auto i = 0u; i < values.size(); ++i) {
+      if (mRegisters[first + i] != values[i]) {
+         dirty |= mRegisterGroups[first + i];
+      }
+   }
+
+   mDirtyRegisterGroups |= dirty;
+   memcpy(&mRegisters[first], values.data(), values.size_bytes());
 }
 
 void Pm4Processor::setAluConsts(const SetAluConsts &data)
@@ -4,13 +4,38 @@
 
 #include <array>
 #include <common/byte_swap_array.h>
+#include <libcpu/memtrack.h>
 #include <libcpu/pointer.h>
+#include <unordered_map>
 #include <vector>
 
 using namespace latte::pm4;
 
 constexpr int MaxPm4IndirectDepth = 6;
 
+//! Upper limit on the size of the byte swapped display lists we keep around
+constexpr size_t MaxPm4DisplayListCacheBytes = 32 * 1024 * 1024;
+
+//! A packet which has already been split out of a command buffer, offset and
+//! size are the position of its data in the byte swapped buffer in dwords.
+struct Pm4Packet
+{
+   PacketType type;
+   uint32_t header;
+   uint32_t offset;
+   uint32_t size;
+};
+
+struct Pm4DisplayList
+{
+   cpu::MemtrackState state;
+   std::vector<uint8_t> scratch;
+   uint32_t *data = nullptr;
+   std::vector<Pm4Packet> packets;
+   uint64_t lastUsed = 0;
+   bool inUse = false;
+};
+
 class Pm4Processor
 {
 protected:
@@ -71,6 +96,10 @@ protected:
                       const gsl::span<std::pair<uint32_t, uint32_t>> &registers);
 
    void runCommandBuffer(const gpu::ringbuffer::Buffer &buffer);
+   void runIndirectBuffer(phys_addr address, uint32_t numDwords);
+   void decodePackets(uint32_t *data, uint32_t numDwords, std::vector<Pm4Packet> &packets);
+   void runPackets(uint32_t *data, const std::vector<Pm4Packet> &packets);
+   void trimDisplayListCache();
 
    uint32_t *byteSwapRegValues(uint32_t *values, size_t numValues)
    {
@@ -87,6 +116,26 @@ protected:
       return *reinterpret_cast<Type *>(&mRegisters[id / 4]);
    }
 
+   //! Add count registers, stride bytes apart starting at id, to the given
+   //! register groups. Any write which changes the value of one of these
+   //! registers marks its groups as dirty.
+   void addRegisterGroup(uint8_t groups, uint32_t id, uint32_t count = 1, uint32_t stride = 4)
+   {
+      for (auto i = 0u; i < count; ++i) {
+         mRegisterGroups[(id + i * stride) / 4] |= groups;
+      }
+   }
+
+   bool isRegisterGroupDirty(uint8_t groups) const
+   {
+      return !!(mDirtyRegisterGroups & groups);
+   }
+
+   void clearRegisterGroupDirty(uint8_t groups)
+   {
+      mDirtyRegisterGroups &= ~groups;
+   }
+
    phys_addr getRegisterAddr(uint32_t id)
    {
       if (id == latte::Register::VGT_STRMOUT_DRAW_OPAQUE_BUFFER_FILLED_SIZE) {
@@ -97,9 +146,18 @@ protected:
 
    latte::ShadowState mShadowState;
    std::array<uint32_t, 0x10000> mRegisters = { 0 };
+   std::array<uint8_t, 0x10000> mRegisterGroups = { 0 };
+   uint8_t mDirtyRegisterGroups = 0xFF;
    phys_addr mRegAddr_VGT_STRMOUT_DRAW_OPAQUE_BUFFER_FILLED_SIZE = phys_addr { 0 };
 
    std::vector<uint8_t> mRegisterScratch;
    std::array<std::vector<uint8_t>, MaxPm4IndirectDepth> mSwapScratch;
+   std::array<std::vector<Pm4Packet>, MaxPm4IndirectDepth> mPacketScratch;
    uint32_t mSwapScratchDepth = 0;
+
+   std::unordered_map<uint64_t, Pm4DisplayList> mDisplayListCache;
+   size_t mDisplayListCacheBytes = 0;
+   uint64_t mDisplayListCacheUseCounter = 0;
+   uint64_t mDisplayListCacheHits = 0;
+   uint64_t mDisplayListCacheMisses = 0;
 };
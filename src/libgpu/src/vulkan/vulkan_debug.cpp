@@ -39,6 +39,10 @@ Driver::updateDebuggerInfo()
    mDebugInfo.numSamplers = mSamplers.size();
    mDebugInfo.numSurfaces = mSurfaceGroups.size();
    mDebugInfo.numDataBuffers = mMemCaches.size();
+   mDebugInfo.numIndexBuffers = mIndexBuffers.size();
+   mDebugInfo.numDisplayLists = mDisplayListCache.size();
+   mDebugInfo.displayListCacheHits = mDisplayListCacheHits;
+   mDebugInfo.displayListCacheMisses = mDisplayListCacheMisses;
 }
 
 void
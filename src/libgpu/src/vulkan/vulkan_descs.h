@@ -369,6 +369,20 @@ struct PipelineDesc
    }
 };
 
+struct IndexBufferDesc
+{
+   phys_addr address;
+   uint32_t numIndices;
+   latte::VGT_INDEX_TYPE indexType;
+   latte::VGT_DMA_SWAP swapMode;
+   latte::VGT_DI_PRIMITIVE_TYPE primitiveType;
+
+   inline DataHash hash() const
+   {
+      return DataHash {}.write(*this);
+   }
+};
+
 struct StreamOutBufferDesc
 {
    phys_addr baseAddress;
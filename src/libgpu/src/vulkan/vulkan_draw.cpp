@@ -264,7 +264,7 @@ Driver::bindShaderParams()
 }
 
 void
-Driver::drawGenericIndexed(latte::VGT_DRAW_INITIATOR drawInit, uint32_t numIndices, void *indices)
+Driver::drawGenericIndexed(latte::VGT_DRAW_INITIATOR drawInit, uint32_t numIndices, void *indices, phys_addr indicesAddress)
 {
    // First lets set up our draw description for everyone
    auto pa_su_point_size = getRegister<latte::PA_SU_POINT_SIZE>(latte::Register::PA_SU_POINT_SIZE);
@@ -286,6 +286,7 @@ Driver::drawGenericIndexed(latte::VGT_DRAW_INITIATOR drawInit, uint32_t numIndic
 
    DrawDesc& drawDesc = mDrawCache;
    drawDesc.indices = indices;
+   drawDesc.indicesAddress = indicesAddress;
    drawDesc.indexType = vgt_index_type.INDEX_TYPE();
    drawDesc.indexSwapMode = latte::VGT_DMA_SWAP::NONE;
    drawDesc.primitiveType = vgt_primitive_type.PRIM_TYPE();
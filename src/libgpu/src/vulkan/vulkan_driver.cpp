@@ -6,6 +6,12 @@
 #include "gpu_graphicsdriver.h"
 #include "gpu_ringbuffer.h"
 
+#include <common/log.h>
+#include <common/platform_dir.h>
+#include <cstdio>
+#include <cstring>
+#include <fmt/core.h>
+
 namespace vulkan
 {
 
@@ -49,6 +55,8 @@ Driver::initialise(vk::Instance instance,
                mDebug = settings.debug.debug_enabled;
                mDumpShaders = settings.debug.dump_shaders;
                mDumpShaderBinariesOnly = settings.debug.dump_shader_binaries_only;
+               mLogSkippedDraws = settings.debug.log_skipped_draws;
+               mPipelineCompileWait = std::chrono::milliseconds { settings.pipeline.compile_wait_ms };
             });
       });
 
@@ -57,6 +65,8 @@ Driver::initialise(vk::Instance instance,
    mDebug = gpuConfig->debug.debug_enabled;
    mDumpShaders = gpuConfig->debug.dump_shaders;
    mDumpShaderBinariesOnly = gpuConfig->debug.dump_shader_binaries_only;
+   mLogSkippedDraws = gpuConfig->debug.log_skipped_draws;
+   mPipelineCompileWait = std::chrono::milliseconds { gpuConfig->pipeline.compile_wait_ms };
 
    mPhysDevice = physDevice;
    mDevice = device;
@@ -82,6 +92,10 @@ Driver::initialise(vk::Instance instance,
    // Start our fence thread
    mFenceThread = std::thread { std::bind(&Driver::fenceWaiterThread, this) };
 
+   // Start the pipeline compile threads, the number of threads is only read
+   // here so changing it requires a restart
+   startPipelineCompileThreads(gpuConfig->pipeline.compile_threads);
+
    // Set up the VMA
    auto allocatorCreateInfo = VmaAllocatorCreateInfo { };
    allocatorCreateInfo.physicalDevice = mPhysDevice;
@@ -95,16 +109,13 @@ Driver::initialise(vk::Instance instance,
    mBaseDescriptorSetLayout = basePl->descriptorLayout;
    mPipelineLayout = basePl->pipelineLayout;
 
-   // Set up the pipeline cache
-   auto pipelineCacheCreateInfo = vk::PipelineCacheCreateInfo { };
-   pipelineCacheCreateInfo.flags = vk::PipelineCacheCreateFlags { };
-   pipelineCacheCreateInfo.pInitialData = nullptr;
-   pipelineCacheCreateInfo.initialDataSize = 0;
-   mPipelineCache = mDevice.createPipelineCache(pipelineCacheCreateInfo);
+   // Set up the pipeline and shader caches
+   openPersistentCaches(gpu::getActiveTitleId());
 
    initialiseBlankSampler();
    initialiseBlankImage();
    initialiseBlankBuffer();
+   initialiseRegisterGroups();
 
    setupResources();
 }
@@ -115,9 +126,137 @@ Driver::destroy()
    mFenceSignal.notify_all();
    mFenceThread.join();
 
+   stopPipelineCompileThreads();
+   savePipelineCache();
+   mShaderCache.close();
+
    destroyDisplayPipeline();
 }
 
+
+/**
+ * Switch the on disk shader and pipeline caches to those of a new title.
+ *
+ * Each title gets its own directory so the caches only ever contain the
+ * shaders which that title uses.
+ */
+void
+Driver::openPersistentCaches(uint64_t titleId)
+{
+   waitForPipelineCompiles();
+   savePipelineCache();
+   mShaderCache.close();
+   mPipelineCachePath.clear();
+   mCacheTitleId = titleId;
+
+   // Start every title with a fresh pipeline cache
+   auto initialData = std::vector<uint8_t> { };
+   auto directory = gpu::config()->cache.directory;
+   auto titleDirectory = fmt::format("{}/{:016X}", directory, titleId);
+
+   if (directory.empty() || !titleId) {
+      // Caching is disabled
+   } else if (!platform::createDirectory(titleDirectory)) {
+      gLog->warn("Could not create GPU cache directory {}", titleDirectory);
+   } else {
+      mShaderCache.open(fmt::format("{}/shaders.bin", titleDirectory));
+
+      // Pipeline caches are only valid for the device and driver which
+      // created them, so check the header matches ours before using it.
+      auto properties = mPhysDevice.getProperties();
+      mPipelineCachePath = fmt::format("{}/pipelines-{:04X}-{:04X}.bin", titleDirectory,
+                                       properties.vendorID, properties.deviceID);
+
+      if (auto file = fopen(mPipelineCachePath.c_str(), "rb")) {
+         fseek(file, 0, SEEK_END);
+         auto size = ftell(file);
+         fseek(file, 0, SEEK_SET);
+
+         if (size > 0) {
+            initialData.resize(static_cast<size_t>(size));
+            if (fread(initialData.data(), 1, initialData.size(), file) != initialData.size()) {
+               initialData.clear();
+            }
+         }
+
+         fclose(file);
+      }
+
+      struct PipelineCacheHeader
+      {
+         uint32_t headerSize;
+         uint32_t headerVersion;
+         uint32_t vendorID;
+         uint32_t deviceID;
+         uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+      } header;
+
+      if (initialData.size() >= sizeof(PipelineCacheHeader)) {
+         std::memcpy(&header, initialData.data(), sizeof(PipelineCacheHeader));
+
+         if (header.headerSize < sizeof(PipelineCacheHeader) ||
+             header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+             header.vendorID != properties.vendorID ||
+             header.deviceID != properties.deviceID ||
+             std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+            gLog->info("Ignoring pipeline cache {} from a different driver", mPipelineCachePath);
+            initialData.clear();
+         } else {
+            gLog->info("Loaded {} bytes of pipeline cache from {}", initialData.size(), mPipelineCachePath);
+         }
+      } else {
+         initialData.clear();
+      }
+   }
+
+   if (mPipelineCache) {
+      mDevice.destroyPipelineCache(mPipelineCache);
+   }
+
+   auto pipelineCacheCreateInfo = vk::PipelineCacheCreateInfo { };
+   pipelineCacheCreateInfo.flags = vk::PipelineCacheCreateFlags { };
+   pipelineCacheCreateInfo.pInitialData = initialData.data();
+   pipelineCacheCreateInfo.initialDataSize = initialData.size();
+   mPipelineCache = mDevice.createPipelineCache(pipelineCacheCreateInfo);
+}
+
+
+/**
+ * Write the pipeline cache of the current title to disk.
+ *
+ * We write to a temporary file first so a crash part way through does not
+ * leave a corrupt cache behind.
+ */
+void
+Driver::savePipelineCache()
+{
+   if (mPipelineCachePath.empty() || !mPipelineCache) {
+      return;
+   }
+
+   auto data = mDevice.getPipelineCacheData(mPipelineCache);
+   auto tmpPath = mPipelineCachePath + ".tmp";
+   auto file = fopen(tmpPath.c_str(), "wb");
+   if (!file) {
+      gLog->warn("Could not open pipeline cache file {}", tmpPath);
+      return;
+   }
+
+   auto written = fwrite(data.data(), 1, data.size(), file);
+   fclose(file);
+
+   if (written != data.size()) {
+      gLog->warn("Could not write pipeline cache file {}", tmpPath);
+      std::remove(tmpPath.c_str());
+      return;
+   }
+
+   std::remove(mPipelineCachePath.c_str());
+   if (std::rename(tmpPath.c_str(), mPipelineCachePath.c_str()) != 0) {
+      gLog->warn("Could not write pipeline cache file {}", mPipelineCachePath);
+   }
+}
+
 void
 Driver::initialiseBlankSampler()
 {
@@ -361,16 +500,15 @@ void
 Driver::run()
 {
    while (mRunState == RunState::Running) {
-      // Grab the next buffer
-      gpu::ringbuffer::wait();
-      auto buffer = gpu::ringbuffer::read();
+      // Wait for the next buffer
+      auto hasBuffers = gpu::ringbuffer::wait();
 
       // Check for any fences completing
       checkSyncFences();
 
-      // Process the buffer if there is anything new
-      if (!buffer.empty()) {
-         executeBuffer(buffer);
+      // Process the buffers if there is anything new
+      if (hasBuffers) {
+         executeBuffers();
       }
    }
 
@@ -383,16 +521,15 @@ Driver::runUntilFlip()
    auto startingSwap = mLastSwap;
 
    while (mRunState == RunState::Running) {
-      // Grab the next item
-      gpu::ringbuffer::wait();
+      // Wait for the next buffer
+      auto hasBuffers = gpu::ringbuffer::wait();
 
       // Check for any fences completing
       checkSyncFences();
 
-      // Process the buffer if there is anything new
-      auto buffer = gpu::ringbuffer::read();
-      if (!buffer.empty()) {
-         executeBuffer(buffer);
+      // Process the buffers if there is anything new
+      if (hasBuffers) {
+         executeBuffers();
       }
 
       if (mLastSwap > startingSwap) {
@@ -13,15 +13,18 @@
 #include "vk_mem_alloc_decaf.h"
 #include "vulkan_descs.h"
 #include "vulkan_memtracker.h"
+#include "vulkan_shadercache.h"
 
 #include <atomic>
 #include <common/vulkan_hpp.h>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <gsl/gsl>
 #include <list>
 #include <map>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <unordered_map>
 
@@ -369,6 +372,7 @@ struct PipelineObject
 {
    HashedDesc<PipelineDesc> desc;
    PipelineLayoutObject *pipelineLayout;
+   std::atomic<bool> ready { false };
    vk::Pipeline pipeline;
    bool needsPremultipliedTargets;
    std::array<bool, latte::MaxRenderTargets> targetIsPremultiplied;
@@ -400,12 +404,31 @@ struct IndexBufferCache
 
    latte::VGT_DI_PRIMITIVE_TYPE newPrimitiveType;
    uint32_t newNumIndices;
-   StagingBuffer *indexBuffer;
+   vk::Buffer indexBuffer;
+};
+
+struct IndexBufferObject
+{
+   HashedDesc<IndexBufferDesc> desc;
+
+   // The state of the guest memory the indices were converted from
+   cpu::MemtrackState dataState;
+
+   // The converted indices, which live in GPU memory
+   latte::VGT_DI_PRIMITIVE_TYPE newPrimitiveType;
+   uint32_t newNumIndices;
+   uint32_t size;
+   VmaAllocation allocation;
+   vk::Buffer buffer;
+
+   // Position in the least recently used list
+   std::list<IndexBufferObject *>::iterator lruItr;
 };
 
 struct DrawDesc
 {
    void *indices;
+   phys_addr indicesAddress;
    latte::VGT_INDEX_TYPE indexType;
    latte::VGT_DMA_SWAP indexSwapMode;
    latte::VGT_DI_PRIMITIVE_TYPE primitiveType;
@@ -422,7 +445,7 @@ struct DrawDesc
    vk::Viewport viewport;
    ShaderViewportData shaderViewportData;
    vk::Rect2D scissor;
-   StagingBuffer *indexBuffer = nullptr;
+   vk::Buffer indexBuffer;
    VertexShaderObject *vertexShader = nullptr;
    GeometryShaderObject *geometryShader = nullptr;
    PixelShaderObject *pixelShader = nullptr;
@@ -476,6 +499,17 @@ struct VulkanDisplayPipeline
    std::vector<vk::Semaphore> renderFinishedSemaphores;
 };
 
+//! Register groups which let the checkCurrent* functions skip rebuilding
+//! and hashing their descriptors when none of their registers have changed.
+enum RegisterGroup : uint8_t
+{
+   VertexShaderRegs     = 1 << 0,
+   GeometryShaderRegs   = 1 << 1,
+   PixelShaderRegs      = 1 << 2,
+   RenderPassRegs       = 1 << 3,
+   PipelineRegs         = 1 << 4,
+};
+
 class Driver : public gpu::GraphicsDriver, public Pm4Processor
 {
 public:
@@ -505,6 +539,7 @@ protected:
    void initialiseBlankImage();
    void initialiseBlankBuffer();
    void setupResources();
+   void initialiseRegisterGroups();
    void updateDebuggerInfo();
    void validateDevice();
 
@@ -548,8 +583,12 @@ protected:
    vk::QueryPool allocateOccQueryPool();
    void retireOccQueryPool(vk::QueryPool pool);
 
+   // Persistent Caches
+   void openPersistentCaches(uint64_t titleId);
+   void savePipelineCache();
+
    // Driver
-   void executeBuffer(const gpu::ringbuffer::Buffer &buffer);
+   void executeBuffers();
    int32_t findMemoryType(uint32_t memoryTypeBits, vk::MemoryPropertyFlags props);
 
    // Viewports
@@ -631,13 +670,16 @@ protected:
    // Indices
    void maybeSwapIndices();
    void maybeUnpackPrimitiveIndices();
+   void convertIndices();
+   IndexBufferObject * getIndexBuffer(const HashedDesc<IndexBufferDesc> &desc);
+   void evictIndexBuffer(IndexBufferObject *indexBuffer);
    bool checkCurrentIndices();
    void bindIndexBuffer();
 
    // Draws
    void bindDescriptors();
    void bindShaderParams();
-   void drawGenericIndexed(latte::VGT_DRAW_INITIATOR drawInit, uint32_t numIndices, void *indices);
+   void drawGenericIndexed(latte::VGT_DRAW_INITIATOR drawInit, uint32_t numIndices, void *indices, phys_addr indicesAddress);
    void flushPendingDraws();
    void drawCurrentState();
 
@@ -672,6 +714,13 @@ protected:
    // Pipelines
    PipelineDesc getPipelineDesc();
    bool checkCurrentPipeline();
+   void compilePipeline(PipelineObject *pipelineObj, vk::PipelineLayout pipelineLayout);
+   void startPipelineCompileThreads(unsigned numThreads);
+   void stopPipelineCompileThreads();
+   void waitForPipelineCompiles();
+   void queuePipelineCompile(PipelineObject *pipelineObj, vk::PipelineLayout pipelineLayout);
+   bool waitForPipeline(PipelineObject *pipelineObj);
+   void pipelineCompileThread();
 
    // Stream Out
    StreamContextObject * allocateStreamContext(uint32_t initialOffset);
@@ -737,6 +786,18 @@ private:
    uint64_t *mLastOccQueryAddr = nullptr;
    vk::QueryPool mLastOccQuery;
    vk::PipelineCache mPipelineCache;
+   std::string mPipelineCachePath;
+   ShaderCache mShaderCache;
+   uint64_t mCacheTitleId = 0;
+
+   std::vector<std::thread> mPipelineCompileThreads;
+   std::mutex mPipelineCompileMutex;
+   std::condition_variable mPipelineCompileSignal;
+   std::condition_variable mPipelineCompiled;
+   std::deque<std::pair<PipelineObject *, vk::PipelineLayout>> mPipelineCompileQueue;
+   unsigned mPipelineCompilesActive = 0;
+   bool mPipelineCompileStop = false;
+   std::chrono::milliseconds mPipelineCompileWait { 0 };
 
    SyncWaiter *mActiveSyncWaiter = nullptr;
    vk::CommandBuffer mActiveCommandBuffer;
@@ -802,6 +863,9 @@ private:
    std::unordered_map<DataHash, RenderPassObject*> mRenderPasses;
    std::unordered_map<DataHash, PipelineLayoutObject *> mPipelineLayouts;
    std::unordered_map<DataHash, PipelineObject*> mPipelines;
+   std::unordered_map<DataHash, IndexBufferObject*> mIndexBuffers;
+   std::list<IndexBufferObject *> mIndexBufferLru;
+   uint64_t mIndexBufferBytes = 0;
    std::unordered_map<DataHash, SamplerObject*> mSamplers;
    std::unordered_map<uint64_t, MemCacheObject *> mMemCaches;
 
@@ -812,6 +876,7 @@ private:
    bool mDumpShaders;
    bool mDumpShaderBinariesOnly;
    bool mDumpTextures;
+   bool mLogSkippedDraws;
 };
 
 } // namespace vulkan
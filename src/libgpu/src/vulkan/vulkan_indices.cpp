@@ -1,51 +1,13 @@
 #ifdef DECAF_VULKAN
 #include "vulkan_driver.h"
+#include "gpu_indices.h"
+
 #include <common/byte_swap_array.h>
 
-namespace vulkan
-{
+static constexpr uint64_t MaxIndexBufferCacheBytes = 64 * 1024 * 1024;
 
-template<typename IndexType>
-static void
-unpackQuadList(uint32_t count,
-               const IndexType *src,
-               IndexType *dst)
+namespace vulkan
 {
-   // Unpack quad indices into triangle indices
-   if (src) {
-      for (IndexType i = 0u; i < count / 4; ++i) {
-         IndexType index_0 = *src++;
-         IndexType index_1 = *src++;
-         IndexType index_2 = *src++;
-         IndexType index_3 = *src++;
-
-         *(dst++) = index_0;
-         *(dst++) = index_1;
-         *(dst++) = index_2;
-
-         *(dst++) = index_0;
-         *(dst++) = index_2;
-         *(dst++) = index_3;
-      }
-   } else {
-      IndexType index_0 = 0u;
-      IndexType index_1 = 1u;
-      IndexType index_2 = 2u;
-      IndexType index_3 = 3u;
-
-      for (IndexType i = 0u; i < count / 4; ++i) {
-         IndexType index = i * 4;
-
-         *(dst++) = index_0 + index;
-         *(dst++) = index_1 + index;
-         *(dst++) = index_2 + index;
-
-         *(dst++) = index_0 + index;
-         *(dst++) = index_2 + index;
-         *(dst++) = index_3 + index;
-      }
-   }
-}
 
 static inline uint32_t
 calculateIndexBufferSize(latte::VGT_INDEX_TYPE indexType, uint32_t numIndices)
@@ -60,6 +22,20 @@ calculateIndexBufferSize(latte::VGT_INDEX_TYPE indexType, uint32_t numIndices)
    decaf_abort("Unexpected index type");
 }
 
+static uint32_t
+calculateConvertedNumIndices(latte::VGT_DI_PRIMITIVE_TYPE primitiveType,
+                             uint32_t numIndices)
+{
+   switch (primitiveType) {
+   case latte::VGT_DI_PRIMITIVE_TYPE::QUADLIST:
+      return gpu::getQuadListNumIndices(numIndices);
+   case latte::VGT_DI_PRIMITIVE_TYPE::LINELOOP:
+      return numIndices + 1;
+   default:
+      return numIndices;
+   }
+}
+
 void
 Driver::maybeSwapIndices()
 {
@@ -93,19 +69,27 @@ Driver::maybeUnpackPrimitiveIndices()
       mScratchIdxPrim.resize(indexBytes / 4 * 6);
 
       if (drawDesc.indexType == latte::VGT_INDEX_TYPE::INDEX_16) {
-         unpackQuadList(drawDesc.numIndices,
-                        reinterpret_cast<uint16_t*>(indices),
-                        reinterpret_cast<uint16_t*>(mScratchIdxPrim.data()));
+         auto dst = reinterpret_cast<uint16_t *>(mScratchIdxPrim.data());
+
+         if (indices) {
+            gpu::unpackQuadList(dst, reinterpret_cast<uint16_t *>(indices), drawDesc.numIndices, false);
+         } else {
+            gpu::generateQuadList(dst, drawDesc.numIndices);
+         }
       } else if (drawDesc.indexType == latte::VGT_INDEX_TYPE::INDEX_32) {
-         unpackQuadList(drawDesc.numIndices,
-                        reinterpret_cast<uint32_t*>(indices),
-                        reinterpret_cast<uint32_t*>(mScratchIdxPrim.data()));
+         auto dst = reinterpret_cast<uint32_t *>(mScratchIdxPrim.data());
+
+         if (indices) {
+            gpu::unpackQuadList(dst, reinterpret_cast<uint32_t *>(indices), drawDesc.numIndices, false);
+         } else {
+            gpu::generateQuadList(dst, drawDesc.numIndices);
+         }
       } else {
          decaf_abort("Unexpected index type");
       }
 
       drawDesc.primitiveType = latte::VGT_DI_PRIMITIVE_TYPE::TRILIST;
-      drawDesc.numIndices = drawDesc.numIndices / 4 * 6;
+      drawDesc.numIndices = gpu::getQuadListNumIndices(drawDesc.numIndices);
       indices = mScratchIdxPrim.data();
    } else if (drawDesc.primitiveType == latte::VGT_DI_PRIMITIVE_TYPE::LINELOOP) {
       auto indexBytes = calculateIndexBufferSize(drawDesc.indexType, drawDesc.numIndices + 1);
@@ -129,11 +113,203 @@ Driver::maybeUnpackPrimitiveIndices()
    }
 }
 
+
+/**
+ * Convert the indices of the current draw into something we can draw with.
+ *
+ * When the swap mode matches the index size, which is the usual case, quad
+ * lists are byte swapped as part of the expansion rather than in a separate
+ * pass over the indices.
+ */
+void
+Driver::convertIndices()
+{
+   auto &drawDesc = *mCurrentDraw;
+
+   if (drawDesc.indices && drawDesc.primitiveType == latte::VGT_DI_PRIMITIVE_TYPE::QUADLIST) {
+      auto indexBytes = calculateIndexBufferSize(drawDesc.indexType, drawDesc.numIndices);
+
+      if (drawDesc.indexType == latte::VGT_INDEX_TYPE::INDEX_16 &&
+          drawDesc.indexSwapMode == latte::VGT_DMA_SWAP::SWAP_16_BIT) {
+         mScratchIdxPrim.resize(indexBytes / 4 * 6);
+         gpu::unpackQuadList(reinterpret_cast<uint16_t *>(mScratchIdxPrim.data()),
+                             reinterpret_cast<uint16_t *>(drawDesc.indices),
+                             drawDesc.numIndices, true);
+      } else if (drawDesc.indexType == latte::VGT_INDEX_TYPE::INDEX_32 &&
+                 drawDesc.indexSwapMode == latte::VGT_DMA_SWAP::SWAP_32_BIT) {
+         mScratchIdxPrim.resize(indexBytes / 4 * 6);
+         gpu::unpackQuadList(reinterpret_cast<uint32_t *>(mScratchIdxPrim.data()),
+                             reinterpret_cast<uint32_t *>(drawDesc.indices),
+                             drawDesc.numIndices, true);
+      } else {
+         maybeSwapIndices();
+         maybeUnpackPrimitiveIndices();
+         return;
+      }
+
+      drawDesc.primitiveType = latte::VGT_DI_PRIMITIVE_TYPE::TRILIST;
+      drawDesc.numIndices = gpu::getQuadListNumIndices(drawDesc.numIndices);
+      drawDesc.indices = mScratchIdxPrim.data();
+      return;
+   }
+
+   maybeSwapIndices();
+   maybeUnpackPrimitiveIndices();
+}
+
+
+/**
+ * Find the converted copy of the current draw's indices, converting and
+ * uploading them again if the guest memory has changed since.
+ *
+ * Converted index buffers are kept in GPU memory, up to a budget after which
+ * the least recently used ones are evicted.
+ */
+IndexBufferObject *
+Driver::getIndexBuffer(const HashedDesc<IndexBufferDesc> &desc)
+{
+   auto &drawDesc = *mCurrentDraw;
+   auto indexBytes = calculateIndexBufferSize(desc->indexType, desc->numIndices);
+   auto dataState = cpu::getMemoryState(desc->address, indexBytes);
+
+   auto iter = mIndexBuffers.find(desc.hash());
+   if (iter != mIndexBuffers.end()) {
+      auto foundIndexBuffer = iter->second;
+
+      if (foundIndexBuffer->dataState == dataState) {
+         mIndexBufferLru.splice(mIndexBufferLru.begin(), mIndexBufferLru, foundIndexBuffer->lruItr);
+         return foundIndexBuffer;
+      }
+
+      // Pending draws may still be using the old indices, so rather than
+      // overwriting them we retire the buffer and upload to a new one.
+      evictIndexBuffer(foundIndexBuffer);
+   }
+
+   convertIndices();
+   auto convertedBytes = calculateIndexBufferSize(drawDesc.indexType, drawDesc.numIndices);
+
+   vk::BufferCreateInfo bufferDesc;
+   bufferDesc.size = convertedBytes;
+   bufferDesc.usage =
+      vk::BufferUsageFlagBits::eIndexBuffer |
+      vk::BufferUsageFlagBits::eTransferDst;
+   bufferDesc.sharingMode = vk::SharingMode::eExclusive;
+   bufferDesc.queueFamilyIndexCount = 0;
+   bufferDesc.pQueueFamilyIndices = nullptr;
+
+   VmaAllocationCreateInfo allocInfo = {};
+   allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+   VkBuffer buffer;
+   VmaAllocation allocation;
+   CHECK_VK_RESULT(
+      vmaCreateBuffer(mAllocator,
+                      reinterpret_cast<VkBufferCreateInfo*>(&bufferDesc),
+                      &allocInfo,
+                      &buffer,
+                      &allocation,
+                      nullptr));
+
+   static uint64_t indexBufferIndex = 0;
+   setVkObjectName(buffer, fmt::format("idx_{}_{:08x}_{}", indexBufferIndex++, desc->address.getAddress(), convertedBytes).c_str());
+
+   // Upload the converted indices through a staging buffer
+   auto stagingBuffer = getStagingBuffer(convertedBytes, StagingBufferType::CpuToGpu);
+   copyToStagingBuffer(stagingBuffer, 0, drawDesc.indices, convertedBytes);
+   transitionStagingBuffer(stagingBuffer, ResourceUsage::TransferSrc);
+
+   vk::BufferCopy copyDesc;
+   copyDesc.srcOffset = 0;
+   copyDesc.dstOffset = 0;
+   copyDesc.size = convertedBytes;
+   mActiveCommandBuffer.copyBuffer(stagingBuffer->buffer, buffer, { copyDesc });
+
+   auto srcMeta = getResourceUsageMeta(ResourceUsage::TransferDst);
+   auto dstMeta = getResourceUsageMeta(ResourceUsage::IndexBuffer);
+
+   vk::BufferMemoryBarrier bufferBarrier;
+   bufferBarrier.srcAccessMask = srcMeta.accessFlags;
+   bufferBarrier.dstAccessMask = dstMeta.accessFlags;
+   bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+   bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+   bufferBarrier.buffer = buffer;
+   bufferBarrier.offset = 0;
+   bufferBarrier.size = VK_WHOLE_SIZE;
+
+   mActiveCommandBuffer.pipelineBarrier(
+      srcMeta.stageFlags,
+      dstMeta.stageFlags,
+      vk::DependencyFlags(),
+      {},
+      { bufferBarrier },
+      {});
+
+   auto indexBuffer = new IndexBufferObject();
+   indexBuffer->desc = desc;
+   indexBuffer->dataState = dataState;
+   indexBuffer->newPrimitiveType = drawDesc.primitiveType;
+   indexBuffer->newNumIndices = drawDesc.numIndices;
+   indexBuffer->size = convertedBytes;
+   indexBuffer->allocation = allocation;
+   indexBuffer->buffer = buffer;
+
+   mIndexBuffers[desc.hash()] = indexBuffer;
+   mIndexBufferLru.push_front(indexBuffer);
+   indexBuffer->lruItr = mIndexBufferLru.begin();
+   mIndexBufferBytes += convertedBytes;
+
+   // Keep ourselves within budget, the buffer we just created is at the
+   // front of the list so it is never evicted here.
+   while (mIndexBufferBytes > MaxIndexBufferCacheBytes && mIndexBufferLru.back() != indexBuffer) {
+      evictIndexBuffer(mIndexBufferLru.back());
+   }
+
+   return indexBuffer;
+}
+
+
+/**
+ * Remove an index buffer from the cache, the buffer itself is destroyed once
+ * the command buffer which may be using it has retired.
+ */
+void
+Driver::evictIndexBuffer(IndexBufferObject *indexBuffer)
+{
+   mIndexBuffers.erase(indexBuffer->desc.hash());
+   mIndexBufferLru.erase(indexBuffer->lruItr);
+   mIndexBufferBytes -= indexBuffer->size;
+
+   addRetireTask([=]() {
+      vmaDestroyBuffer(mAllocator, indexBuffer->buffer, indexBuffer->allocation);
+      delete indexBuffer;
+   });
+}
+
 bool
 Driver::checkCurrentIndices()
 {
    auto& drawDesc = *mCurrentDraw;
 
+   // Indices from guest memory go through the index buffer cache, except for
+   // draws which end up with no indices, e.g. a quad list with fewer than 4
+   // indices, as we cannot create an empty buffer for them.
+   if (drawDesc.indices && drawDesc.indicesAddress &&
+       calculateConvertedNumIndices(drawDesc.primitiveType, drawDesc.numIndices) > 0) {
+      auto desc = IndexBufferDesc { };
+      desc.address = drawDesc.indicesAddress;
+      desc.numIndices = drawDesc.numIndices;
+      desc.indexType = drawDesc.indexType;
+      desc.swapMode = drawDesc.indexSwapMode;
+      desc.primitiveType = drawDesc.primitiveType;
+
+      auto indexBuffer = getIndexBuffer(desc);
+      drawDesc.primitiveType = indexBuffer->newPrimitiveType;
+      drawDesc.numIndices = indexBuffer->newNumIndices;
+      drawDesc.indexBuffer = indexBuffer->buffer;
+      return true;
+   }
+
    if (mLastIndexBufferSet) {
       if (drawDesc.indices == mLastIndexBuffer.indexData &&
           drawDesc.indexType == mLastIndexBuffer.indexType &&
@@ -154,8 +330,7 @@ Driver::checkCurrentIndices()
    mLastIndexBuffer.swapMode = drawDesc.indexSwapMode;
    mLastIndexBuffer.primitiveType = drawDesc.primitiveType;
 
-   maybeSwapIndices();
-   maybeUnpackPrimitiveIndices();
+   convertIndices();
 
    if (drawDesc.indices) {
       auto indexBytes = calculateIndexBufferSize(drawDesc.indexType, drawDesc.numIndices);
@@ -163,9 +338,9 @@ Driver::checkCurrentIndices()
       copyToStagingBuffer(indicesBuf, 0, drawDesc.indices, indexBytes);
       transitionStagingBuffer(indicesBuf, ResourceUsage::IndexBuffer);
 
-      drawDesc.indexBuffer = indicesBuf;
+      drawDesc.indexBuffer = indicesBuf->buffer;
    } else {
-      drawDesc.indexBuffer = nullptr;
+      drawDesc.indexBuffer = vk::Buffer { };
    }
 
    mLastIndexBuffer.newPrimitiveType = drawDesc.primitiveType;
@@ -194,7 +369,7 @@ Driver::bindIndexBuffer()
       decaf_abort("Unexpected index type");
    }
 
-   mActiveCommandBuffer.bindIndexBuffer(mCurrentDraw->indexBuffer->buffer, 0, bindIndexType);
+   mActiveCommandBuffer.bindIndexBuffer(mCurrentDraw->indexBuffer, 0, bindIndexType);
 }
 
 } // namespace vulkan
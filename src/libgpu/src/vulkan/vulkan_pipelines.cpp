@@ -388,6 +388,22 @@ Driver::checkCurrentPipeline()
    decaf_check(mCurrentDraw->vertexShader);
    decaf_check(mCurrentDraw->renderPass);
 
+   if (mCurrentDraw->pipeline && !isRegisterGroupDirty(PipelineRegs)) {
+      // None of the registers the pipeline is built from have changed, so
+      // it is still current as long as the shaders and render pass are
+      auto &activeDesc = *mCurrentDraw->pipeline->desc;
+
+      if (activeDesc.renderPass == mCurrentDraw->renderPass &&
+          activeDesc.vertexShader == mCurrentDraw->vertexShader &&
+          activeDesc.geometryShader == mCurrentDraw->geometryShader &&
+          activeDesc.pixelShader == mCurrentDraw->pixelShader &&
+          activeDesc.rectStubShader == mCurrentDraw->rectStubShader) {
+         return true;
+      }
+   }
+
+   clearRegisterGroupDirty(PipelineRegs);
+
    HashedDesc<PipelineDesc> currentDesc = getPipelineDesc();
 
    if (mCurrentDraw->pipeline && mCurrentDraw->pipeline->desc == currentDesc) {
@@ -396,32 +412,175 @@ Driver::checkCurrentPipeline()
    }
 
    auto& foundPipeline = mPipelines[currentDesc.hash()];
-   if (foundPipeline) {
-      mCurrentDraw->pipeline = foundPipeline;
+   if (!foundPipeline) {
+      foundPipeline = new PipelineObject();
+      foundPipeline->desc = currentDesc;
+
+      // The pipeline layout is shared driver state so we always resolve it
+      // here on the GPU thread, only the pipeline itself may be compiled in
+      // the background.
+      vk::PipelineLayout pipelineLayout;
+
+      HashedDesc<PipelineLayoutDesc> pipelineLayoutDesc = generatePipelineLayoutDesc(*currentDesc);
+
+      if (!ForceDescriptorSets && pipelineLayoutDesc->numDescriptors < 32) {
+         auto pipelineLayoutObj = getPipelineLayout(pipelineLayoutDesc, true);
+         foundPipeline->pipelineLayout = pipelineLayoutObj;
+         pipelineLayout = pipelineLayoutObj->pipelineLayout;
+      } else {
+         // Too many descriptors to take advantage of using push descriptors, we have to
+         // fall back to using dynamically generated descriptor sets.
+         foundPipeline->pipelineLayout = nullptr;
+         pipelineLayout = mPipelineLayout;
+      }
+
+      if (mPipelineCompileThreads.empty()) {
+         compilePipeline(foundPipeline, pipelineLayout);
+      } else {
+         queuePipelineCompile(foundPipeline, pipelineLayout);
+      }
+   }
+
+   if (!waitForPipeline(foundPipeline)) {
+      if (mLogSkippedDraws) {
+         gLog->info("Skipped draw whilst its pipeline is compiling");
+      }
+
+      mCurrentDraw->pipeline = nullptr;
+      return false;
+   }
+
+   mCurrentDraw->pipeline = foundPipeline;
+   return true;
+}
+
+
+/**
+ * Start the threads which compile new pipelines in the background.
+ */
+void
+Driver::startPipelineCompileThreads(unsigned numThreads)
+{
+   mPipelineCompileStop = false;
+
+   for (auto i = 0u; i < numThreads; ++i) {
+      mPipelineCompileThreads.emplace_back(std::bind(&Driver::pipelineCompileThread, this));
+   }
+}
+
+
+/**
+ * Stop the pipeline compile threads, any pipelines still queued are compiled
+ * before the threads exit.
+ */
+void
+Driver::stopPipelineCompileThreads()
+{
+   {
+      std::unique_lock lock { mPipelineCompileMutex };
+      mPipelineCompileStop = true;
+   }
+
+   mPipelineCompileSignal.notify_all();
+
+   for (auto &thread : mPipelineCompileThreads) {
+      thread.join();
+   }
+
+   mPipelineCompileThreads.clear();
+}
+
+
+/**
+ * Wait until every queued pipeline has finished compiling, this must be done
+ * before anything touches the pipeline cache which the threads are using.
+ */
+void
+Driver::waitForPipelineCompiles()
+{
+   std::unique_lock lock { mPipelineCompileMutex };
+   mPipelineCompiled.wait(lock, [this]() {
+      return mPipelineCompileQueue.empty() && mPipelineCompilesActive == 0;
+   });
+}
+
+void
+Driver::queuePipelineCompile(PipelineObject *pipelineObj,
+                             vk::PipelineLayout pipelineLayout)
+{
+   {
+      std::unique_lock lock { mPipelineCompileMutex };
+      mPipelineCompileQueue.push_back({ pipelineObj, pipelineLayout });
+   }
+
+   mPipelineCompileSignal.notify_one();
+}
+
+
+/**
+ * Wait for a pipeline to be ready, for at most the configured compile wait.
+ *
+ * Returns false if the pipeline is still compiling, in which case the draw
+ * which needs it should be skipped.
+ */
+bool
+Driver::waitForPipeline(PipelineObject *pipelineObj)
+{
+   if (pipelineObj->ready.load(std::memory_order_acquire)) {
       return true;
    }
 
-   foundPipeline = new PipelineObject();
-   foundPipeline->desc = currentDesc;
+   if (mPipelineCompileWait.count() == 0) {
+      return false;
+   }
 
-   // ------------------------------------------------------------
-   // Pipeline Layout
-   // ------------------------------------------------------------
+   std::unique_lock lock { mPipelineCompileMutex };
+   return mPipelineCompiled.wait_for(lock, mPipelineCompileWait, [pipelineObj]() {
+      return pipelineObj->ready.load(std::memory_order_acquire);
+   });
+}
 
-   vk::PipelineLayout pipelineLayout;
+void
+Driver::pipelineCompileThread()
+{
+   std::unique_lock lock { mPipelineCompileMutex };
 
-   HashedDesc<PipelineLayoutDesc> pipelineLayoutDesc = generatePipelineLayoutDesc(*currentDesc);
+   while (true) {
+      mPipelineCompileSignal.wait(lock, [this]() {
+         return mPipelineCompileStop || !mPipelineCompileQueue.empty();
+      });
 
-   if (!ForceDescriptorSets && pipelineLayoutDesc->numDescriptors < 32) {
-      auto pipelineLayoutObj = getPipelineLayout(pipelineLayoutDesc, true);
-      foundPipeline->pipelineLayout = pipelineLayoutObj;
-      pipelineLayout = pipelineLayoutObj->pipelineLayout;
-   } else {
-      // Too many descriptors to take advantage of using push descriptors, we have to
-      // fall back to using dynamically generated descriptor sets.
-      foundPipeline->pipelineLayout = nullptr;
-      pipelineLayout = mPipelineLayout;
+      if (mPipelineCompileQueue.empty()) {
+         // Only reached once we have been asked to stop
+         break;
+      }
+
+      auto [pipelineObj, pipelineLayout] = mPipelineCompileQueue.front();
+      mPipelineCompileQueue.pop_front();
+      ++mPipelineCompilesActive;
+
+      lock.unlock();
+      compilePipeline(pipelineObj, pipelineLayout);
+      lock.lock();
+
+      --mPipelineCompilesActive;
+      mPipelineCompiled.notify_all();
    }
+}
+
+
+/**
+ * Create the Vulkan pipeline for a pipeline object.
+ *
+ * This only reads the pipeline's own desc, and the shader modules and render
+ * pass it refers to which never change once created, so it is safe to call
+ * from the pipeline compile threads.
+ */
+void
+Driver::compilePipeline(PipelineObject *pipelineObj,
+                        vk::PipelineLayout pipelineLayout)
+{
+   auto &currentDesc = pipelineObj->desc;
 
 
    // ------------------------------------------------------------
@@ -911,20 +1070,19 @@ Driver::checkCurrentPipeline()
    pipelineInfo.pColorBlendState = &colorBlendState;
    pipelineInfo.pDynamicState = &dynamicDesc;
    pipelineInfo.layout = pipelineLayout;
-   pipelineInfo.renderPass = mCurrentDraw->renderPass->renderPass;
+   pipelineInfo.renderPass = currentDesc->renderPass->renderPass;
    pipelineInfo.subpass = 0;
    pipelineInfo.basePipelineHandle = vk::Pipeline();
    pipelineInfo.basePipelineIndex = -1;
    auto pipeline = mDevice.createGraphicsPipeline(mPipelineCache, pipelineInfo);
 
-   foundPipeline->pipeline = pipeline;
-   foundPipeline->needsPremultipliedTargets = needsPremultipliedTargets;
-   foundPipeline->targetIsPremultiplied = targetIsPremultiplied;
-   foundPipeline->shaderLopMode = shaderLopMode;
-   foundPipeline->shaderAlphaFunc = currentDesc->alphaFunc;
-   foundPipeline->shaderAlphaRef = currentDesc->alphaRef;
-   mCurrentDraw->pipeline = foundPipeline;
-   return true;
+   pipelineObj->pipeline = pipeline;
+   pipelineObj->needsPremultipliedTargets = needsPremultipliedTargets;
+   pipelineObj->targetIsPremultiplied = targetIsPremultiplied;
+   pipelineObj->shaderLopMode = shaderLopMode;
+   pipelineObj->shaderAlphaFunc = currentDesc->alphaFunc;
+   pipelineObj->shaderAlphaRef = currentDesc->alphaRef;
+   pipelineObj->ready.store(true, std::memory_order_release);
 }
 
 } // namespace vulkan
@@ -329,19 +329,19 @@ Driver::decafExpandColorBuffer(const latte::pm4::DecafExpandColorBuffer &data)
 void
 Driver::drawIndexAuto(const latte::pm4::DrawIndexAuto &data)
 {
-   drawGenericIndexed(data.drawInitiator, data.count, nullptr);
+   drawGenericIndexed(data.drawInitiator, data.count, nullptr, phys_addr { 0 });
 }
 
 void
 Driver::drawIndex2(const latte::pm4::DrawIndex2 &data)
 {
-   drawGenericIndexed(data.drawInitiator, data.count, phys_cast<void*>(data.addr).getRawPointer());
+   drawGenericIndexed(data.drawInitiator, data.count, phys_cast<void*>(data.addr).getRawPointer(), data.addr);
 }
 
 void
 Driver::drawIndexImmd(const latte::pm4::DrawIndexImmd &data)
 {
-   drawGenericIndexed(data.drawInitiator, data.count, data.indices.data());
+   drawGenericIndexed(data.drawInitiator, data.count, data.indices.data(), phys_addr { 0 });
 }
 
 void
@@ -550,18 +550,32 @@ Driver::surfaceSync(const latte::pm4::SurfaceSync &data)
 }
 
 void
-Driver::executeBuffer(const gpu::ringbuffer::Buffer &buffer)
+Driver::executeBuffers()
 {
    decaf_check(!mActiveSyncWaiter);
 
+   // Switch our on disk caches when a new title starts using the GPU
+   if (auto titleId = gpu::getActiveTitleId(); titleId != mCacheTitleId) {
+      openPersistentCaches(titleId);
+   }
+
    // Begin our command group (sync waiter)
    beginCommandGroup();
 
    // Begin preparing our command buffer
    beginCommandBuffer();
 
-   // Execute guest PM4 command buffer
-   runCommandBuffer(buffer);
+   // Execute the guest PM4 command buffers which are in the ring now, any
+   // submitted whilst we are running go into the next group.
+   for (auto count = gpu::ringbuffer::depth(); count > 0; --count) {
+      auto buffer = gpu::ringbuffer::read();
+      if (buffer.empty()) {
+         break;
+      }
+
+      runCommandBuffer(buffer);
+      gpu::ringbuffer::release();
+   }
 
    // End preparing our command buffer
    endCommandBuffer();
@@ -0,0 +1,133 @@
+#ifdef DECAF_VULKAN
+#include "vulkan_driver.h"
+
+namespace vulkan
+{
+
+static uint32_t
+getResourceRegister(latte::SQ_RES_OFFSET resource)
+{
+   return latte::Register::SQ_RESOURCE_WORD0_0 + 4 * 7 * resource;
+}
+
+
+/**
+ * Map the registers which each of the draw state descriptors is built from
+ * to the descriptor's register group, this must be kept in sync with the
+ * registers read by the matching get*Desc function.
+ */
+void
+Driver::initialiseRegisterGroups()
+{
+   // Shared by all the shader stages
+   addRegisterGroup(VertexShaderRegs | GeometryShaderRegs | PixelShaderRegs,
+                    latte::Register::SQ_CONFIG);
+   addRegisterGroup(VertexShaderRegs | GeometryShaderRegs,
+                    latte::Register::VGT_GS_MODE);
+   addRegisterGroup(VertexShaderRegs | GeometryShaderRegs,
+                    latte::Register::PA_CL_VS_OUT_CNTL);
+   addRegisterGroup(VertexShaderRegs | GeometryShaderRegs,
+                    latte::Register::VGT_STRMOUT_VTX_STRIDE_0,
+                    latte::MaxStreamOutBuffers, 16);
+   addRegisterGroup(VertexShaderRegs | GeometryShaderRegs,
+                    latte::Register::SQ_PGM_START_VS);
+   addRegisterGroup(VertexShaderRegs | GeometryShaderRegs,
+                    latte::Register::SQ_PGM_CF_OFFSET_VS);
+   addRegisterGroup(VertexShaderRegs | GeometryShaderRegs,
+                    latte::Register::SQ_PGM_SIZE_VS);
+
+   // Vertex shader
+   addRegisterGroup(VertexShaderRegs, latte::Register::SQ_PGM_START_FS);
+   addRegisterGroup(VertexShaderRegs, latte::Register::SQ_PGM_CF_OFFSET_FS);
+   addRegisterGroup(VertexShaderRegs, latte::Register::SQ_PGM_SIZE_FS);
+   addRegisterGroup(VertexShaderRegs, latte::Register::SQ_PGM_START_ES);
+   addRegisterGroup(VertexShaderRegs, latte::Register::SQ_PGM_CF_OFFSET_ES);
+   addRegisterGroup(VertexShaderRegs, latte::Register::SQ_PGM_SIZE_ES);
+   addRegisterGroup(VertexShaderRegs, latte::Register::SQ_PGM_RESOURCES_VS);
+   addRegisterGroup(VertexShaderRegs, latte::Register::SQ_VTX_SEMANTIC_0, 32);
+   addRegisterGroup(VertexShaderRegs,
+                    getResourceRegister(latte::SQ_RES_OFFSET::VS_TEX_RESOURCE_0),
+                    7 * latte::MaxTextures);
+
+   // Geometry shader
+   addRegisterGroup(GeometryShaderRegs, latte::Register::SQ_PGM_START_GS);
+   addRegisterGroup(GeometryShaderRegs, latte::Register::SQ_PGM_CF_OFFSET_GS);
+   addRegisterGroup(GeometryShaderRegs, latte::Register::SQ_PGM_SIZE_GS);
+   addRegisterGroup(GeometryShaderRegs, latte::Register::SQ_GS_VERT_ITEMSIZE);
+   addRegisterGroup(GeometryShaderRegs, latte::Register::VGT_GS_OUT_PRIM_TYPE);
+   addRegisterGroup(GeometryShaderRegs, latte::Register::SQ_GSVS_RING_ITEMSIZE);
+   addRegisterGroup(GeometryShaderRegs,
+                    getResourceRegister(latte::SQ_RES_OFFSET::GS_TEX_RESOURCE_0),
+                    7 * latte::MaxTextures);
+
+   // Pixel shader
+   addRegisterGroup(PixelShaderRegs, latte::Register::PA_CL_CLIP_CNTL);
+   addRegisterGroup(PixelShaderRegs, latte::Register::SQ_PGM_START_PS);
+   addRegisterGroup(PixelShaderRegs, latte::Register::SQ_PGM_CF_OFFSET_PS);
+   addRegisterGroup(PixelShaderRegs, latte::Register::SQ_PGM_SIZE_PS);
+   addRegisterGroup(PixelShaderRegs, latte::Register::SQ_PGM_RESOURCES_PS);
+   addRegisterGroup(PixelShaderRegs, latte::Register::SQ_PGM_EXPORTS_PS);
+   addRegisterGroup(PixelShaderRegs, latte::Register::SPI_PS_IN_CONTROL_0);
+   addRegisterGroup(PixelShaderRegs, latte::Register::SPI_PS_IN_CONTROL_1);
+   addRegisterGroup(PixelShaderRegs, latte::Register::SPI_VS_OUT_CONFIG);
+   addRegisterGroup(PixelShaderRegs, latte::Register::CB_SHADER_CONTROL);
+   addRegisterGroup(PixelShaderRegs, latte::Register::DB_SHADER_CONTROL);
+   addRegisterGroup(PixelShaderRegs, latte::Register::SPI_PS_INPUT_CNTL_0, 32);
+   addRegisterGroup(PixelShaderRegs, latte::Register::SPI_VS_OUT_ID_0, 10);
+   addRegisterGroup(PixelShaderRegs,
+                    getResourceRegister(latte::SQ_RES_OFFSET::PS_TEX_RESOURCE_0),
+                    7 * latte::MaxTextures);
+
+   // Shared by the pixel shader and render pass
+   addRegisterGroup(PixelShaderRegs | RenderPassRegs,
+                    latte::Register::CB_COLOR0_INFO, latte::MaxRenderTargets);
+   addRegisterGroup(PixelShaderRegs | RenderPassRegs,
+                    latte::Register::CB_SHADER_MASK);
+
+   // Render pass
+   addRegisterGroup(RenderPassRegs, latte::Register::CB_TARGET_MASK);
+   addRegisterGroup(RenderPassRegs, latte::Register::CB_COLOR_CONTROL);
+   addRegisterGroup(RenderPassRegs, latte::Register::CB_COLOR0_BASE, latte::MaxRenderTargets);
+   addRegisterGroup(RenderPassRegs, latte::Register::DB_DEPTH_CONTROL);
+   addRegisterGroup(RenderPassRegs, latte::Register::DB_DEPTH_BASE);
+   addRegisterGroup(RenderPassRegs, latte::Register::DB_DEPTH_INFO);
+
+   // Pipeline, this also depends on the shaders and render pass objects
+   // which are checked separately in checkCurrentPipeline
+   addRegisterGroup(PipelineRegs,
+                    getResourceRegister(latte::SQ_RES_OFFSET::VS_ATTRIB_RESOURCE_0),
+                    7 * latte::MaxAttribBuffers);
+   addRegisterGroup(PipelineRegs, latte::Register::VGT_INSTANCE_STEP_RATE_0);
+   addRegisterGroup(PipelineRegs, latte::Register::VGT_INSTANCE_STEP_RATE_1);
+   addRegisterGroup(PipelineRegs, latte::Register::VGT_PRIMITIVE_TYPE);
+   addRegisterGroup(PipelineRegs, latte::Register::VGT_MULTI_PRIM_IB_RESET_EN);
+   addRegisterGroup(PipelineRegs, latte::Register::VGT_MULTI_PRIM_IB_RESET_INDX);
+   addRegisterGroup(PipelineRegs, latte::Register::SQ_CONFIG);
+   addRegisterGroup(PipelineRegs, latte::Register::PA_CL_CLIP_CNTL);
+   addRegisterGroup(PipelineRegs, latte::Register::PA_SU_LINE_CNTL);
+   addRegisterGroup(PipelineRegs, latte::Register::PA_SU_SC_MODE_CNTL);
+   addRegisterGroup(PipelineRegs, latte::Register::PA_SU_POLY_OFFSET_FRONT_OFFSET);
+   addRegisterGroup(PipelineRegs, latte::Register::PA_SU_POLY_OFFSET_FRONT_SCALE);
+   addRegisterGroup(PipelineRegs, latte::Register::PA_SU_POLY_OFFSET_BACK_OFFSET);
+   addRegisterGroup(PipelineRegs, latte::Register::PA_SU_POLY_OFFSET_BACK_SCALE);
+   addRegisterGroup(PipelineRegs, latte::Register::PA_SU_POLY_OFFSET_CLAMP);
+   addRegisterGroup(PipelineRegs, latte::Register::DB_DEPTH_CONTROL);
+   addRegisterGroup(PipelineRegs, latte::Register::DB_STENCILREFMASK);
+   addRegisterGroup(PipelineRegs, latte::Register::DB_STENCILREFMASK_BF);
+   addRegisterGroup(PipelineRegs, latte::Register::CB_COLOR_CONTROL);
+   addRegisterGroup(PipelineRegs, latte::Register::CB_TARGET_MASK);
+   addRegisterGroup(PipelineRegs, latte::Register::CB_BLEND0_CONTROL, latte::MaxRenderTargets);
+   addRegisterGroup(PipelineRegs, latte::Register::CB_BLEND_RED);
+   addRegisterGroup(PipelineRegs, latte::Register::CB_BLEND_GREEN);
+   addRegisterGroup(PipelineRegs, latte::Register::CB_BLEND_BLUE);
+   addRegisterGroup(PipelineRegs, latte::Register::CB_BLEND_ALPHA);
+   addRegisterGroup(PipelineRegs, latte::Register::SX_ALPHA_TEST_CONTROL);
+   addRegisterGroup(PipelineRegs, latte::Register::SX_ALPHA_REF);
+
+   // Make sure the first draw builds everything
+   mDirtyRegisterGroups = 0xFF;
+}
+
+} // namespace vulkan
+
+#endif // ifdef DECAF_VULKAN
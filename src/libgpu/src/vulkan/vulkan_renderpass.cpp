@@ -100,6 +100,11 @@ Driver::getRenderPassDesc()
 bool
 Driver::checkCurrentRenderPass()
 {
+   if (mCurrentDraw->renderPass && !isRegisterGroupDirty(RenderPassRegs)) {
+      // None of the registers the render pass is built from have changed
+      return true;
+   }
+
    HashedDesc<RenderPassDesc> currentDesc = getRenderPassDesc();
 
    if (!currentDesc->colorTargets[0].isEnabled &&
@@ -115,6 +120,8 @@ Driver::checkCurrentRenderPass()
       return false;
    }
 
+   clearRegisterGroupDirty(RenderPassRegs);
+
    if (mCurrentDraw->renderPass && mCurrentDraw->renderPass->desc == currentDesc) {
       // Already active, nothing to do.
       return true;
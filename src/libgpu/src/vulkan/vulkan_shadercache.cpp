@@ -0,0 +1,274 @@
+#ifdef DECAF_VULKAN
+#include "vulkan_shadercache.h"
+#include "vulkan_shadercacherevision.h"
+
+#include <cstring>
+#include <type_traits>
+
+namespace vulkan
+{
+
+class ShaderWriter
+{
+public:
+   template<typename Type>
+   void write(const Type &value)
+   {
+      static_assert(std::is_trivially_copyable<Type>::value, "Serialised types must be trivial");
+      auto offset = data.size();
+      data.resize(offset + sizeof(Type));
+      std::memcpy(data.data() + offset, &value, sizeof(Type));
+   }
+
+   template<typename Type>
+   void write(const std::vector<Type> &values)
+   {
+      static_assert(std::is_trivially_copyable<Type>::value, "Serialised types must be trivial");
+      write(static_cast<uint32_t>(values.size()));
+
+      auto offset = data.size();
+      data.resize(offset + values.size() * sizeof(Type));
+      std::memcpy(data.data() + offset, values.data(), values.size() * sizeof(Type));
+   }
+
+   std::vector<uint8_t> data;
+};
+
+class ShaderReader
+{
+public:
+   ShaderReader(const uint8_t *data, size_t size) :
+      mPos(data),
+      mEnd(data + size)
+   {
+   }
+
+   template<typename Type>
+   bool read(Type &value)
+   {
+      static_assert(std::is_trivially_copyable<Type>::value, "Serialised types must be trivial");
+      if (static_cast<size_t>(mEnd - mPos) < sizeof(Type)) {
+         return false;
+      }
+
+      std::memcpy(&value, mPos, sizeof(Type));
+      mPos += sizeof(Type);
+      return true;
+   }
+
+   template<typename Type>
+   bool read(std::vector<Type> &values)
+   {
+      static_assert(std::is_trivially_copyable<Type>::value, "Serialised types must be trivial");
+      auto count = uint32_t { 0 };
+      if (!read(count) ||
+          static_cast<size_t>(mEnd - mPos) / sizeof(Type) < count) {
+         return false;
+      }
+
+      values.resize(count);
+      std::memcpy(values.data(), mPos, count * sizeof(Type));
+      mPos += count * sizeof(Type);
+      return true;
+   }
+
+   bool finished() const
+   {
+      return mPos == mEnd;
+   }
+
+private:
+   const uint8_t *mPos;
+   const uint8_t *mEnd;
+};
+
+static uint64_t
+hashBinary(gsl::span<const uint8_t> binary)
+{
+   return DataHash {}.write(binary.data(), binary.size()).value();
+}
+
+/**
+ * Open the cache file at path, creating it if it does not exist.
+ */
+bool
+ShaderCache::open(const std::string &path)
+{
+   return mFile.open(path, ShaderCacheRevision);
+}
+
+void
+ShaderCache::close()
+{
+   mFile.close();
+}
+
+
+/**
+ * The in-memory hash of a shader description includes the host pointers to
+ * the shader binaries, which are not stable between runs, so for the
+ * persistent hash we replace them with a hash of the binaries themselves.
+ */
+DataHash
+ShaderCache::getPersistentHash(const spirv::VertexShaderDesc &desc)
+{
+   auto copy = desc;
+   copy.binary = {};
+   copy.fsBinary = {};
+
+   return DataHash {}.write(std::array<uint64_t, 3> {
+         copy.hash().value(),
+         hashBinary(desc.binary),
+         hashBinary(desc.fsBinary),
+      });
+}
+
+DataHash
+ShaderCache::getPersistentHash(const spirv::GeometryShaderDesc &desc)
+{
+   auto copy = desc;
+   copy.binary = {};
+   copy.dcBinary = {};
+
+   return DataHash {}.write(std::array<uint64_t, 3> {
+         copy.hash().value(),
+         hashBinary(desc.binary),
+         hashBinary(desc.dcBinary),
+      });
+}
+
+DataHash
+ShaderCache::getPersistentHash(const spirv::PixelShaderDesc &desc)
+{
+   auto copy = desc;
+   copy.binary = {};
+
+   return DataHash {}.write(std::array<uint64_t, 2> {
+         copy.hash().value(),
+         hashBinary(desc.binary),
+      });
+}
+
+bool
+ShaderCache::lookup(const spirv::VertexShaderDesc &desc,
+                    spirv::VertexShader *shader)
+{
+   auto size = uint32_t { 0 };
+   auto data = mFile.lookup(static_cast<uint32_t>(spirv::ShaderType::Vertex),
+                            getPersistentHash(desc).value(), size);
+   if (!data) {
+      return false;
+   }
+
+   auto reader = ShaderReader { data, size };
+   auto &meta = shader->meta;
+   if (!reader.read(shader->binary) ||
+       !reader.read(static_cast<spirv::ShaderMeta &>(meta)) ||
+       !reader.read(meta.numExports) ||
+       !reader.read(meta.streamOutUsed) ||
+       !reader.read(meta.attribBuffers) ||
+       !reader.read(meta.attribElems) ||
+       !reader.finished()) {
+      *shader = { };
+      return false;
+   }
+
+   return true;
+}
+
+bool
+ShaderCache::lookup(const spirv::GeometryShaderDesc &desc,
+                    spirv::GeometryShader *shader)
+{
+   auto size = uint32_t { 0 };
+   auto data = mFile.lookup(static_cast<uint32_t>(spirv::ShaderType::Geometry),
+                            getPersistentHash(desc).value(), size);
+   if (!data) {
+      return false;
+   }
+
+   auto reader = ShaderReader { data, size };
+   if (!reader.read(shader->binary) ||
+       !reader.read(shader->meta) ||
+       !reader.finished()) {
+      *shader = { };
+      return false;
+   }
+
+   return true;
+}
+
+bool
+ShaderCache::lookup(const spirv::PixelShaderDesc &desc,
+                    spirv::PixelShader *shader)
+{
+   auto size = uint32_t { 0 };
+   auto data = mFile.lookup(static_cast<uint32_t>(spirv::ShaderType::Pixel),
+                            getPersistentHash(desc).value(), size);
+   if (!data) {
+      return false;
+   }
+
+   auto reader = ShaderReader { data, size };
+   if (!reader.read(shader->binary) ||
+       !reader.read(shader->meta) ||
+       !reader.finished()) {
+      *shader = { };
+      return false;
+   }
+
+   return true;
+}
+
+void
+ShaderCache::store(const spirv::VertexShaderDesc &desc,
+                   const spirv::VertexShader &shader)
+{
+   if (!mFile.enabled()) {
+      return;
+   }
+
+   auto writer = ShaderWriter { };
+   writer.write(shader.binary);
+   writer.write(static_cast<const spirv::ShaderMeta &>(shader.meta));
+   writer.write(shader.meta.numExports);
+   writer.write(shader.meta.streamOutUsed);
+   writer.write(shader.meta.attribBuffers);
+   writer.write(shader.meta.attribElems);
+   mFile.store(static_cast<uint32_t>(spirv::ShaderType::Vertex),
+               getPersistentHash(desc).value(), writer.data);
+}
+
+void
+ShaderCache::store(const spirv::GeometryShaderDesc &desc,
+                   const spirv::GeometryShader &shader)
+{
+   if (!mFile.enabled()) {
+      return;
+   }
+
+   auto writer = ShaderWriter { };
+   writer.write(shader.binary);
+   writer.write(shader.meta);
+   mFile.store(static_cast<uint32_t>(spirv::ShaderType::Geometry),
+               getPersistentHash(desc).value(), writer.data);
+}
+
+void
+ShaderCache::store(const spirv::PixelShaderDesc &desc,
+                   const spirv::PixelShader &shader)
+{
+   if (!mFile.enabled()) {
+      return;
+   }
+
+   auto writer = ShaderWriter { };
+   writer.write(shader.binary);
+   writer.write(shader.meta);
+   mFile.store(static_cast<uint32_t>(spirv::ShaderType::Pixel),
+               getPersistentHash(desc).value(), writer.data);
+}
+
+} // namespace vulkan
+
+#endif // ifdef DECAF_VULKAN
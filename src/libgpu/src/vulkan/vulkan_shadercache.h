@@ -0,0 +1,78 @@
+#pragma once
+#ifdef DECAF_VULKAN
+#include "gpu_shadercachefile.h"
+#include "spirv/spirv_translate.h"
+
+#include <common/datahash.h>
+#include <string>
+
+namespace vulkan
+{
+
+/**
+ * Shader Cache Responsibilities:
+ *
+ * 1. Store translated SPIR-V shaders on disk, keyed by the contents of the
+ *    shader description rather than the guest addresses it refers to.
+ * 2. Load the file back on the next run so shaders do not need to be
+ *    translated again.
+ *
+ * Cached shaders are only valid for the translator which produced them, so
+ * the file is tagged with ShaderCacheRevision, a hash of the translator
+ * sources generated by the build.
+ */
+class ShaderCache
+{
+public:
+   bool
+   open(const std::string &path);
+
+   void
+   close();
+
+   bool
+   enabled() const
+   {
+      return mFile.enabled();
+   }
+
+   bool
+   lookup(const spirv::VertexShaderDesc &desc,
+          spirv::VertexShader *shader);
+
+   bool
+   lookup(const spirv::GeometryShaderDesc &desc,
+          spirv::GeometryShader *shader);
+
+   bool
+   lookup(const spirv::PixelShaderDesc &desc,
+          spirv::PixelShader *shader);
+
+   void
+   store(const spirv::VertexShaderDesc &desc,
+         const spirv::VertexShader &shader);
+
+   void
+   store(const spirv::GeometryShaderDesc &desc,
+         const spirv::GeometryShader &shader);
+
+   void
+   store(const spirv::PixelShaderDesc &desc,
+         const spirv::PixelShader &shader);
+
+   static DataHash
+   getPersistentHash(const spirv::VertexShaderDesc &desc);
+
+   static DataHash
+   getPersistentHash(const spirv::GeometryShaderDesc &desc);
+
+   static DataHash
+   getPersistentHash(const spirv::PixelShaderDesc &desc);
+
+private:
+   gpu::ShaderCacheFile mFile;
+};
+
+} // namespace vulkan
+
+#endif // ifdef DECAF_VULKAN
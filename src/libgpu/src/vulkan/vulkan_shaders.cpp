@@ -444,6 +444,13 @@ dumpTranslatedShader(const spirv::ShaderDesc *desc,
 bool
 Driver::checkCurrentVertexShader()
 {
+   if (mCurrentDraw->vertexShader && !isRegisterGroupDirty(VertexShaderRegs)) {
+      // None of the registers the shader is built from have changed
+      return true;
+   }
+
+   clearRegisterGroupDirty(VertexShaderRegs);
+
    // We defer the hashing until after we check if this shader is even
    // actually enabled or not...  Performance !
    auto currentDescPrehash = getVertexShaderDesc();
@@ -476,8 +483,12 @@ Driver::checkCurrentVertexShader()
       dumpRawShader(&*currentDesc, mDumpShaderBinariesOnly);
    }
 
-   if (!spirv::translate(*currentDesc, &foundShader->shader)) {
-      decaf_abort("Failed to translate vertex shader");
+   if (!mShaderCache.lookup(*currentDesc, &foundShader->shader)) {
+      if (!spirv::translate(*currentDesc, &foundShader->shader)) {
+         decaf_abort("Failed to translate vertex shader");
+      }
+
+      mShaderCache.store(*currentDesc, foundShader->shader);
    }
 
    if (mDumpShaders) {
@@ -500,6 +511,13 @@ Driver::checkCurrentVertexShader()
 bool
 Driver::checkCurrentGeometryShader()
 {
+   if (mCurrentDraw->geometryShader && !isRegisterGroupDirty(GeometryShaderRegs)) {
+      // None of the registers the shader is built from have changed
+      return true;
+   }
+
+   clearRegisterGroupDirty(GeometryShaderRegs);
+
    // We defer the hashing until after we check if this shader is even
    // actually enabled or not...  Performance !
    auto currentDescPrehash = getGeometryShaderDesc();
@@ -532,8 +550,12 @@ Driver::checkCurrentGeometryShader()
       dumpRawShader(&*currentDesc, mDumpShaderBinariesOnly);
    }
 
-   if (!spirv::translate(*currentDesc, &foundShader->shader)) {
-      decaf_abort("Failed to translate geometry shader");
+   if (!mShaderCache.lookup(*currentDesc, &foundShader->shader)) {
+      if (!spirv::translate(*currentDesc, &foundShader->shader)) {
+         decaf_abort("Failed to translate geometry shader");
+      }
+
+      mShaderCache.store(*currentDesc, foundShader->shader);
    }
 
    if (mDumpShaders) {
@@ -556,6 +578,13 @@ Driver::checkCurrentGeometryShader()
 bool
 Driver::checkCurrentPixelShader()
 {
+   if (mCurrentDraw->pixelShader && !isRegisterGroupDirty(PixelShaderRegs)) {
+      // None of the registers the shader is built from have changed
+      return true;
+   }
+
+   clearRegisterGroupDirty(PixelShaderRegs);
+
    // We defer the hashing until after we check if this shader is even
    // actually enabled or not...  Performance !
    auto currentDescPrehash = getPixelShaderDesc();
@@ -587,8 +616,12 @@ Driver::checkCurrentPixelShader()
       dumpRawShader(&*currentDesc, mDumpShaderBinariesOnly);
    }
 
-   if (!spirv::translate(*currentDesc, &foundShader->shader)) {
-      decaf_abort("Failed to translate pixel shader");
+   if (!mShaderCache.lookup(*currentDesc, &foundShader->shader)) {
+      if (!spirv::translate(*currentDesc, &foundShader->shader)) {
+         decaf_abort("Failed to translate pixel shader");
+      }
+
+      mShaderCache.store(*currentDesc, foundShader->shader);
    }
 
    if (mDumpShaders) {
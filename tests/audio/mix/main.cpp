@@ -0,0 +1,160 @@
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+#include <cafe/libraries/sndcore2/sndcore2_mix.h>
+
+#include <array>
+#include <common/fixed.h>
+#include <random>
+#include <vector>
+
+using namespace cafe::sndcore2::internal;
+
+// Matches the sample and volume types used by sndcore2
+using Pcm16Sample = sfixed_1_0_15_t;
+using Volume = ufixed_1_15_t;
+
+static constexpr auto NumSamples = 144u;
+
+// Includes odd lengths to exercise the scalar tail of the SIMD kernels
+static constexpr auto SampleCounts = std::array<uint32_t, 5> { 96, 144, 1, 15, 37 };
+
+static std::vector<int16_t>
+generateSamples(std::mt19937 &random)
+{
+   auto samples = std::vector<int16_t>(NumSamples);
+   for (auto &sample : samples) {
+      sample = static_cast<int16_t>(random());
+   }
+
+   // Make sure the extremes are covered
+   samples[0] = -32768;
+   samples[1] = 32767;
+   return samples;
+}
+
+static std::vector<uint16_t>
+generateVolumes(std::mt19937 &random)
+{
+   auto volumes = std::vector<uint16_t> { 0x0000, 0x0001, 0x7FFF, 0x8000, 0x8001, 0xFFFF };
+   for (auto i = 0; i < 64; ++i) {
+      volumes.push_back(static_cast<uint16_t>(random()));
+   }
+
+   return volumes;
+}
+
+TEST_CASE("mixSamples matches the fixed point mixer")
+{
+   auto random = std::mt19937 { 0x5A5A };
+   auto volumes = generateVolumes(random);
+
+   for (auto numSamples : SampleCounts) {
+      for (auto volume : volumes) {
+         auto out = generateSamples(random);
+         auto samples = generateSamples(random);
+         auto expected = out;
+         auto scalar = out;
+
+         for (auto i = 0u; i < numSamples; ++i) {
+            auto value = fixed_from_data<Pcm16Sample>(expected[i]);
+            value += fixed_from_data<Pcm16Sample>(samples[i]) * fixed_from_data<Volume>(volume);
+            expected[i] = fixed_to_data(value);
+         }
+
+         mixSamples(out.data(), samples.data(), volume, numSamples);
+         mixSamplesScalar(scalar.data(), samples.data(), volume, numSamples);
+
+         INFO("numSamples = " << numSamples << ", volume = " << volume);
+         REQUIRE(out == expected);
+         REQUIRE(scalar == expected);
+      }
+   }
+}
+
+TEST_CASE("scaleSamples matches the fixed point mixer")
+{
+   auto random = std::mt19937 { 0xA5A5 };
+   auto volumes = generateVolumes(random);
+
+   for (auto numSamples : SampleCounts) {
+      for (auto volume : volumes) {
+         auto out = generateSamples(random);
+         auto expected = out;
+         auto scalar = out;
+
+         for (auto i = 0u; i < numSamples; ++i) {
+            auto value = fixed_from_data<Pcm16Sample>(expected[i]);
+            value = value * fixed_from_data<Volume>(volume);
+            expected[i] = fixed_to_data(value);
+         }
+
+         scaleSamples(out.data(), volume, numSamples);
+         scaleSamplesScalar(scalar.data(), volume, numSamples);
+
+         INFO("numSamples = " << numSamples << ", volume = " << volume);
+         REQUIRE(out == expected);
+         REQUIRE(scalar == expected);
+      }
+   }
+}
+
+template<typename Kernel>
+static void
+testMixKernel(Kernel kernel,
+              uint32_t vectorSize)
+{
+   auto random = std::mt19937 { vectorSize };
+   auto volumes = generateVolumes(random);
+
+   for (auto numSamples : SampleCounts) {
+      for (auto volume : volumes) {
+         auto out = generateSamples(random);
+         auto samples = generateSamples(random);
+         auto expected = out;
+         mixSamplesScalar(expected.data(), samples.data(), volume, numSamples);
+
+         auto i = kernel(out.data(), samples.data(), volume, numSamples);
+         INFO("numSamples = " << numSamples << ", volume = " << volume);
+         REQUIRE(i == numSamples / vectorSize * vectorSize);
+
+         mixSamplesScalar(out.data() + i, samples.data() + i, volume, numSamples - i);
+         REQUIRE(out == expected);
+      }
+   }
+}
+
+template<typename Kernel>
+static void
+testScaleKernel(Kernel kernel,
+                uint32_t vectorSize)
+{
+   auto random = std::mt19937 { vectorSize };
+   auto volumes = generateVolumes(random);
+
+   for (auto numSamples : SampleCounts) {
+      for (auto volume : volumes) {
+         auto out = generateSamples(random);
+         auto expected = out;
+         scaleSamplesScalar(expected.data(), volume, numSamples);
+
+         auto i = kernel(out.data(), volume, numSamples);
+         INFO("numSamples = " << numSamples << ", volume = " << volume);
+         REQUIRE(i == numSamples / vectorSize * vectorSize);
+
+         scaleSamplesScalar(out.data() + i, volume, numSamples - i);
+         REQUIRE(out == expected);
+      }
+   }
+}
+
+TEST_CASE("mix kernels match the scalar kernels")
+{
+   testMixKernel(mixSamplesSSE2, 8);
+   testScaleKernel(scaleSamplesSSE2, 8);
+
+   if (mixSamplesUseAvx2()) {
+      testMixKernel(mixSamplesAVX2, 16);
+      testScaleKernel(scaleSamplesAVX2, 16);
+   }
+}
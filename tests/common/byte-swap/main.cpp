@@ -0,0 +1,170 @@
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+#include <common/byte_swap_array.h>
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fmt/format.h>
+#include <random>
+#include <vector>
+
+// Includes sizes shorter than a single vector, and sizes which are not a
+// whole number of vectors, to exercise the scalar head and tail
+static constexpr auto ByteCounts = std::array<uint32_t, 10> { 0, 4, 12, 16, 28, 32, 36, 64, 100, 4100 };
+
+static std::vector<uint8_t>
+generateBytes(std::mt19937 &random,
+              size_t numBytes)
+{
+   auto bytes = std::vector<uint8_t>(numBytes);
+   for (auto &byte : bytes) {
+      byte = static_cast<uint8_t>(random());
+   }
+
+   return bytes;
+}
+
+template<typename DataType>
+static bool
+isSwapped(const uint8_t *src,
+          const uint8_t *dst,
+          uint32_t numBytes)
+{
+   for (auto i = 0u; i < numBytes; i += sizeof(DataType)) {
+      DataType srcValue, dstValue;
+      std::memcpy(&srcValue, src + i, sizeof(DataType));
+      std::memcpy(&dstValue, dst + i, sizeof(DataType));
+
+      if (dstValue != byte_swap(srcValue)) {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+template<typename DataType>
+static void
+testByteSwapToScratch()
+{
+   auto random = std::mt19937 { 0x5A5A };
+   auto source = generateBytes(random, 8192);
+   auto scratch = std::vector<uint8_t> { };
+
+   // Every source alignment a DataType can have within a 32 byte AVX2 vector
+   auto alignedSource = align_up(source.data(), 32);
+
+   for (auto offset = 0u; offset < 32; offset += sizeof(DataType)) {
+      for (auto numBytes : ByteCounts) {
+         auto src = alignedSource + offset;
+         auto dst = byte_swap_to_scratch<DataType>(src, numBytes, scratch);
+         REQUIRE(isSwapped<DataType>(src, reinterpret_cast<uint8_t *>(dst), numBytes));
+      }
+   }
+}
+
+template<typename DataType, typename Kernel>
+static void
+testAlignedKernel(Kernel kernel,
+                  uint32_t numBytes)
+{
+   auto random = std::mt19937 { numBytes };
+   auto source = generateBytes(random, numBytes + 32);
+   auto dest = std::vector<uint8_t>(numBytes + 32 + 16, 0xCD);
+
+   auto src = align_up(source.data(), 32);
+   auto dst = align_up(dest.data(), 32);
+   kernel(reinterpret_cast<DataType *>(dst),
+          reinterpret_cast<const DataType *>(src),
+          reinterpret_cast<const DataType *>(src + numBytes));
+
+   REQUIRE(isSwapped<DataType>(src, dst, numBytes));
+
+   // Make sure nothing was written past the end
+   for (auto i = 0u; i < 16; ++i) {
+      REQUIRE(dst[numBytes + i] == 0xCD);
+   }
+}
+
+template<typename DataType>
+static void
+testAlignedKernels()
+{
+   for (auto numBytes : { 0u, 16u, 32u, 48u, 4096u, 4112u }) {
+      if (byte_swap_use_ssse3()) {
+         testAlignedKernel<DataType>(byte_swap_aligned_ssse3<DataType>, numBytes);
+      }
+
+      if (byte_swap_use_avx2()) {
+         testAlignedKernel<DataType>(byte_swap_aligned_avx2<DataType>, numBytes);
+      }
+   }
+
+   // Large enough to take the non-temporal store path
+   if (byte_swap_use_avx2()) {
+      testAlignedKernel<DataType>(byte_swap_aligned_avx2<DataType>,
+                                  static_cast<uint32_t>(ByteSwapNonTemporalThreshold + 48));
+   }
+}
+
+TEST_CASE("byte_swap_to_scratch uint16_t")
+{
+   testByteSwapToScratch<uint16_t>();
+}
+
+TEST_CASE("byte_swap_to_scratch uint32_t")
+{
+   testByteSwapToScratch<uint32_t>();
+}
+
+TEST_CASE("byte_swap_aligned kernels uint16_t")
+{
+   testAlignedKernels<uint16_t>();
+}
+
+TEST_CASE("byte_swap_aligned kernels uint32_t")
+{
+   testAlignedKernels<uint32_t>();
+}
+
+template<typename Kernel>
+static void
+benchmarkKernel(const char *name,
+                Kernel kernel,
+                uint32_t numBytes)
+{
+   auto random = std::mt19937 { numBytes };
+   auto source = generateBytes(random, numBytes + 32);
+   auto dest = std::vector<uint8_t>(numBytes + 32);
+   auto src = reinterpret_cast<const uint32_t *>(align_up(source.data(), 32));
+   auto dst = reinterpret_cast<uint32_t *>(align_up(dest.data(), 32));
+
+   // Aim for roughly the same amount of data for each size
+   auto iterations = std::max<uint32_t>(1u, (1024u * 1024u * 1024u) / numBytes);
+   auto start = std::chrono::high_resolution_clock::now();
+
+   for (auto i = 0u; i < iterations; ++i) {
+      kernel(dst, src, src + numBytes / 4);
+   }
+
+   auto seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+   auto gibPerSecond = (static_cast<double>(numBytes) * iterations) / seconds / (1024.0 * 1024.0 * 1024.0);
+   fmt::print("{:>8} {:>10} bytes {:>8.2f} GiB/s\n", name, numBytes, gibPerSecond);
+}
+
+TEST_CASE("byte_swap_aligned benchmark", "[.benchmark]")
+{
+   for (auto numBytes : { 4u * 1024u, 256u * 1024u, 16u * 1024u * 1024u }) {
+      benchmarkKernel("scalar", byte_swap_unaligned<uint32_t>, numBytes);
+
+      if (byte_swap_use_ssse3()) {
+         benchmarkKernel("ssse3", byte_swap_aligned_ssse3<uint32_t>, numBytes);
+      }
+
+      if (byte_swap_use_avx2()) {
+         benchmarkKernel("avx2", byte_swap_aligned_avx2<uint32_t>, numBytes);
+      }
+   }
+}
@@ -0,0 +1,160 @@
+#include <common/byte_swap.h>
+#include <libcpu/espresso/espresso_instructionset.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fmt/format.h>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace espresso;
+
+using DecodeFunction = InstructionInfo *(*)(Instruction);
+
+// Stops the compiler from optimising away the decoding
+static volatile uint64_t sChecksum = 0;
+
+struct Corpus
+{
+   std::string name;
+   std::vector<uint32_t> instructions;
+};
+
+/**
+ * Load the achurch test binary, which is real compiled PowerPC code.
+ */
+static bool
+loadAchurchCorpus(Corpus &corpus)
+{
+   std::ifstream file { "data/achurch.bin", std::ifstream::in | std::ifstream::binary };
+   if (!file.is_open()) {
+      fmt::print("Could not open data/achurch.bin\n");
+      return false;
+   }
+
+   file.seekg(0, std::ios::end);
+   auto size = static_cast<size_t>(file.tellg());
+   file.seekg(0, std::ios::beg);
+
+   corpus.name = "achurch";
+   corpus.instructions.resize(size / 4);
+   file.read(reinterpret_cast<char *>(corpus.instructions.data()), corpus.instructions.size() * 4);
+
+   for (auto &instr : corpus.instructions) {
+      instr = byte_swap(instr);
+   }
+
+   return true;
+}
+
+/**
+ * Generate an even mix of every instruction in the instruction set, with
+ * random values for all the non-opcode fields.
+ */
+static void
+generateInstructionSetCorpus(Corpus &corpus)
+{
+   auto random = std::mt19937 { 0x1234 };
+   corpus.name = "instructionset";
+
+   for (auto id = 0u; id < static_cast<uint32_t>(InstructionID::Invalid); ++id) {
+      auto info = findInstructionInfo(static_cast<InstructionID>(id));
+      auto opcodeMask = 0u;
+
+      for (auto &op : info->opcode) {
+         opcodeMask |= getInstructionFieldBitmask(op.field);
+      }
+
+      auto instr = encodeInstruction(info->id);
+      for (auto i = 0; i < 256; ++i) {
+         corpus.instructions.push_back(instr.value | (random() & ~opcodeMask));
+      }
+   }
+
+   std::shuffle(corpus.instructions.begin(), corpus.instructions.end(), random);
+}
+
+/**
+ * Decode the corpus repeatedly for at least minSeconds, returning the average
+ * time per decode in nanoseconds.
+ */
+static double
+runBenchmark(const Corpus &corpus,
+             DecodeFunction decode,
+             double minSeconds)
+{
+   auto checksum = uint64_t { 0 };
+   auto iterations = 0u;
+   auto start = std::chrono::steady_clock::now();
+   auto elapsed = std::chrono::duration<double> { 0 };
+
+   do {
+      for (auto instr : corpus.instructions) {
+         auto info = decode(instr);
+         checksum += info ? static_cast<uint64_t>(info->id) + 1 : 0;
+      }
+
+      ++iterations;
+      elapsed = std::chrono::steady_clock::now() - start;
+   } while (elapsed.count() < minSeconds);
+
+   sChecksum = checksum;
+   return (elapsed.count() * 1e9) / (static_cast<double>(iterations) * corpus.instructions.size());
+}
+
+static void
+printUsage(const char *name)
+{
+   fmt::print("Usage: {} [--quick]\n", name);
+   fmt::print("  --quick     Run each case once, for use as a smoke test\n");
+}
+
+int main(int argc, char *argv[])
+{
+   auto minSeconds = 0.5;
+
+   for (auto i = 1; i < argc; ++i) {
+      auto arg = std::string { argv[i] };
+
+      if (arg == "--quick") {
+         minSeconds = 0.0;
+      } else {
+         printUsage(argv[0]);
+         return -1;
+      }
+   }
+
+   initialiseInstructionSet();
+
+   auto corpora = std::vector<Corpus> { };
+   if (!loadAchurchCorpus(corpora.emplace_back())) {
+      return -1;
+   }
+
+   generateInstructionSetCorpus(corpora.emplace_back());
+
+   fmt::print("corpus,instructions,treeNs,flatNs,speedup\n");
+
+   for (auto &corpus : corpora) {
+      // Both decoders must agree on every instruction
+      for (auto instr : corpus.instructions) {
+         if (decodeInstruction(instr) != decodeInstructionTree(instr)) {
+            fmt::print("Decoder mismatch for instruction {:08X} in corpus {}\n",
+                       instr, corpus.name);
+            return -1;
+         }
+      }
+
+      auto treeNs = runBenchmark(corpus, &decodeInstructionTree, minSeconds);
+      auto flatNs = runBenchmark(corpus, &decodeInstruction, minSeconds);
+
+      fmt::print("{},{},{:.3f},{:.3f},{:.2f}\n",
+                 corpus.name, corpus.instructions.size(), treeNs, flatNs,
+                 flatNs > 0.0 ? treeNs / flatNs : 0.0);
+   }
+
+   return 0;
+}
@@ -0,0 +1,104 @@
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+#include <gpu_indices.h>
+
+#include <array>
+#include <common/byte_swap.h>
+#include <random>
+#include <vector>
+
+// Includes counts which are not a whole number of quads, or too short for a
+// full vector, to exercise the scalar tails of the SIMD kernels
+static constexpr auto IndexCounts = std::array<uint32_t, 9> { 0, 3, 4, 7, 8, 12, 37, 96, 1026 };
+
+template<typename IndexType>
+static std::vector<IndexType>
+generateIndices(std::mt19937 &random,
+                uint32_t numIndices)
+{
+   auto indices = std::vector<IndexType>(numIndices);
+   for (auto &index : indices) {
+      index = static_cast<IndexType>(random());
+   }
+
+   return indices;
+}
+
+template<typename IndexType>
+static std::vector<IndexType>
+expectedQuadList(const std::vector<IndexType> &src,
+                 bool swap)
+{
+   auto expected = std::vector<IndexType> { };
+
+   for (auto i = 0u; i + 4 <= src.size(); i += 4) {
+      for (auto corner : { 0, 1, 2, 0, 2, 3 }) {
+         auto index = src[i + corner];
+         expected.push_back(swap ? byte_swap(index) : index);
+      }
+   }
+
+   return expected;
+}
+
+template<typename IndexType>
+static void
+testUnpackQuadList(uint32_t seed)
+{
+   auto random = std::mt19937 { seed };
+
+   for (auto swap : { false, true }) {
+      for (auto numIndices : IndexCounts) {
+         auto src = generateIndices<IndexType>(random, numIndices);
+         auto expected = expectedQuadList(src, swap);
+
+         // One extra index to catch the kernels writing past the end
+         auto out = std::vector<IndexType>(expected.size() + 1, 0xCD);
+         auto scalar = std::vector<IndexType>(expected.size() + 1, 0xCD);
+         gpu::unpackQuadList(out.data(), src.data(), numIndices, swap);
+         gpu::unpackQuadListScalar(scalar.data(), src.data(), numIndices, swap);
+
+         INFO("numIndices = " << numIndices << ", swap = " << swap);
+         REQUIRE(out.back() == 0xCD);
+         REQUIRE(scalar.back() == 0xCD);
+
+         out.pop_back();
+         scalar.pop_back();
+         REQUIRE(out == expected);
+         REQUIRE(scalar == expected);
+      }
+   }
+}
+
+TEST_CASE("unpackQuadList splits quads into triangles")
+{
+   testUnpackQuadList<uint16_t>(0x9AD5);
+   testUnpackQuadList<uint32_t>(0x9AD6);
+}
+
+TEST_CASE("generateQuadList matches unpacking sequential indices")
+{
+   auto numIndices = 64u;
+   auto sequential = std::vector<uint32_t>(numIndices);
+   for (auto i = 0u; i < numIndices; ++i) {
+      sequential[i] = i;
+   }
+
+   auto out = std::vector<uint32_t>(numIndices / 4 * 6);
+   gpu::generateQuadList(out.data(), numIndices);
+   REQUIRE(out == expectedQuadList(sequential, false));
+}
+
+TEST_CASE("getQuadListNumIndices counts only whole quads")
+{
+   // Draws with fewer than 4 indices convert to an empty index buffer
+   for (auto numIndices : { 0u, 1u, 2u, 3u }) {
+      REQUIRE(gpu::getQuadListNumIndices(numIndices) == 0);
+   }
+
+   for (auto numIndices : IndexCounts) {
+      auto src = std::vector<uint16_t>(numIndices);
+      REQUIRE(gpu::getQuadListNumIndices(numIndices) == expectedQuadList(src, false).size());
+   }
+}
@@ -0,0 +1,202 @@
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+#include <gpu_shadercachefile.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static constexpr uint64_t Revision = 0x1234567890ABCDEFull;
+
+static std::string
+getCachePath()
+{
+   return (std::filesystem::temp_directory_path() / "decaf-test-shadercache.bin").string();
+}
+
+static std::vector<uint8_t>
+readFile(const std::string &path)
+{
+   auto file = std::ifstream { path, std::ios::binary };
+   return { std::istreambuf_iterator<char> { file }, std::istreambuf_iterator<char> { } };
+}
+
+static void
+writeFile(const std::string &path,
+          const std::vector<uint8_t> &data)
+{
+   auto file = std::ofstream { path, std::ios::binary | std::ios::trunc };
+   file.write(reinterpret_cast<const char *>(data.data()), data.size());
+}
+
+static std::vector<uint8_t>
+makeShader(uint8_t seed,
+           size_t size)
+{
+   auto data = std::vector<uint8_t>(size);
+   for (auto i = 0u; i < size; ++i) {
+      data[i] = static_cast<uint8_t>(seed + i * 7);
+   }
+
+   return data;
+}
+
+static bool
+hasShader(const gpu::ShaderCacheFile &file,
+          uint32_t type,
+          uint64_t key,
+          const std::vector<uint8_t> &expected)
+{
+   auto size = uint32_t { 0 };
+   auto data = file.lookup(type, key, size);
+   if (!data) {
+      return false;
+   }
+
+   return std::vector<uint8_t> { data, data + size } == expected;
+}
+
+// Creates a fresh cache file containing the given shaders
+static void
+createCache(const std::string &path,
+            const std::vector<std::vector<uint8_t>> &shaders)
+{
+   std::filesystem::remove(path);
+
+   auto file = gpu::ShaderCacheFile { };
+   REQUIRE(file.open(path, Revision));
+
+   for (auto i = 0u; i < shaders.size(); ++i) {
+      file.store(i, 100 + i, shaders[i]);
+   }
+}
+
+TEST_CASE("shader cache round trips stored shaders")
+{
+   auto path = getCachePath();
+   auto shaders = std::vector<std::vector<uint8_t>> {
+      makeShader(1, 4), makeShader(2, 300), makeShader(3, 17)
+   };
+   createCache(path, shaders);
+
+   auto file = gpu::ShaderCacheFile { };
+   REQUIRE(file.open(path, Revision));
+   REQUIRE(hasShader(file, 0, 100, shaders[0]));
+   REQUIRE(hasShader(file, 1, 101, shaders[1]));
+   REQUIRE(hasShader(file, 2, 102, shaders[2]));
+
+   // The type is part of the key
+   auto size = uint32_t { 0 };
+   REQUIRE(file.lookup(1, 100, size) == nullptr);
+
+   // Later records replace earlier ones
+   auto replacement = makeShader(4, 40);
+   file.store(1, 101, replacement);
+   file.close();
+
+   REQUIRE(file.open(path, Revision));
+   REQUIRE(hasShader(file, 0, 100, shaders[0]));
+   REQUIRE(hasShader(file, 1, 101, replacement));
+   file.close();
+   std::filesystem::remove(path);
+}
+
+TEST_CASE("shader cache discards a different revision")
+{
+   auto path = getCachePath();
+   auto shaders = std::vector<std::vector<uint8_t>> { makeShader(1, 32) };
+   createCache(path, shaders);
+
+   auto file = gpu::ShaderCacheFile { };
+   REQUIRE(file.open(path, Revision + 1));
+   REQUIRE(!hasShader(file, 0, 100, shaders[0]));
+   file.close();
+
+   // The file is rewritten for the new revision
+   REQUIRE(file.open(path, Revision));
+   REQUIRE(!hasShader(file, 0, 100, shaders[0]));
+   file.close();
+   std::filesystem::remove(path);
+}
+
+TEST_CASE("shader cache drops a truncated record")
+{
+   auto path = getCachePath();
+   auto shaders = std::vector<std::vector<uint8_t>> {
+      makeShader(1, 64), makeShader(2, 64)
+   };
+   createCache(path, shaders);
+
+   auto data = readFile(path);
+   data.resize(data.size() - 3);
+   writeFile(path, data);
+
+   auto file = gpu::ShaderCacheFile { };
+   REQUIRE(file.open(path, Revision));
+   REQUIRE(hasShader(file, 0, 100, shaders[0]));
+   REQUIRE(!hasShader(file, 1, 101, shaders[1]));
+
+   // New records must not be appended after the partial record
+   auto added = makeShader(3, 24);
+   file.store(2, 102, added);
+   file.close();
+
+   REQUIRE(file.open(path, Revision));
+   REQUIRE(hasShader(file, 0, 100, shaders[0]));
+   REQUIRE(hasShader(file, 2, 102, added));
+   file.close();
+
+   // Also when only part of a record header was written
+   data = readFile(path);
+   data.push_back(0xFF);
+   data.push_back(0xFF);
+   writeFile(path, data);
+
+   REQUIRE(file.open(path, Revision));
+   REQUIRE(hasShader(file, 0, 100, shaders[0]));
+   REQUIRE(hasShader(file, 2, 102, added));
+   file.close();
+   std::filesystem::remove(path);
+}
+
+TEST_CASE("shader cache skips corrupt records")
+{
+   auto path = getCachePath();
+   auto shaders = std::vector<std::vector<uint8_t>> {
+      makeShader(1, 48), makeShader(50, 48), makeShader(100, 48)
+   };
+   createCache(path, shaders);
+
+   // Flip a byte in the middle of the second shader
+   auto data = readFile(path);
+   auto itr = std::search(data.begin(), data.end(), shaders[1].begin(), shaders[1].end());
+   REQUIRE(itr != data.end());
+   itr[shaders[1].size() / 2] ^= 0xFF;
+   writeFile(path, data);
+
+   auto file = gpu::ShaderCacheFile { };
+   REQUIRE(file.open(path, Revision));
+   REQUIRE(hasShader(file, 0, 100, shaders[0]));
+   REQUIRE(!hasShader(file, 1, 101, shaders[1]));
+   REQUIRE(hasShader(file, 2, 102, shaders[2]));
+
+   // A record whose size runs past the end of the file is treated as truncated
+   file.close();
+   data = readFile(path);
+   writeFile(path, { data.begin(), data.begin() + 16 });
+   data = readFile(path);
+
+   auto header = std::vector<uint8_t>(24, 0);
+   header[12] = 0xFF; // size
+   data.insert(data.end(), header.begin(), header.end());
+   writeFile(path, data);
+
+   REQUIRE(file.open(path, Revision));
+   file.close();
+   REQUIRE(readFile(path).size() == 16);
+   std::filesystem::remove(path);
+}
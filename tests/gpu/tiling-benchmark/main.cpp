@@ -0,0 +1,313 @@
+#include <common/align.h>
+#include <libgpu/gpu7_tiling.h>
+#include <libgpu/gpu7_tiling_cpu.h>
+
+#include <chrono>
+#include <fmt/format.h>
+#include <string>
+#include <vector>
+
+using namespace gpu7::tiling;
+
+struct BenchmarkFormat
+{
+   DataFormat format;
+   uint32_t bpp;
+};
+
+struct BenchmarkLayout
+{
+   const char *name;
+   uint32_t width;
+   uint32_t height;
+   uint32_t depth;
+   uint32_t numLevels;
+   uint32_t firstSlice;
+   uint32_t numSlices;
+};
+
+struct BenchmarkResult
+{
+   TileMode tileMode;
+   uint32_t bpp;
+   const BenchmarkLayout *layout;
+   const char *operation;
+   uint64_t bytes;
+   uint32_t iterations;
+   double seconds;
+};
+
+// Linear surfaces are not handled by the tiled retile path
+static constexpr TileMode sBenchmarkTileModes[] = {
+   TileMode::Micro1DTiledThin1,
+   TileMode::Micro1DTiledThick,
+   TileMode::Macro2DTiledThin1,
+   TileMode::Macro2DTiledThin2,
+   TileMode::Macro2DTiledThin4,
+   TileMode::Macro2DTiledThick,
+   TileMode::Macro2BTiledThin1,
+   TileMode::Macro2BTiledThin2,
+   TileMode::Macro2BTiledThin4,
+   TileMode::Macro2BTiledThick,
+   TileMode::Macro3DTiledThin1,
+   TileMode::Macro3DTiledThick,
+   TileMode::Macro3BTiledThin1,
+   TileMode::Macro3BTiledThick,
+};
+
+static constexpr BenchmarkFormat sBenchmarkFormats[] = {
+   { DataFormat::FMT_8, 8u },
+   { DataFormat::FMT_8_8, 16u },
+   { DataFormat::FMT_8_8_8_8, 32u },
+   { DataFormat::FMT_32_32, 64u },
+   { DataFormat::FMT_32_32_32_32, 128u },
+};
+
+static constexpr BenchmarkLayout sBenchmarkLayouts[] = {
+   { "256x256", 256u, 256u, 1u, 1u, 0u, 1u },
+   { "1280x720", 1280u, 720u, 1u, 1u, 0u, 1u },
+   { "1920x1080", 1920u, 1080u, 1u, 1u, 0u, 1u },
+   { "1024x1024 mips", 1024u, 1024u, 1u, 11u, 0u, 1u },
+   { "512x512x8 s2n4", 512u, 512u, 8u, 1u, 2u, 4u },
+};
+
+static const char *
+tileModeToString(TileMode mode)
+{
+   switch (mode) {
+   case TileMode::Micro1DTiledThin1:
+      return "Micro1DTiledThin1";
+   case TileMode::Micro1DTiledThick:
+      return "Micro1DTiledThick";
+   case TileMode::Macro2DTiledThin1:
+      return "Macro2DTiledThin1";
+   case TileMode::Macro2DTiledThin2:
+      return "Macro2DTiledThin2";
+   case TileMode::Macro2DTiledThin4:
+      return "Macro2DTiledThin4";
+   case TileMode::Macro2DTiledThick:
+      return "Macro2DTiledThick";
+   case TileMode::Macro2BTiledThin1:
+      return "Macro2BTiledThin1";
+   case TileMode::Macro2BTiledThin2:
+      return "Macro2BTiledThin2";
+   case TileMode::Macro2BTiledThin4:
+      return "Macro2BTiledThin4";
+   case TileMode::Macro2BTiledThick:
+      return "Macro2BTiledThick";
+   case TileMode::Macro3DTiledThin1:
+      return "Macro3DTiledThin1";
+   case TileMode::Macro3DTiledThick:
+      return "Macro3DTiledThick";
+   case TileMode::Macro3BTiledThin1:
+      return "Macro3BTiledThin1";
+   case TileMode::Macro3BTiledThick:
+      return "Macro3BTiledThick";
+   default:
+      return "Unknown";
+   }
+}
+
+static const char *
+simdLevelToString(cpu::SimdLevel level)
+{
+   switch (level) {
+   case cpu::SimdLevel::None:
+      return "none";
+   case cpu::SimdLevel::SSE2:
+      return "sse2";
+   case cpu::SimdLevel::AVX2:
+      return "avx2";
+   default:
+      return "unknown";
+   }
+}
+
+struct MipLevel
+{
+   RetileInfo retileInfo;
+   size_t offset;
+};
+
+/**
+ * Retile every level of the surface repeatedly for at least minSeconds.
+ */
+static BenchmarkResult
+runBenchmark(const SurfaceDescription &surface,
+             const BenchmarkLayout &layout,
+             bool untile,
+             double minSeconds)
+{
+   auto levels = std::vector<MipLevel> { };
+   auto bufferSize = size_t { 0 };
+   auto bytesPerIteration = uint64_t { 0 };
+
+   for (auto level = 0u; level < surface.numLevels; ++level) {
+      auto info = computeSurfaceInfo(surface, level);
+      bufferSize = align_up(bufferSize, static_cast<size_t>(info.baseAlign));
+      levels.push_back({ computeRetileInfo(info), bufferSize });
+      bufferSize += info.surfSize;
+      bytesPerIteration +=
+         static_cast<uint64_t>(levels.back().retileInfo.thinSliceBytes) * layout.numSlices;
+   }
+
+   auto tiled = std::vector<uint8_t>(bufferSize);
+   auto untiled = std::vector<uint8_t>(bufferSize);
+   for (auto i = 0u; i < tiled.size(); ++i) {
+      tiled[i] = static_cast<uint8_t>(i * 0x9E3779B1u >> 24);
+   }
+
+   auto retileAllLevels =
+      [&]()
+      {
+         for (auto &level : levels) {
+            auto &retileInfo = level.retileInfo;
+            auto tiledFirstSliceIndex = align_down(layout.firstSlice, retileInfo.microTileThickness);
+            auto tiledOffset = level.offset + tiledFirstSliceIndex * retileInfo.thinSliceBytes;
+            auto untiledOffset = level.offset + layout.firstSlice * retileInfo.thinSliceBytes;
+
+            if (untile) {
+               cpu::untile(retileInfo, untiled.data() + untiledOffset, tiled.data() + tiledOffset,
+                           layout.firstSlice, layout.numSlices);
+            } else {
+               cpu::tile(retileInfo, untiled.data() + untiledOffset, tiled.data() + tiledOffset,
+                         layout.firstSlice, layout.numSlices);
+            }
+         }
+      };
+
+   // Warm up caches and the worker threads
+   retileAllLevels();
+
+   auto iterations = 0u;
+   auto start = std::chrono::steady_clock::now();
+   auto elapsed = std::chrono::duration<double> { 0 };
+
+   do {
+      retileAllLevels();
+      ++iterations;
+      elapsed = std::chrono::steady_clock::now() - start;
+   } while (elapsed.count() < minSeconds);
+
+   auto result = BenchmarkResult { };
+   result.tileMode = surface.tileMode;
+   result.bpp = surface.bpp;
+   result.layout = &layout;
+   result.operation = untile ? "untile" : "tile";
+   result.bytes = bytesPerIteration * iterations;
+   result.iterations = iterations;
+   result.seconds = elapsed.count();
+   return result;
+}
+
+static void
+printUsage(const char *name)
+{
+   fmt::print("Usage: {} [--quick] [--json] [--simd none|sse2|avx2] [--threads N]\n", name);
+   fmt::print("  --quick     Run each case once, for use as a smoke test\n");
+   fmt::print("  --json      Output JSON instead of CSV\n");
+   fmt::print("  --simd      SIMD level to use, defaults to the best supported\n");
+   fmt::print("  --threads   Number of retile worker threads, defaults to 0\n");
+}
+
+int main(int argc, char *argv[])
+{
+   auto minSeconds = 0.25;
+   auto outputJson = false;
+   auto numThreads = 0u;
+   auto simdLevel = cpu::getSupportedSimdLevel();
+
+   for (auto i = 1; i < argc; ++i) {
+      auto arg = std::string { argv[i] };
+
+      if (arg == "--quick") {
+         minSeconds = 0.0;
+      } else if (arg == "--json") {
+         outputJson = true;
+      } else if (arg == "--threads" && i + 1 < argc) {
+         numThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+      } else if (arg == "--simd" && i + 1 < argc) {
+         auto value = std::string { argv[++i] };
+         if (value == "none") {
+            simdLevel = cpu::SimdLevel::None;
+         } else if (value == "sse2") {
+            simdLevel = cpu::SimdLevel::SSE2;
+         } else if (value == "avx2") {
+            simdLevel = cpu::SimdLevel::AVX2;
+         } else {
+            printUsage(argv[0]);
+            return -1;
+         }
+      } else {
+         printUsage(argv[0]);
+         return -1;
+      }
+   }
+
+   cpu::setSimdLevel(simdLevel);
+   cpu::setNumWorkerThreads(numThreads);
+   simdLevel = cpu::getSimdLevel();
+
+   if (outputJson) {
+      fmt::print("{{\"simd\":\"{}\",\"threads\":{},\"results\":[\n",
+                 simdLevelToString(simdLevel), numThreads);
+   } else {
+      fmt::print("tileMode,bpp,layout,width,height,depth,numLevels,firstSlice,numSlices,"
+                 "operation,simd,threads,iterations,bytes,seconds,gbps\n");
+   }
+
+   auto first = true;
+   for (auto &layout : sBenchmarkLayouts) {
+      for (auto tileMode : sBenchmarkTileModes) {
+         for (auto &format : sBenchmarkFormats) {
+            auto surface = SurfaceDescription { };
+            surface.tileMode = tileMode;
+            surface.format = format.format;
+            surface.bpp = format.bpp;
+            surface.width = layout.width;
+            surface.height = layout.height;
+            surface.numSlices = layout.depth;
+            surface.numSamples = 1u;
+            surface.numLevels = layout.numLevels;
+            surface.bankSwizzle = 0u;
+            surface.pipeSwizzle = 0u;
+            surface.dim = layout.depth > 1 ? SurfaceDim::Texture2DArray : SurfaceDim::Texture2D;
+            surface.use = SurfaceUse::None;
+
+            for (auto untile : { true, false }) {
+               auto result = runBenchmark(surface, layout, untile, minSeconds);
+               auto gbps = result.seconds > 0.0 ?
+                  (result.bytes / result.seconds) / 1e9 : 0.0;
+
+               if (outputJson) {
+                  fmt::print("{}{{\"tileMode\":\"{}\",\"bpp\":{},\"layout\":\"{}\","
+                             "\"width\":{},\"height\":{},\"depth\":{},\"numLevels\":{},"
+                             "\"firstSlice\":{},\"numSlices\":{},\"operation\":\"{}\","
+                             "\"iterations\":{},\"bytes\":{},\"seconds\":{:.6f},\"gbps\":{:.3f}}}",
+                             first ? "" : ",\n",
+                             tileModeToString(result.tileMode), result.bpp, layout.name,
+                             layout.width, layout.height, layout.depth, layout.numLevels,
+                             layout.firstSlice, layout.numSlices, result.operation,
+                             result.iterations, result.bytes, result.seconds, gbps);
+               } else {
+                  fmt::print("{},{},{},{},{},{},{},{},{},{},{},{},{},{},{:.6f},{:.3f}\n",
+                             tileModeToString(result.tileMode), result.bpp, layout.name,
+                             layout.width, layout.height, layout.depth, layout.numLevels,
+                             layout.firstSlice, layout.numSlices, result.operation,
+                             simdLevelToString(simdLevel), numThreads,
+                             result.iterations, result.bytes, result.seconds, gbps);
+               }
+
+               first = false;
+            }
+         }
+      }
+   }
+
+   if (outputJson) {
+      fmt::print("\n]}}\n");
+   }
+
+   cpu::setNumWorkerThreads(0);
+   return 0;
+}
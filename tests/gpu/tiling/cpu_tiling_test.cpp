@@ -100,6 +100,57 @@ TEST_CASE("cpuTiling")
    }
 }
 
+TEST_CASE("cpuTilingSimdParallel")
+{
+   auto supportedSimdLevel = gpu7::tiling::cpu::getSupportedSimdLevel();
+   auto layout = TestLayout { 640u, 480u, 1u, 0u, 1u };
+
+   for (auto level : { gpu7::tiling::cpu::SimdLevel::None,
+                       gpu7::tiling::cpu::SimdLevel::SSE2,
+                       gpu7::tiling::cpu::SimdLevel::AVX2 }) {
+      if (level > supportedSimdLevel) {
+         continue;
+      }
+
+      for (auto numWorkerThreads : { 0u, 3u }) {
+         SECTION(fmt::format("simd{} threads{}", static_cast<int>(level), numWorkerThreads))
+         {
+            gpu7::tiling::cpu::setSimdLevel(level);
+            gpu7::tiling::cpu::setNumWorkerThreads(numWorkerThreads);
+
+            for (auto& mode : sTestTilingMode) {
+               for (auto& format : sTestFormats) {
+                  auto surface = gpu7::tiling::SurfaceDescription { };
+                  surface.tileMode = mode.tileMode;
+                  surface.format = format.format;
+                  surface.bpp = format.bpp;
+                  surface.width = layout.width;
+                  surface.height = layout.height;
+                  surface.numSlices = layout.depth;
+                  surface.numSamples = 1u;
+                  surface.numLevels = 1u;
+                  surface.bankSwizzle = 0u;
+                  surface.pipeSwizzle = 0u;
+                  surface.dim = gpu7::tiling::SurfaceDim::Texture2DArray;
+                  surface.use = format.depth ?
+                     gpu7::tiling::SurfaceUse::DepthBuffer :
+                     gpu7::tiling::SurfaceUse::None;
+
+                  INFO(fmt::format("{} {}bpp", tileModeToString(mode.tileMode), format.bpp));
+                  compareTilingToAddrLib(surface,
+                                         sRandomData,
+                                         layout.testFirstSlice,
+                                         layout.testNumSlices);
+               }
+            }
+
+            gpu7::tiling::cpu::setNumWorkerThreads(0);
+            gpu7::tiling::cpu::setSimdLevel(supportedSimdLevel);
+         }
+      }
+   }
+}
+
 struct ALibPendingCpuPerfEntry
 {
    gpu7::tiling::SurfaceDescription desc;
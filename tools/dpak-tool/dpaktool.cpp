@@ -0,0 +1,339 @@
+#include <vfs/vfs_packed_format.h>
+
+#include <algorithm>
+#include <excmd.h>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+using namespace vfs::packed;
+
+struct PackEntry
+{
+   std::string path;
+   std::filesystem::path hostPath;
+   Entry entry = { };
+};
+
+struct PackOptions
+{
+   bool compress = false;
+   uint32_t chunkSize = DefaultChunkSize;
+   int level = Z_DEFAULT_COMPRESSION;
+};
+
+
+/**
+ * Collect every file and directory under root, sorted by image path.
+ */
+static bool
+collectEntries(const std::filesystem::path &root,
+               std::vector<PackEntry> &entries)
+{
+   auto ec = std::error_code { };
+   auto &rootEntry = entries.emplace_back();
+   rootEntry.hostPath = root;
+   rootEntry.entry.flags = Directory;
+
+   for (auto itr = std::filesystem::recursive_directory_iterator { root, ec };
+        itr != std::filesystem::recursive_directory_iterator { };
+        itr.increment(ec)) {
+      if (ec) {
+         break;
+      }
+
+      auto &packEntry = entries.emplace_back();
+      packEntry.hostPath = itr->path();
+      packEntry.path = std::filesystem::relative(itr->path(), root).generic_string();
+
+      if (itr->is_directory()) {
+         packEntry.entry.flags = Directory;
+      } else {
+         packEntry.entry.size = itr->file_size();
+      }
+   }
+
+   if (ec) {
+      std::cout << fmt::format("Error reading {}: {}", root.string(), ec.message()) << std::endl;
+      return false;
+   }
+
+   std::sort(entries.begin(), entries.end(),
+             [](const PackEntry &lhs, const PackEntry &rhs) {
+                return lhs.path < rhs.path;
+             });
+   return true;
+}
+
+
+static void
+copyFileData(std::ifstream &in,
+             std::ofstream &out,
+             uint64_t size,
+             uint32_t chunkSize)
+{
+   auto buffer = std::vector<char>(chunkSize);
+
+   for (auto offset = uint64_t { 0 }; offset < size; offset += chunkSize) {
+      auto copySize = std::min<uint64_t>(chunkSize, size - offset);
+      in.read(buffer.data(), copySize);
+      out.write(buffer.data(), copySize);
+   }
+}
+
+
+/**
+ * Write a file to the image, splitting it into individually compressed
+ * chunks if that makes it any smaller.
+ */
+static bool
+writeFileData(std::ofstream &out,
+              PackEntry &packEntry,
+              const PackOptions &options)
+{
+   auto in = std::ifstream { packEntry.hostPath, std::ifstream::binary };
+   if (!in.is_open()) {
+      std::cout << fmt::format("Could not open {}", packEntry.hostPath.string()) << std::endl;
+      return false;
+   }
+
+   auto &entry = packEntry.entry;
+   entry.dataOffset = static_cast<uint64_t>(out.tellp());
+
+   if (!options.compress || entry.size == 0) {
+      copyFileData(in, out, entry.size, options.chunkSize);
+      return !in.fail();
+   }
+
+   // Write a placeholder offset table, then each chunk
+   auto numChunks = (entry.size + options.chunkSize - 1) / options.chunkSize;
+   auto offsets = std::vector<uint64_t>(numChunks + 1);
+   auto raw = std::vector<uint8_t>(options.chunkSize);
+   auto compressed = std::vector<uint8_t>(compressBound(options.chunkSize));
+   out.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+
+   for (auto i = 0u; i < numChunks; ++i) {
+      auto rawSize = std::min<uint64_t>(options.chunkSize, entry.size - i * options.chunkSize);
+      auto compressedSize = static_cast<uLongf>(compressed.size());
+      in.read(reinterpret_cast<char *>(raw.data()), rawSize);
+      offsets[i] = static_cast<uint64_t>(out.tellp());
+
+      if (compress2(compressed.data(), &compressedSize, raw.data(),
+                    static_cast<uLong>(rawSize), options.level) == Z_OK &&
+          compressedSize < rawSize) {
+         out.write(reinterpret_cast<const char *>(compressed.data()), compressedSize);
+      } else {
+         out.write(reinterpret_cast<const char *>(raw.data()), rawSize);
+      }
+   }
+
+   offsets[numChunks] = static_cast<uint64_t>(out.tellp());
+
+   if (in.fail()) {
+      std::cout << fmt::format("Error reading {}", packEntry.hostPath.string()) << std::endl;
+      return false;
+   }
+
+   if (offsets[numChunks] - entry.dataOffset >= entry.size) {
+      // Compression did not help, overwrite it uncompressed
+      in.clear();
+      in.seekg(0);
+      out.seekp(entry.dataOffset);
+      copyFileData(in, out, entry.size, options.chunkSize);
+      return !in.fail();
+   }
+
+   out.seekp(entry.dataOffset);
+   out.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+   out.seekp(offsets[numChunks]);
+   entry.flags |= Compressed;
+   return true;
+}
+
+static bool
+packImage(const std::filesystem::path &src,
+          const std::filesystem::path &dst,
+          const PackOptions &options)
+{
+   auto entries = std::vector<PackEntry> { };
+   if (!collectEntries(src, entries)) {
+      return false;
+   }
+
+   auto out = std::ofstream { dst, std::ofstream::binary };
+   if (!out.is_open()) {
+      std::cout << fmt::format("Could not open {} for writing", dst.string()) << std::endl;
+      return false;
+   }
+
+   auto header = FileHeader { };
+   out.write(reinterpret_cast<const char *>(&header), sizeof(FileHeader));
+
+   // File data, in index order
+   auto uncompressedSize = uint64_t { 0 };
+   for (auto &packEntry : entries) {
+      if (packEntry.entry.flags & Directory) {
+         continue;
+      }
+
+      if (!writeFileData(out, packEntry, options)) {
+         return false;
+      }
+
+      uncompressedSize += packEntry.entry.size;
+   }
+
+   // Index
+   auto strings = std::string { };
+   for (auto &packEntry : entries) {
+      packEntry.entry.pathOffset = static_cast<uint32_t>(strings.size());
+      packEntry.entry.pathLength = static_cast<uint32_t>(packEntry.path.size());
+      strings += packEntry.path;
+   }
+
+   header.magic = Magic;
+   header.version = Version;
+   header.numEntries = static_cast<uint32_t>(entries.size());
+   header.chunkSize = options.chunkSize;
+   header.indexOffset = static_cast<uint64_t>(out.tellp());
+
+   for (auto &packEntry : entries) {
+      out.write(reinterpret_cast<const char *>(&packEntry.entry), sizeof(Entry));
+   }
+
+   header.stringsOffset = static_cast<uint64_t>(out.tellp());
+   header.stringsSize = strings.size();
+   out.write(strings.data(), strings.size());
+
+   auto imageSize = static_cast<uint64_t>(out.tellp());
+   out.seekp(0);
+   out.write(reinterpret_cast<const char *>(&header), sizeof(FileHeader));
+   out.close();
+
+   if (!out.good()) {
+      std::cout << fmt::format("Error writing {}", dst.string()) << std::endl;
+      return false;
+   }
+
+   // Files which did not compress are rewritten smaller, which may leave
+   // stale data past the end of the image.
+   std::filesystem::resize_file(dst, imageSize);
+
+   std::cout << fmt::format("Packed {} entries, {} bytes into {} bytes",
+                            entries.size(), uncompressedSize, imageSize) << std::endl;
+   return true;
+}
+
+static bool
+listImage(const std::filesystem::path &src)
+{
+   auto in = std::ifstream { src, std::ifstream::binary };
+   auto header = FileHeader { };
+   if (!in.read(reinterpret_cast<char *>(&header), sizeof(FileHeader)) ||
+       header.magic != Magic || header.version != Version) {
+      std::cout << fmt::format("{} is not a supported packed image", src.string()) << std::endl;
+      return false;
+   }
+
+   auto entries = std::vector<Entry>(header.numEntries);
+   auto strings = std::string(header.stringsSize, '\0');
+   in.seekg(header.indexOffset);
+   in.read(reinterpret_cast<char *>(entries.data()), entries.size() * sizeof(Entry));
+   in.seekg(header.stringsOffset);
+   in.read(strings.data(), strings.size());
+
+   if (!in.good()) {
+      std::cout << fmt::format("{} is truncated", src.string()) << std::endl;
+      return false;
+   }
+
+   for (auto &entry : entries) {
+      auto path = strings.substr(entry.pathOffset, entry.pathLength);
+
+      if (entry.flags & Directory) {
+         std::cout << fmt::format("{:>12}  /{}", "<dir>", path) << std::endl;
+      } else {
+         std::cout << fmt::format("{:>12}{} /{}", entry.size,
+                                  (entry.flags & Compressed) ? "z" : " ", path) << std::endl;
+      }
+   }
+
+   return true;
+}
+
+int main(int argc, char **argv)
+{
+   excmd::parser parser;
+   excmd::option_state options;
+   using excmd::description;
+   using excmd::default_value;
+   using excmd::value;
+
+   // Setup command line options
+   parser.global_options()
+      .add_option("h,help", description { "Show the help." });
+
+   auto pack_options = parser.add_option_group("Pack Options")
+      .add_option("compress",
+                  description { "Compress files in chunks with zlib." })
+      .add_option("chunk-size",
+                  description { "Size of each compressed chunk in bytes." },
+                  default_value<uint32_t> { DefaultChunkSize })
+      .add_option("level",
+                  description { "zlib compression level, 1 to 9." },
+                  default_value<int> { 6 });
+
+   parser.add_command("help")
+      .add_argument("command", value<std::string> { });
+
+   parser.add_command("pack")
+      .add_option_group(pack_options)
+      .add_argument("src", value<std::string> { })
+      .add_argument("dst", value<std::string> { });
+
+   parser.add_command("list")
+      .add_argument("image", value<std::string> { });
+
+   // Parse command line
+   try {
+      options = parser.parse(argc, argv);
+   } catch (excmd::exception ex) {
+      std::cout << "Error parsing command line: " << ex.what() << std::endl;
+      return -1;
+   }
+
+   // Print help
+   if (argc == 1 || options.has("help")) {
+      if (options.has("command")) {
+         std::cout << parser.format_help("dpak-tool", options.get<std::string>("command")) << std::endl;
+      } else {
+         std::cout << parser.format_help("dpak-tool") << std::endl;
+      }
+
+      return 0;
+   }
+
+   if (options.has("pack")) {
+      auto packOptions = PackOptions { };
+      packOptions.compress = options.has("compress");
+      packOptions.chunkSize = options.get<uint32_t>("chunk-size");
+      packOptions.level = options.get<int>("level");
+
+      if (packOptions.chunkSize == 0) {
+         std::cout << "chunk-size must not be 0" << std::endl;
+         return -1;
+      }
+
+      return packImage(options.get<std::string>("src"),
+                       options.get<std::string>("dst"),
+                       packOptions) ? 0 : -1;
+   } else if (options.has("list")) {
+      return listImage(options.get<std::string>("image")) ? 0 : -1;
+   }
+
+   return -1;
+}
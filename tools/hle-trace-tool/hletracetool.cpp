@@ -0,0 +1,287 @@
+#include <cafe/cafe_ppc_interface_trace_format.h>
+
+#include <algorithm>
+#include <common/bit_cast.h>
+#include <excmd.h>
+#include <fmt/format.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace cafe::trace;
+
+struct TraceFunction
+{
+   std::string name;
+   FunctionHeader header;
+};
+
+struct TraceRecord
+{
+   uint32_t coreId;
+   Record record;
+};
+
+struct TraceFile
+{
+   std::vector<TraceFunction> functions;
+   std::vector<TraceRecord> records;
+};
+
+
+/**
+ * Read a trace dump, with the records of every core merged in time order.
+ */
+static bool
+readTraceFile(const std::string &path,
+              TraceFile &trace)
+{
+   auto in = std::ifstream { path, std::ifstream::binary };
+   if (!in.is_open()) {
+      std::cout << fmt::format("Could not open {}", path) << std::endl;
+      return false;
+   }
+
+   auto header = FileHeader { };
+   in.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+   if (!in || header.magic != Magic) {
+      std::cout << fmt::format("{} is not a HLE trace dump", path) << std::endl;
+      return false;
+   }
+
+   if (header.version != Version) {
+      std::cout << fmt::format("Unsupported HLE trace version {}, expected {}",
+                               header.version, Version) << std::endl;
+      return false;
+   }
+
+   trace.functions.resize(header.numFunctions);
+   for (auto &function : trace.functions) {
+      in.read(reinterpret_cast<char *>(&function.header), sizeof(function.header));
+      function.name.resize(function.header.nameLength);
+      in.read(function.name.data(), function.name.size());
+   }
+
+   for (auto i = 0u; i < header.numCores && in; ++i) {
+      auto coreHeader = CoreHeader { };
+      in.read(reinterpret_cast<char *>(&coreHeader), sizeof(coreHeader));
+
+      auto first = trace.records.size();
+      trace.records.resize(first + coreHeader.numRecords);
+
+      for (auto j = first; j < trace.records.size(); ++j) {
+         trace.records[j].coreId = coreHeader.coreId;
+         in.read(reinterpret_cast<char *>(&trace.records[j].record), sizeof(Record));
+      }
+   }
+
+   if (!in) {
+      std::cout << fmt::format("Unexpected end of file reading {}", path) << std::endl;
+      return false;
+   }
+
+   std::stable_sort(trace.records.begin(), trace.records.end(),
+                    [](const TraceRecord &lhs, const TraceRecord &rhs) {
+                       return lhs.record.time < rhs.record.time;
+                    });
+   return true;
+}
+
+
+/**
+ * Format a record's arguments the same way as the text HLE trace log.
+ */
+static std::string
+formatArgs(const FunctionHeader &header,
+           const Record &record)
+{
+   fmt::memory_buffer out;
+   auto arg = 0u;
+
+   if (header.isMemberFunction) {
+      fmt::format_to(std::back_inserter(out), "this = 0x{:08X}, ",
+                     static_cast<uint32_t>(record.args[arg++]));
+   }
+
+   for (auto i = 0u; i < header.numArgs && arg < MaxArgs; ++i) {
+      auto &info = header.args[i];
+      auto value = record.args[arg++];
+
+      if (i > 0) {
+         fmt::format_to(std::back_inserter(out), ", ");
+      }
+
+      switch (info.type) {
+      case ArgType::Gpr32:
+         if ((info.flags & ArgString) && value) {
+            // Only the first string argument of each call is captured
+            if (record.string[0]) {
+               fmt::format_to(std::back_inserter(out), "\"{}\"", record.string);
+            } else {
+               fmt::format_to(std::back_inserter(out), "0x{:08X}", static_cast<uint32_t>(value));
+            }
+         } else if (info.flags & (ArgPointer | ArgString)) {
+            fmt::format_to(std::back_inserter(out), "0x{:08X}", static_cast<uint32_t>(value));
+         } else if (info.flags & ArgSigned) {
+            fmt::format_to(std::back_inserter(out), "{}", static_cast<int32_t>(value));
+         } else {
+            fmt::format_to(std::back_inserter(out), "{}", static_cast<uint32_t>(value));
+         }
+         break;
+      case ArgType::Gpr64:
+         if (info.flags & ArgSigned) {
+            fmt::format_to(std::back_inserter(out), "{}", static_cast<int64_t>(value));
+         } else {
+            fmt::format_to(std::back_inserter(out), "{}", value);
+         }
+         break;
+      case ArgType::Fpr:
+         fmt::format_to(std::back_inserter(out), "{}", bit_cast<double>(value));
+         break;
+      case ArgType::VarArgs:
+         fmt::format_to(std::back_inserter(out), "...");
+         break;
+      case ArgType::Void:
+         break;
+      }
+   }
+
+   return fmt::to_string(out);
+}
+
+static const TraceFunction *
+getFunction(const TraceFile &trace,
+            const Record &record)
+{
+   if (record.function >= trace.functions.size()) {
+      return nullptr;
+   }
+
+   return &trace.functions[record.function];
+}
+
+static std::string
+escapeJson(const std::string &str)
+{
+   auto out = std::string { };
+
+   for (auto c : str) {
+      if (c == '"' || c == '\\') {
+         out.push_back('\\');
+         out.push_back(c);
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+         out += fmt::format("\\u{:04x}", static_cast<unsigned char>(c));
+      } else {
+         out.push_back(c);
+      }
+   }
+
+   return out;
+}
+
+static void
+printText(const TraceFile &trace)
+{
+   for (auto &[coreId, record] : trace.records) {
+      auto function = getFunction(trace, record);
+      if (!function) {
+         std::cout << fmt::format("[core {}] {:>14.6f} <unknown function {}> from 0x{:08X}",
+                                  coreId, record.time / 1000000000.0,
+                                  record.function, record.lr) << std::endl;
+         continue;
+      }
+
+      std::cout << fmt::format("[core {}] {:>14.6f} {}({}) from 0x{:08X}",
+                               coreId, record.time / 1000000000.0,
+                               function->name, formatArgs(function->header, record),
+                               record.lr) << std::endl;
+   }
+}
+
+
+/**
+ * Print the trace in the Chrome trace event format, which can be loaded in
+ * chrome://tracing or Perfetto. Each call is an instant event on the thread
+ * of the core which made it.
+ */
+static void
+printChromeTrace(const TraceFile &trace)
+{
+   std::cout << "{\"traceEvents\":[" << std::endl;
+
+   for (auto i = 0u; i < trace.records.size(); ++i) {
+      auto &[coreId, record] = trace.records[i];
+      auto function = getFunction(trace, record);
+      auto name = function ? function->name : fmt::format("<unknown function {}>", record.function);
+      auto args = function ? formatArgs(function->header, record) : std::string { };
+
+      std::cout << fmt::format("{{\"name\":\"{}\",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":{},\"ts\":{:.3f},"
+                               "\"args\":{{\"args\":\"{}\",\"lr\":\"0x{:08X}\"}}}}{}",
+                               escapeJson(name), coreId, record.time / 1000.0,
+                               escapeJson(args), record.lr,
+                               (i + 1 < trace.records.size()) ? "," : "") << std::endl;
+   }
+
+   std::cout << "]}" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+   excmd::parser parser;
+   excmd::option_state options;
+   using excmd::description;
+   using excmd::value;
+
+   // Setup command line options
+   parser.global_options()
+      .add_option("h,help", description { "Show the help." });
+
+   auto print_options = parser.add_option_group("Print Options")
+      .add_option("chrome",
+                  description { "Output in the Chrome trace event JSON format." });
+
+   parser.add_command("help")
+      .add_argument("command", value<std::string> { });
+
+   parser.add_command("print")
+      .add_option_group(print_options)
+      .add_argument("trace", value<std::string> { });
+
+   // Parse command line
+   try {
+      options = parser.parse(argc, argv);
+   } catch (excmd::exception ex) {
+      std::cout << "Error parsing command line: " << ex.what() << std::endl;
+      return -1;
+   }
+
+   // Print help
+   if (argc == 1 || options.has("help")) {
+      if (options.has("command")) {
+         std::cout << parser.format_help("hle-trace-tool", options.get<std::string>("command")) << std::endl;
+      } else {
+         std::cout << parser.format_help("hle-trace-tool") << std::endl;
+      }
+
+      return 0;
+   }
+
+   if (options.has("print")) {
+      auto trace = TraceFile { };
+      if (!readTraceFile(options.get<std::string>("trace"), trace)) {
+         return -1;
+      }
+
+      if (options.has("chrome")) {
+         printChromeTrace(trace);
+      } else {
+         printText(trace);
+      }
+
+      return 0;
+   }
+
+   return -1;
+}